@@ -0,0 +1,109 @@
+#include "adc_input.h"
+
+/**
+ * Starts sampling the channels in the mask. The ADC inputs (GPIOs) should
+ * be initialised already.
+*/
+void AdcInput::init(uint8_t channel_mask) {
+    // Round robin goes up from the selected channel, so the samples of the
+    // channels follow each other in the ring in this order
+    for (int channel = 0; channel < ADC_CHANNELS; channel++) {
+        if (channel_mask & (1 << channel)) {
+            m_channels[m_no_of_channels++] = channel;
+        }
+        m_values[channel] = 0;
+        m_steps[channel] = 0;
+    }
+
+    // The ring must hold the same number of samples of every channel, otherwise
+    // the channels move around in it when it wraps (ie. no 3 channels)
+    hard_assert(m_no_of_channels && ADC_RING_SIZE % m_no_of_channels == 0);
+
+    adc_select_input(m_channels[0]);
+    adc_set_round_robin(channel_mask);
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_set_clkdiv(48000000.0f / ADC_SAMPLE_RATE_HZ - 1);
+
+    m_dma_channel = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(m_dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_ring(&config, true, __builtin_ctz(sizeof(m_samples)));
+    channel_config_set_dreq(&config, DREQ_ADC);
+    dma_channel_configure(m_dma_channel, &config, m_samples, &adc_hw->fifo, 0, false);
+
+    adc_fifo_drain();
+    m_start();
+    adc_run(true);
+}
+
+/**
+ * Averages the samples in the ring for each channel and moves the smoothed
+ * values towards them
+*/
+void AdcInput::update() {
+    // The transfer count lasts for weeks, but restart if it's finished
+    if (!dma_channel_is_busy(m_dma_channel)) {
+        m_start();
+    }
+
+    uint32_t sums[ADC_CHANNELS] = {0, 0, 0, 0};
+    for (int i = 0; i < ADC_RING_SIZE; i++) {
+        sums[m_channels[i % m_no_of_channels]] += m_samples[i];
+    }
+
+    int samples_per_channel = ADC_RING_SIZE / m_no_of_channels;
+    for (int i = 0; i < m_no_of_channels; i++) {
+        uint8_t channel = m_channels[i];
+
+        // 12 bit samples to 16 bit with the 4 bits of the filter on top
+        uint32_t value = (sums[channel] << 8) / samples_per_channel;
+        if (m_overrides & (1 << channel)) {
+            m_values[channel] = m_override_values[channel] << 4;
+        } else if (!m_started) {
+            m_values[channel] = value;
+        } else {
+            m_values[channel] += ((int32_t)value - (int32_t)m_values[channel]) >> ADC_SMOOTHING_SHIFT;
+        }
+    }
+    m_started = true;
+}
+
+/**
+ * Returns the value of the channel quantized to the given number of steps,
+ * with hysteresis
+*/
+int AdcInput::get_step(uint8_t channel, int steps) {
+    int32_t value = get_value(channel);
+    int32_t width = 0x10000 / steps;
+    int32_t hysteresis = width * ADC_HYSTERESIS / 100;
+    int step = m_steps[channel];
+
+    if (value < step * width - hysteresis || value >= (step + 1) * width + hysteresis) {
+        step = value / width;
+        if (step >= steps) step = steps - 1;
+        m_steps[channel] = step;
+    }
+
+    return step;
+}
+
+/**
+ * Sets the channel to a 16 bit value from the next update()
+*/
+void AdcInput::set_override(uint8_t channel, uint16_t value) {
+    m_override_values[channel] = value;
+    m_overrides |= (1 << channel);
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+void AdcInput::m_start() {
+    dma_channel_set_write_addr(m_dma_channel, m_samples, false);
+    // A multiple of the ring size, so the ring positions of the channels don't
+    // change on restart
+    dma_channel_set_trans_count(m_dma_channel, 0xffffffff & ~(ADC_RING_SIZE - 1), true);
+}
@@ -0,0 +1,64 @@
+#ifndef _ADC_INPUT_H
+#define _ADC_INPUT_H
+
+/**
+ * Pots and selectors on the ADC
+ *
+ * The ADC runs free in round robin mode over the used channels and DMA writes
+ * the samples into a ring, so reading a value never waits for a conversion.
+ * update() averages the ring for each channel (oversampling, +2 bits) and
+ * smooths it further with a one pole filter.
+ *
+ * Values that are mapped to steps (like the mode selector) are quantized with
+ * hysteresis: the step only changes if the value goes beyond the step's
+ * boundaries by ADC_HYSTERESIS percent of a step, so noise around a boundary
+ * can't make it flap.
+ *
+ * A channel can be overridden with a fixed value (input injection), it's used
+ * instead of the samples until it's released.
+ */
+
+#include <inttypes.h>
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "settings.h"
+
+#define ADC_CHANNELS        4
+#define ADC_RING_SIZE       32          // Samples, must be a power of two and a
+                                        // multiple of the number of channels
+#define ADC_SAMPLE_RATE_HZ  2000        // All channels together
+#define ADC_SMOOTHING_SHIFT 2           // One pole filter, 1/4 of the difference
+#define ADC_HYSTERESIS      25          // Percent of a step
+
+class AdcInput {
+public:
+    void init(uint8_t channel_mask);
+    void update();
+
+    // Smoothed value as 16 bit
+    uint16_t get_value(uint8_t channel) { return m_values[channel] >> 4; }
+
+    int get_step(uint8_t channel, int steps);
+
+    void set_override(uint8_t channel, uint16_t value);
+    void release_overrides() { m_overrides = 0; }
+
+private:
+    uint16_t m_samples[ADC_RING_SIZE] __attribute__((aligned(ADC_RING_SIZE * sizeof(uint16_t))));
+
+    uint m_dma_channel;
+    uint8_t m_channels[ADC_CHANNELS];
+    int m_no_of_channels = 0;
+    bool m_started = false;
+
+    // 16 bit values with 4 more bits of the filter
+    uint32_t m_values[ADC_CHANNELS];
+    int m_steps[ADC_CHANNELS];
+
+    volatile uint8_t m_overrides = 0;
+    volatile uint16_t m_override_values[ADC_CHANNELS];
+
+    void m_start();
+};
+
+#endif
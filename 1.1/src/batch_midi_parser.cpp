@@ -0,0 +1,81 @@
+#include "batch_midi_parser.h"
+
+// Data bytes of the channel messages by the high nibble of the status
+static const uint8_t channel_lengths[8] = {
+    2,  // 0x80 note off
+    2,  // 0x90 note on
+    2,  // 0xa0 poly pressure
+    2,  // 0xb0 control change
+    1,  // 0xc0 program change
+    1,  // 0xd0 channel pressure
+    2,  // 0xe0 pitch bend
+    0   // 0xf0 system, see below
+};
+
+void BatchMidiParser::parse_bytes(const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+
+        if (byte & 0x80) {
+            // Real-time
+            if (byte >= 0xf8) continue;
+
+            m_status_byte(byte);
+            continue;
+        }
+
+        if (m_skip || !m_status) continue;
+
+        m_data[m_count++] = byte;
+        if (m_count == m_expected) {
+            m_dispatch();
+
+            // Running status, the next message can start with data
+            m_count = 0;
+        }
+    }
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+void BatchMidiParser::m_status_byte(uint8_t status) {
+    m_count = 0;
+
+    if (status < 0xf0) {
+        m_status = status;
+        m_expected = channel_lengths[(status >> 4) & 0x7];
+        m_skip = false;
+        return;
+    }
+
+    // System common and sysex cancel running status. Data bytes are skipped
+    // until the next status: sysex (0xf0) runs until 0xf7 or any other status,
+    // 0xf1-0xf3 have 1 or 2 data bytes.
+    m_status = 0;
+    m_skip = status <= 0xf3;
+}
+
+void BatchMidiParser::m_dispatch() {
+    uint8_t channel = m_status & 0x0f;
+
+    switch (m_status & 0xf0) {
+    case 0x80:
+        note_off(channel, m_data[0], m_data[1]);
+        break;
+    case 0x90:
+        if (m_data[1]) {
+            note_on(channel, m_data[0], m_data[1]);
+        } else {
+            note_off(channel, m_data[0], 0);
+        }
+        break;
+    case 0xb0:
+        cc(channel, m_data[0], m_data[1]);
+        break;
+    case 0xe0:
+        pitch_bend(channel, (m_data[1] << 7) | m_data[0]);
+        break;
+    }
+}
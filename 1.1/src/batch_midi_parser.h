@@ -0,0 +1,40 @@
+#ifndef _BATCH_MIDI_PARSER_H
+#define _BATCH_MIDI_PARSER_H
+
+/**
+ * Batch MIDI parser
+ *
+ * Parses a whole buffer of MIDI bytes in one call, straight from where they
+ * were received, and calls the same callbacks as MidiParser (note_on,
+ * note_off, cc, pitch_bend). The number of data bytes of each status comes
+ * from a table, running status is supported.
+ *
+ * - A note on with 0 velocity is a note off.
+ * - Real-time messages (clock etc.) can come anywhere, even in between the
+ *   data bytes of a message, and they don't cancel running status. They're
+ *   ignored.
+ * - System common messages and sysex cancel running status, their data is
+ *   skipped.
+ * - The channel of the callbacks is the low nibble of the status (0-15).
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <midi_parser.h>
+
+class BatchMidiParser: public MidiParser {
+public:
+    void parse_bytes(const uint8_t *data, size_t length);
+
+private:
+    uint8_t m_status = 0;               // Running status, 0 if there's none
+    uint8_t m_data[2];
+    uint8_t m_count = 0;
+    uint8_t m_expected = 0;             // Data bytes of the current message
+    bool m_skip = false;                // Data of a system message or sysex
+
+    void m_status_byte(uint8_t status);
+    void m_dispatch();
+};
+
+#endif
@@ -0,0 +1,309 @@
+#include "benchmark.h"
+
+// Measures one call with interrupts off
+#define BENCHMARK_MEASURE(histogram, call) { \
+        uint32_t interrupts = save_and_disable_interrupts(); \
+        uint32_t start = Profiler::cycles(); \
+        call; \
+        uint32_t cycles = (start - Profiler::cycles()) & SYSTICK_MASK; \
+        restore_interrupts(interrupts); \
+        (histogram).add(cycles); \
+    }
+
+static const uint8_t chord_notes[VOICES] = {48, 52, 55, 60, 64, 67};
+
+// Keeps the compiler from folding the pitch conversions of constant notes
+static volatile int32_t g_transpose = 0;
+static volatile uint32_t g_sink;
+
+void Benchmark::run() {
+    static benchmark_workload workloads[4];
+    static Para para;
+    static Mono mono;
+
+    Profiler::get_instance().init_core();
+
+    m_make_chords(workloads[0]);
+    m_make_trills(workloads[1]);
+    m_make_stack(workloads[2]);
+    m_make_bend(workloads[3]);
+
+    printf("Benchmark, %d rounds (cycles @ %" PRIu32 "MHz)\n", BENCHMARK_ROUNDS, clock_get_hz(clk_sys) / 1000000);
+
+    for (int i = 0; i < 4; i++) {
+        m_run_converter("para", para, workloads[i]);
+        m_run_converter("mono", mono, workloads[i]);
+        m_run_synth(workloads[i]);
+    }
+
+    m_run_parser();
+    m_run_pitch();
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+void Benchmark::m_make_chords(benchmark_workload &workload) {
+    workload.name = "chords";
+    workload.no_of_events = 0;
+
+    for (int chord = 0; chord < 4; chord++) {
+        for (int i = 0; i < VOICES; i++) {
+            workload.events[workload.no_of_events++] = {BENCHMARK_NOTE_ON, (uint8_t)(chord_notes[i] + chord), 0};
+        }
+        for (int i = 0; i < VOICES; i++) {
+            workload.events[workload.no_of_events++] = {BENCHMARK_NOTE_OFF, (uint8_t)(chord_notes[i] + chord), 0};
+        }
+    }
+}
+
+/**
+ * The next note is always pressed before the previous one is released
+*/
+void Benchmark::m_make_trills(benchmark_workload &workload) {
+    workload.name = "trills";
+    workload.no_of_events = 0;
+
+    workload.events[workload.no_of_events++] = {BENCHMARK_NOTE_ON, 60, 0};
+    for (int i = 0; i < 30; i++) {
+        uint8_t note = (i & 1) ? 60 : 62;
+        uint8_t previous = (i & 1) ? 62 : 60;
+        workload.events[workload.no_of_events++] = {BENCHMARK_NOTE_ON, note, 0};
+        workload.events[workload.no_of_events++] = {BENCHMARK_NOTE_OFF, previous, 0};
+    }
+    workload.events[workload.no_of_events++] = {BENCHMARK_NOTE_OFF, 60, 0};
+}
+
+/**
+ * Notes are released from the bottom of the stack
+*/
+void Benchmark::m_make_stack(benchmark_workload &workload) {
+    workload.name = "stack";
+    workload.no_of_events = 0;
+
+    for (int i = 0; i < NOTE_STACK_SIZE; i++) {
+        workload.events[workload.no_of_events++] = {BENCHMARK_NOTE_ON, (uint8_t)(48 + i), 0};
+    }
+    for (int i = 0; i < NOTE_STACK_SIZE; i++) {
+        workload.events[workload.no_of_events++] = {BENCHMARK_NOTE_OFF, (uint8_t)(48 + i), 0};
+    }
+}
+
+/**
+ * A triangle from the center to the top, bottom and back, over a chord
+*/
+void Benchmark::m_make_bend(benchmark_workload &workload) {
+    workload.name = "bend";
+    workload.no_of_events = 0;
+
+    for (int i = 0; i < 3; i++) {
+        workload.events[workload.no_of_events++] = {BENCHMARK_NOTE_ON, chord_notes[i], 0};
+    }
+
+    int bends = BENCHMARK_MAX_EVENTS - 6;
+    for (int i = 0; i < bends; i++) {
+        int32_t phase = i * 4 * MAX_PITCH_BEND / bends;
+        int32_t bend;
+        if (phase < MAX_PITCH_BEND / 2) {
+            bend = PITCH_BEND_CENTER + phase;
+        } else if (phase < 3 * MAX_PITCH_BEND / 2) {
+            bend = PITCH_BEND_CENTER + MAX_PITCH_BEND - phase;
+        } else {
+            bend = PITCH_BEND_CENTER + phase - 2 * MAX_PITCH_BEND;
+        }
+        if (bend < 0) bend = 0;
+        if (bend > MAX_PITCH_BEND) bend = MAX_PITCH_BEND;
+        workload.events[workload.no_of_events++] = {BENCHMARK_PITCH_BEND, 0, (uint16_t)bend};
+    }
+    workload.events[workload.no_of_events - 1].bend = PITCH_BEND_CENTER;
+
+    for (int i = 0; i < 3; i++) {
+        workload.events[workload.no_of_events++] = {BENCHMARK_NOTE_OFF, chord_notes[i], 0};
+    }
+}
+
+/**
+ * Converters don't handle pitch bend, those events are skipped
+*/
+void Benchmark::m_run_converter(const char *name, IConverter &converter, benchmark_workload &workload) {
+    Histogram histogram;
+    histogram.reset();
+
+    for (int round = 0; round < BENCHMARK_ROUNDS; round++) {
+        converter.reset();
+
+        for (int i = 0; i < workload.no_of_events; i++) {
+            benchmark_event &event = workload.events[i];
+            if (event.type == BENCHMARK_NOTE_ON) {
+                BENCHMARK_MEASURE(histogram, converter.note_on(MIDI_CHANNEL, event.note, 100));
+            } else if (event.type == BENCHMARK_NOTE_OFF) {
+                BENCHMARK_MEASURE(histogram, converter.note_off(MIDI_CHANNEL, event.note, 0));
+            }
+        }
+    }
+
+    m_print(name, workload.name, histogram);
+}
+
+/**
+ * The control side sends the events to the output queue and the output side
+ * applies them. Core 1 is not running yet, so both are measured here, the
+ * output side after every event.
+*/
+void Benchmark::m_run_synth(benchmark_workload &workload) {
+    Synth &synth = Synth::get_instance();
+    Histogram control;
+    Histogram output;
+    control.reset();
+    output.reset();
+
+    for (int round = 0; round < BENCHMARK_ROUNDS; round++) {
+        for (int i = 0; i < workload.no_of_events; i++) {
+            benchmark_event &event = workload.events[i];
+            switch (event.type) {
+            case BENCHMARK_NOTE_ON:
+                BENCHMARK_MEASURE(control, synth.note_on(MIDI_CHANNEL, event.note, 100));
+                break;
+            case BENCHMARK_NOTE_OFF:
+                BENCHMARK_MEASURE(control, synth.note_off(MIDI_CHANNEL, event.note, 0));
+                break;
+            case BENCHMARK_PITCH_BEND:
+                BENCHMARK_MEASURE(control, synth.pitch_bend(MIDI_CHANNEL, event.bend));
+                break;
+            }
+
+            BENCHMARK_MEASURE(output, synth.process_output());
+        }
+    }
+
+    m_print("synth", workload.name, control);
+    m_print("output", workload.name, output);
+}
+
+/**
+ * The parsers have no callbacks here (MidiParser's are empty), so it's only
+ * the parsing
+*/
+void Benchmark::m_run_parser() {
+    static uint8_t stream[BENCHMARK_MIDI_BYTES];
+    static uint8_t ring_buffer[32];
+    static BatchMidiParser batch_parser;
+    static MidiParser byte_parser;
+    static RingBuffer ring;
+    ring.init(ring_buffer, sizeof(ring_buffer));
+
+    // Chords with running status and a CC and pitch bend in between, with
+    // clock every 16 bytes
+    int length = 0;
+    uint8_t note = 48;
+    while (length < BENCHMARK_MIDI_BYTES - 16) {
+        if (length % 16 == 0) {
+            stream[length++] = 0xf8;
+        }
+        stream[length++] = 0x90 | MIDI_CHANNEL;
+        for (int i = 0; i < 3; i++) {
+            stream[length++] = note + i * 4;
+            stream[length++] = 100;
+        }
+        stream[length++] = 0xb0 | MIDI_CHANNEL;
+        stream[length++] = 1;
+        stream[length++] = note;
+        stream[length++] = 0xe0 | MIDI_CHANNEL;
+        stream[length++] = 0;
+        stream[length++] = note;
+        note = (note + 1) & 0x7f;
+    }
+
+    Histogram batch;
+    Histogram bytes;
+    batch.reset();
+    bytes.reset();
+
+    for (int round = 0; round < BENCHMARK_ROUNDS; round++) {
+        BENCHMARK_MEASURE(batch, batch_parser.parse_bytes(stream, length));
+        BENCHMARK_MEASURE(bytes,
+            for (int i = 0; i < length; i++) {
+                uint8_t byte = 0;
+                ring.write_byte(stream[i]);
+                while (!ring.is_empty()) {
+                    ring.read_byte(byte);
+                    byte_parser.parse_byte(byte);
+                }
+            }
+        );
+    }
+
+    m_print_throughput("batch", batch, length);
+    m_print_throughput("byte", bytes, length);
+}
+
+/**
+ * Divisors and amps of a 6 note chord: the note table, the exp2 table (a
+ * modulated pitch) and the runtime path the tables replaced, pow() and float
+ * divides in software float. Each measurement is a whole chord.
+*/
+void Benchmark::m_run_pitch() {
+    Histogram pow_path;
+    Histogram table;
+    Histogram exp2;
+    pow_path.reset();
+    table.reset();
+    exp2.reset();
+
+    for (int round = 0; round < BENCHMARK_ROUNDS; round++) {
+        int32_t transpose = g_transpose + round % 12;
+
+        BENCHMARK_MEASURE(pow_path,
+            for (int i = 0; i < VOICES; i++) {
+                uint16_t amp;
+                g_sink = m_pow_divisor(chord_notes[i] + transpose, amp);
+                g_sink = amp;
+            }
+        );
+        BENCHMARK_MEASURE(table,
+            for (int i = 0; i < VOICES; i++) {
+                uint32_t divisor = Pitch::divisor(Pitch::from_midi_note(chord_notes[i] + transpose));
+                g_sink = divisor;
+                g_sink = Pitch::amp(divisor);
+            }
+        );
+        BENCHMARK_MEASURE(exp2,
+            for (int i = 0; i < VOICES; i++) {
+                uint32_t divisor = Pitch::divisor(Pitch::from_midi_note(chord_notes[i] + transpose) + 37);
+                g_sink = divisor;
+                g_sink = Pitch::amp(divisor);
+            }
+        );
+    }
+
+    m_print("pow", "pitch", pow_path);
+    m_print("table", "pitch", table);
+    m_print("exp2", "pitch", exp2);
+}
+
+/**
+ * The conversion before the note table: frequency_from_midi_note(),
+ * m_set_frequency() and amp_for_frequency()
+*/
+uint32_t Benchmark::m_pow_divisor(int note, uint16_t &amp) {
+    float freq = pow(2, (note - 69) / 12.0f) * 440.0f;
+    amp = (int)(DIV_COUNTER * freq / MAX_FREQ);
+    return clock_get_hz(clk_sys) / 2 / freq;
+}
+
+void Benchmark::m_print(const char *name, const char *workload, Histogram &histogram) {
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+    printf("  %-6s %-7s n: %6" PRIu32 " min: %6" PRIu32 " avg: %6" PRIu32 " max: %6" PRIu32
+           " (%" PRIu32 " ns/event)\n", name, workload,
+           histogram.count, histogram.min, histogram.mean(), histogram.max, histogram.mean() * 1000 / mhz);
+}
+
+void Benchmark::m_print_throughput(const char *name, Histogram &histogram, int bytes) {
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+    uint32_t mean = histogram.mean();
+    uint32_t rate = mean ? (uint64_t)bytes * mhz * 100 / mean : 0;
+    printf("  %-6s %-7s n: %6" PRIu32 " min: %6" PRIu32 " avg: %6" PRIu32 " max: %6" PRIu32
+           " (%" PRIu32 ".%02" PRIu32 " bytes/us)\n", name, "parse",
+           histogram.count, histogram.min, mean, histogram.max, rate / 100, rate % 100);
+}
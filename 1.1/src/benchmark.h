@@ -0,0 +1,89 @@
+#ifndef _BENCHMARK_H
+#define _BENCHMARK_H
+
+/**
+ * On-device benchmark
+ *
+ * With ENABLE_BENCHMARK the firmware runs a few MIDI workloads at boot and
+ * prints the cost of each event in cycles (SysTick) and ns:
+ *
+ *      - chords: 6 note chords on and off
+ *      - trills: two overlapping notes, fast
+ *      - stack: 25 keys down then up in the same order (worst case of the
+ *        mono note stack)
+ *      - bend: continuous pitch bend over a held chord
+ *
+ * The MIDI parser is measured too, in bytes/us: the batch parser on a whole
+ * buffer against the previous per-byte path (a RingBuffer copy and
+ * MidiParser::parse_byte for each byte), on a stream of notes with running
+ * status, CCs, pitch bend and clock.
+ *
+ * The pitch conversion of a 6 note chord is measured too, the note and exp2
+ * tables against the pow() path they replaced (pitch.h).
+ *
+ * The workloads are run on the converters directly (Para, Mono) and through
+ * the whole control side of the synth (MIDI callbacks, converter,
+ * m_update_dcos) and the output side (process_output, ie. m_apply_mods and
+ * the DCOs). Every event is measured with interrupts off, so the numbers
+ * don't depend on the UI scan or MIDI traffic.
+ *
+ * The M0+ has no instruction counter, cycles are the closest.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <math.h>
+#include "hardware/sync.h"
+#include "hardware/clocks.h"
+#include "settings.h"
+#include "profiler.h"
+#include "i_converter.h"
+#include "./converters/para.h"
+#include "./converters/mono.h"
+#include "synth.h"
+#include "pitch.h"
+#include "batch_midi_parser.h"
+#include <ringbuffer.h>
+
+#define BENCHMARK_ROUNDS        100
+#define BENCHMARK_MAX_EVENTS    64
+#define BENCHMARK_MIDI_BYTES    256
+
+enum benchmark_event_type {
+    BENCHMARK_NOTE_ON,
+    BENCHMARK_NOTE_OFF,
+    BENCHMARK_PITCH_BEND
+};
+
+struct benchmark_event {
+    uint8_t type;
+    uint8_t note;
+    uint16_t bend;
+};
+
+struct benchmark_workload {
+    const char *name;
+    benchmark_event events[BENCHMARK_MAX_EVENTS];
+    int no_of_events;
+};
+
+class Benchmark {
+public:
+    static void run();
+
+private:
+    static void m_make_chords(benchmark_workload &workload);
+    static void m_make_trills(benchmark_workload &workload);
+    static void m_make_stack(benchmark_workload &workload);
+    static void m_make_bend(benchmark_workload &workload);
+
+    static void m_run_converter(const char *name, IConverter &converter, benchmark_workload &workload);
+    static void m_run_synth(benchmark_workload &workload);
+    static void m_run_parser();
+    static void m_run_pitch();
+    static uint32_t m_pow_divisor(int note, uint16_t &amp);
+    static void m_print(const char *name, const char *workload, Histogram &histogram);
+    static void m_print_throughput(const char *name, Histogram &histogram, int bytes);
+};
+
+#endif
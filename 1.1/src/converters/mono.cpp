@@ -1,4 +1,5 @@
 #include "mono.h"
+#include "pico/time.h"
 
 void Mono::reset() {
     m_gate = false;
@@ -19,14 +20,7 @@ void Mono::note_on(uint8_t channel, uint8_t note, uint8_t velocity) {
     set_main_velocity(velocity);
     m_gate = true;
 
-    if (settings.portamento) {
-        if (m_portamento_start == -1) {
-            m_portamento_start = note;
-            m_portamento_current_freq = 0.0f;
-        } else {
-            m_portamento_stop = note;
-        }
-    }
+    m_glide_to(note);
 
     // m_debug();
 }
@@ -43,54 +37,58 @@ void Mono::note_off(uint8_t channel, uint8_t note, uint8_t velocity) {
     if (!last_note && m_note_stack[0] != -1) m_note = m_note_stack[0];
     m_gate = (m_note_stack[0] != -1);
 
-    if (m_note_stack[0] == -1) {
-        m_portamento_start = note;
-    } else {
-        m_portamento_stop = m_note;
+    // When all notes are released the pitch stays, the next note glides from
+    // there
+    if (m_note_stack[0] != -1) {
+        m_glide_to(m_note);
     }
 
     // m_debug();
 }
 
-float Mono::get_freq(uint8_t voice) {
-    if (m_note == -1) return 0;
-
-    if (settings.portamento && m_portamento_start != -1 && m_portamento_stop != -1) {
-        float freq1 = pow(2, (m_portamento_start - 69) / 12.0f) * BASE_NOTE;
-        float freq2 = pow(2, (m_portamento_stop - 69) / 12.0f) * BASE_NOTE;
-
-        if (m_portamento_current_freq == 0) {
-            m_portamento_current_freq = freq1;
-        } else {
-
-            // Next note is higher than current
-            if (freq1 < freq2) {
-                m_portamento_current_freq += 1.0f / (m_portamento_time + 1);
-                if (m_portamento_current_freq > freq2) {
-                    m_portamento_current_freq = freq2;
-                    set_dirty(false);
-                }
-
-            // Next note is lower than current
-            } else {
-                m_portamento_current_freq -= 1.0f / (m_portamento_time + 1);
-                if (m_portamento_current_freq < freq2) {
-                    m_portamento_current_freq = freq2;
-                    set_dirty(false);
-                }
-            }
-        }
+/**
+ * Returns the pitch in cents. While gliding it's the pitch of the last
+ * update().
+*/
+int32_t Mono::get_pitch(uint8_t voice) {
+    if (m_note == -1) return PITCH_OFF;
 
-        return m_portamento_current_freq;
+    if (settings.portamento) {
+        return m_glide.get_pitch();
     }
 
-    return frequency_from_midi_note(m_note);
+    return Pitch::from_midi_note(m_note);
+}
+
+/**
+ * Stays dirty for one more update after the glide arrived, so its last step
+ * is sent too
+*/
+void Mono::update(uint32_t now_us) {
+    if (!m_glide.is_gliding()) {
+        set_dirty(false);
+        return;
+    }
+    m_glide.update(now_us);
 }
 
 bool Mono::get_gate() {
     return m_gate;
 }
 
+/**
+ * Glides to the note from the current pitch. The first note and notes played
+ * with portamento off just set the pitch, so the next glide starts from there.
+*/
+void Mono::m_glide_to(uint8_t note) {
+    if (settings.portamento && m_glide_started) {
+        m_glide.start(Pitch::from_midi_note(note), time_us_32());
+    } else {
+        m_glide.jump(Pitch::from_midi_note(note));
+    }
+    m_glide_started = true;
+}
+
 void Mono::m_push_note(uint8_t note) {
 
     // Check if note exists in the stack. If it does, do nothing unless the last
@@ -8,6 +8,7 @@
 
 #include "../settings.h"
 #include "../i_converter.h"
+#include "../glide.h"
 
 #define NOTE_STACK_SIZE 25
 
@@ -16,7 +17,8 @@ public:
     void reset(void);
     void note_on(uint8_t channel, uint8_t note, uint8_t velocity);
     void note_off(uint8_t channel, uint8_t note, uint8_t velocity);
-    float get_freq(uint8_t voice);
+    int32_t get_pitch(uint8_t voice);
+    void update(uint32_t now_us);
     bool get_gate();
 
 private:
@@ -26,10 +28,10 @@ private:
     int m_keys_pressed;
     bool m_gate;
 
-    uint8_t m_portamento_time = PORTAMENTO_TIME;
-    int m_portamento_start = -1, m_portamento_stop = -1;
-    float m_portamento_current_freq = 0.0f;
+    Glide m_glide;
+    bool m_glide_started = false;       // False until the first note
 
+    void m_glide_to(uint8_t note);
     void m_push_note(uint8_t note);
     void m_pop_note(uint8_t note);
     int m_find_note(uint8_t note);
@@ -1,13 +1,28 @@
 #include "para.h"
+#include "pico/time.h"
+
+Para::Para() {
+    // Glides are kept on reset, so the voices of a new chord glide from the
+    // previous one
+    for (int i = 0; i < VOICES; i++) {
+        m_notes[i] = -1;
+        m_glide_notes[i] = -1;
+    }
+    for (int note = 0; note < MIDI_NOTES; note++) {
+        m_note_voices[note] = 0;
+    }
+}
 
 /**
  * Resets everything
 */
 void Para::reset() {
+    set_dirty(true);
     for (int i = 0; i < VOICES; i++) {
-        m_notes[i] = -1;
+        m_set_note(i, -1);
         m_voice_millis[i] = 0;
     }
+    m_held_voices = 0;
 
     m_reset = true;
     //m_debug();
@@ -70,38 +85,44 @@ void Para::reset() {
  * a new note claims its place. Needs to be tested!
  */
 void Para::note_on(uint8_t channel, uint8_t note, uint8_t velocity) {
+    // Chord memory can transpose notes out of range
+    if (note >= MIDI_NOTES) return;
+    set_dirty(true);
+
     if (m_reset) {
         if (PARA_STACK_VOICES) {
             for (int i = 0; i < VOICES; i++) {
-                m_notes[i] = (int)note;
+                m_set_note(i, note);
             }
         } else {
-            m_notes[0] = (int)note;
+            m_set_note(0, note);
             for (int i = 1; i < VOICES; i++) {
-                m_notes[i] = -1;
+                m_set_note(i, -1);
             }
         }
         set_main_velocity(velocity);
         m_voice_millis[0] = Utils::millis();
+        m_held_voices = 1;
         m_reset = false;
+        m_glide_voices();
         // m_debug();
         return;
     }
 
     // Return if note is already playing
-    for (int i = 0; i < VOICES; i++) {
-        if (m_notes[i] == (int)note && m_voice_millis[i] != 0) return;
-    }
+    if (m_note_voices[note] & m_held_voices) return;
 
     // If the note is not playing find a voice for the new note
     int new_note_index = m_find_voice();
     m_voice_millis[new_note_index] = Utils::millis();
-    m_notes[new_note_index] = (int)note;
+    m_held_voices |= (1u << new_note_index);
+    m_set_note(new_note_index, note);
 
     if (PARA_STACK_VOICES) {
         m_distribute_notes();
     }
 
+    m_glide_voices();
     // m_debug();
 }
 
@@ -109,37 +130,55 @@ void Para::note_on(uint8_t channel, uint8_t note, uint8_t velocity) {
  * Handling NOTE OFF event. MIDI events are called in the MidiHandler class.
 */
 void Para::note_off(uint8_t channel, uint8_t note, uint8_t velocity) {
-    for (int i = 0; i < VOICES; i++) {
-        if (m_notes[i] == (int)note) {
+    if (note >= MIDI_NOTES) return;
+    set_dirty(true);
+
+    voice_mask voices = m_note_voices[note];
+    if (voices) {
+        bool silence = settings.solo && !m_last_note_playing(note);
+
+        m_held_voices &= ~voices;
+        while (voices) {
+            int i = __builtin_ctz(voices);
+            voices &= voices - 1;
+
             m_voice_millis[i] = 0;
-            if (settings.solo && !m_last_note_playing(m_notes[i])) {
-                m_notes[i] = -1;
+            if (silence) {
+                m_set_note(i, -1);
             }
         }
     }
 
     // Reset all voices when the last note is released
-    m_reset = true;
-    for (int i = 0; i < VOICES; i++) {
-        if (m_voice_millis[i] != 0) {
-            m_reset = false;
-            break;
-        }
-    }
+    m_reset = !m_held_voices;
 
     // m_debug();
 }
 
 /**
- * Return the frequency of a voice. Return 0Hz if no note is set for the
- * given voice.
- *
- * TODO: 0 AS DEFAULT MAY NOT WORK BECAUSE OF DIVISION BY 0 IN THE PIO!!
- * TO BE TESTED!!
+ * Return the pitch of a voice in cents. Return PITCH_OFF if no note is set for
+ * the given voice.
 */
-float Para::get_freq(uint8_t voice) {
-    if (m_notes[voice] == -1) return 0;
-    return frequency_from_midi_note(m_notes[voice]);
+int32_t Para::get_pitch(uint8_t voice) {
+    if (m_notes[voice] == -1) return PITCH_OFF;
+    if (settings.portamento) return m_glides[voice].get_pitch();
+    return Pitch::from_midi_note(m_notes[voice]);
+}
+
+/**
+ * Moves all the gliding voices in one go. Stays dirty for one more update
+ * after the last one arrived, so its last step is sent too.
+*/
+void Para::update(uint32_t now_us) {
+    bool gliding = false;
+    for (int i = 0; i < VOICES; i++) {
+        if (m_glides[i].is_gliding()) {
+            m_glides[i].update(now_us);
+            gliding = true;
+        }
+    }
+
+    if (!gliding) set_dirty(false);
 }
 
 /**
@@ -158,15 +197,15 @@ bool Para::get_gate() {
  * Finds the next voice for most recently played note
 */
 int Para::m_find_voice() {
+    // Return if there's a free voice
+    voice_mask free_voices = ~m_held_voices & (voice_mask)((1ull << VOICES) - 1);
+    if (free_voices) return __builtin_ctz(free_voices);
+
+    // Find the least recently used voice
     uint32_t oldest_millis = Utils::millis();
     int oldest_voice = 0;
 
     for (int i = 0; i < VOICES; i++) {
-
-        // Return if there's a free voice
-        if (m_voice_millis[i] == 0) return i;
-
-        // Find the least recently used voice
         if (m_voice_millis[i] < oldest_millis) {
             oldest_millis = m_voice_millis[i];
             oldest_voice = i;
@@ -188,7 +227,7 @@ void Para::m_distribute_notes() {
     int distinct_notes[VOICES];
     int no_of_distinct_notes = 0;
     for (int i = 0; i < VOICES; i++) {
-        if (m_voice_millis[i] != 0) {
+        if (m_held_voices & (1u << i)) {
             distinct_notes[no_of_distinct_notes] = m_notes[i];
             no_of_distinct_notes++;
         }
@@ -198,8 +237,8 @@ void Para::m_distribute_notes() {
     if (no_of_distinct_notes > 0) {
         int next_distinct_note_index = 0;
         for (int i = 0; i < VOICES; i++) {
-            if (m_voice_millis[i] == 0) {
-                m_notes[i] = distinct_notes[next_distinct_note_index];
+            if (!(m_held_voices & (1u << i))) {
+                m_set_note(i, distinct_notes[next_distinct_note_index]);
                 next_distinct_note_index++;
                 if (next_distinct_note_index >= no_of_distinct_notes) next_distinct_note_index = 0;
             }
@@ -209,13 +248,45 @@ void Para::m_distribute_notes() {
     // m_debug();
 }
 
-bool Para::m_last_note_playing(int note) {
+/**
+ * Starts the glide of the voices that got a new note. Voices that haven't
+ * played yet, or with portamento off, just jump to the note.
+*/
+void Para::m_glide_voices() {
+    uint32_t now_us = time_us_32();
+
     for (int i = 0; i < VOICES; i++) {
-        if (m_notes[i] != note && m_voice_millis[i] != 0) {
-            return false;
+        if (m_notes[i] == -1 || m_notes[i] == m_glide_notes[i]) continue;
+
+        int32_t pitch = Pitch::from_midi_note(m_notes[i]);
+        if (settings.portamento && m_glide_notes[i] != -1) {
+            m_glides[i].start(pitch, now_us);
+            set_dirty(true);
+        } else {
+            m_glides[i].jump(pitch);
         }
+        m_glide_notes[i] = m_notes[i];
     }
-    return true;
+}
+
+/**
+ * Moves a voice to another note (or -1) in the note map too
+*/
+void Para::m_set_note(int voice, int note) {
+    if (m_notes[voice] != -1) {
+        m_note_voices[m_notes[voice]] &= ~(1u << voice);
+    }
+    m_notes[voice] = note;
+    if (note != -1) {
+        m_note_voices[note] |= (1u << voice);
+    }
+}
+
+/**
+ * True if no other note's key is held
+*/
+bool Para::m_last_note_playing(int note) {
+    return !(m_held_voices & ~m_note_voices[note]);
 }
 
 void Para::m_debug() {
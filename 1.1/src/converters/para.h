@@ -5,6 +5,10 @@
  * Paraphonic converter
  *
  * To be documented...
+ *
+ * Besides the note of each voice there's a map from notes to voices, so
+ * finding the voices of a note (note off, is it already playing) takes the
+ * same time regardless of the number of voices.
  */
 
 #include <stdio.h>
@@ -14,13 +18,23 @@
 
 #include "../settings.h"
 #include "../i_converter.h"
+#include "../glide.h"
+#include "../pitch.h"
+
+// Bitmask of voices. The voice masks of the output side (Synth) are 8 bit too.
+typedef uint8_t voice_mask;
+
+static_assert(VOICES <= 8, "Too many voices for the 8 bit voice masks");
 
 class Para: public IConverter {
 public:
+    Para();
+
     void reset(void);
     void note_on(uint8_t channel, uint8_t note, uint8_t velocity);
     void note_off(uint8_t channel, uint8_t note, uint8_t velocity);
-    float get_freq(uint8_t voice);
+    int32_t get_pitch(uint8_t voice);
+    void update(uint32_t now_us);
     bool get_gate();
 
 private:
@@ -28,9 +42,20 @@ private:
     uint32_t m_voice_millis[VOICES];
     bool m_reset;
 
+    // Voices of each note, kept in sync with m_notes by m_set_note(), and the
+    // voices whose key is held. Lookups by note don't need to scan the voices.
+    voice_mask m_note_voices[MIDI_NOTES];
+    voice_mask m_held_voices = 0;
+
+    // Each voice glides from its last note to the next one it gets
+    Glide m_glides[VOICES];
+    int m_glide_notes[VOICES];
+
     int m_find_voice();
+    void m_set_note(int voice, int note);
     bool m_last_note_playing(int note);
     void m_distribute_notes();
+    void m_glide_voices();
     void m_debug();
 };
 
@@ -0,0 +1,115 @@
+#include "dac_output.h"
+
+void DacOutput::init() {
+    spi_init(DAC_SPI_PORT, DAC_SPI_BAUDRATE);
+    spi_set_format(DAC_SPI_PORT, 16, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+    gpio_set_function(GP_DAC_SCK, GPIO_FUNC_SPI);
+    gpio_set_function(GP_DAC_MOSI, GPIO_FUNC_SPI);
+    gpio_set_function(GP_DAC_CS, GPIO_FUNC_SPI);
+
+    for (int tick = 0; tick < DAC_TICKS; tick++) {
+        m_frames[tick][0] = DAC_FRAME_ACTIVE;
+        m_frames[tick][1] = m_filter_mod_frame;
+        m_tick_frames[tick] = m_frames[tick];
+    }
+
+    // The DMA timer runs at sys clock * 1 / (sys clock / rate)
+    static_assert(SYS_CLOCK_HZ / ENVELOPE_RATE_HZ <= 0xffff, "ENVELOPE_RATE_HZ is too low");
+    int timer = dma_claim_unused_timer(true);
+    dma_timer_set_fraction(timer, 1, SYS_CLOCK_HZ / ENVELOPE_RATE_HZ);
+
+    m_ctrl_channel = dma_claim_unused_channel(true);
+    m_data_channel = dma_claim_unused_channel(true);
+
+    // Data channel: sends the two frames of a tick as fast as the SPI takes
+    // them. It's started by the control channel writing its read address.
+    dma_channel_config config = dma_channel_get_default_config(m_data_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, spi_get_dreq(DAC_SPI_PORT, true));
+    dma_channel_configure(m_data_channel, &config, &spi_get_hw(DAC_SPI_PORT)->dr, m_frames, 2, false);
+
+    // Control channel: on every timer tick writes the address of the next
+    // frames to the data channel's read address trigger register
+    config = dma_channel_get_default_config(m_ctrl_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_ring(&config, false, __builtin_ctz(sizeof(m_tick_frames)));
+    channel_config_set_dreq(&config, dma_get_timer_dreq(timer));
+    dma_channel_configure(m_ctrl_channel, &config, &dma_channel_hw_addr(m_data_channel)->al3_read_addr_trig,
+                          m_tick_frames, 0xffffffff, false);
+
+    m_start();
+}
+
+/**
+ * Returns true if DMA has moved on to the next block, ie. the block after it
+ * can be rendered.
+*/
+bool DacOutput::needs_block() {
+    // Max transfer count lasts for days, but restart if it's finished
+    if (!dma_channel_is_busy(m_ctrl_channel)) {
+        m_start();
+    }
+
+    return m_playing_block() == m_rendered_block;
+}
+
+/**
+ * Renders the block that DMA plays next: a linear ramp from the last envelope
+ * value to the given one. If the envelope doesn't move and the block already
+ * has this value then there's nothing to do.
+*/
+void DacOutput::render_block(uint16_t envelope) {
+    m_rendered_block ^= 1;
+
+    int32_t from = m_envelope;
+    m_envelope = envelope;
+
+    if (from == envelope && m_block_envelope[m_rendered_block] == envelope) return;
+    if (from != envelope) {
+        RECORD_OUTPUT(RECORD_ENVELOPE, 0, envelope);
+    }
+
+    uint16_t (*frames)[2] = &m_frames[m_rendered_block * ENVELOPE_BLOCK_SIZE];
+    int32_t step = (int32_t)envelope - from;
+
+    for (int i = 0; i < ENVELOPE_BLOCK_SIZE; i++) {
+        int32_t value = from + step * (i + 1) / ENVELOPE_BLOCK_SIZE;
+        frames[i][0] = DAC_FRAME_ACTIVE | (value & DAC_FRAME_VALUE_MASK);
+        frames[i][1] = m_filter_mod_frame;
+    }
+
+    m_block_envelope[m_rendered_block] = (from == envelope) ? envelope : -1;
+}
+
+/**
+ * Sets channel B. All the frames are updated right away, so the new value is
+ * sent on the next tick.
+*/
+void DacOutput::set_filter_mod(uint16_t value) {
+    uint16_t frame = DAC_FRAME_CHANNEL_B | DAC_FRAME_ACTIVE | (value & DAC_FRAME_VALUE_MASK);
+    if (frame == m_filter_mod_frame) return;
+    m_filter_mod_frame = frame;
+    RECORD_OUTPUT(RECORD_FILTER_MOD, 0, value & DAC_FRAME_VALUE_MASK);
+
+    for (int tick = 0; tick < DAC_TICKS; tick++) {
+        m_frames[tick][1] = frame;
+    }
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+void DacOutput::m_start() {
+    dma_channel_set_read_addr(m_ctrl_channel, m_tick_frames, false);
+    dma_channel_set_trans_count(m_ctrl_channel, 0xffffffff, true);
+}
+
+int DacOutput::m_playing_block() {
+    uint32_t offset = dma_channel_hw_addr(m_ctrl_channel)->read_addr - (uintptr_t)m_tick_frames;
+    return (offset / sizeof(uint16_t *)) / ENVELOPE_BLOCK_SIZE;
+}
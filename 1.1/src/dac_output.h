@@ -0,0 +1,66 @@
+#ifndef _DAC_OUTPUT_H
+#define _DAC_OUTPUT_H
+
+/**
+ * MCP48X2 output
+ *
+ * Both DAC channels are streamed by DMA at a fixed rate (ENVELOPE_RATE_HZ):
+ * on every tick of a DMA timer a control channel triggers the data channel
+ * which sends a channel A (envelope) and a channel B (filter mod) frame to the
+ * SPI in one burst. The CPU never waits for the SPI.
+ *
+ * The frames are in a ring of two blocks: while DMA plays one block the other
+ * one can be rendered. Each block ramps from the previous envelope value to the
+ * current one, so the output is smooth and its rate doesn't depend on the main
+ * loop. The envelope is only sampled once per block, the frames in between are
+ * interpolated. Channel B is just the last value set.
+ *
+ * The SPI runs in 16 bit mode with the hardware chip select, which goes high
+ * between frames, so each frame is a complete DAC write.
+ */
+
+#include <inttypes.h>
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "settings.h"
+#include "pitch.h"
+#include "recorder.h"
+
+// MCP48X2 frame: [15] channel, [13] gain (0 = x2), [12] active, [11:0] value
+#define DAC_FRAME_CHANNEL_B     (1 << 15)
+#define DAC_FRAME_ACTIVE        (1 << 12)
+#define DAC_FRAME_VALUE_MASK    0xfff
+#define DAC_TICKS               (2 * ENVELOPE_BLOCK_SIZE)
+
+class DacOutput {
+public:
+    void init();
+
+    bool needs_block();
+    void render_block(uint16_t envelope);
+    void set_filter_mod(uint16_t value);
+
+private:
+    // Channel A and B frame of each tick
+    uint16_t m_frames[DAC_TICKS][2];
+
+    // The control channel reads the address of the frames of each tick from
+    // here as a ring, so it must be aligned to its size
+    const uint16_t *m_tick_frames[DAC_TICKS] __attribute__((aligned(DAC_TICKS * sizeof(uint16_t *))));
+
+    uint m_ctrl_channel;
+    uint m_data_channel;
+    int m_rendered_block = 0;
+    uint16_t m_envelope = 0;
+    uint16_t m_filter_mod_frame = DAC_FRAME_CHANNEL_B | DAC_FRAME_ACTIVE;
+
+    // Last value written to the envelope frames of each block, -1 if they're
+    // not constant. Constant blocks are not rendered again.
+    int32_t m_block_envelope[2] = {0, 0};
+
+    void m_start();
+    int m_playing_block();
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "dco_stream.h"
+
+void DcoStream::init() {
+    for (int voice = 0; voice < VOICES; voice++) {
+        PIO pio = settings.pio[settings.voice_to_pio[voice]];
+        uint sm = settings.voice_to_sm[voice];
+
+        m_channels[voice] = dma_claim_unused_channel(true);
+
+        dma_channel_config config = dma_channel_get_default_config(m_channels[voice]);
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+        channel_config_set_read_increment(&config, true);
+        channel_config_set_write_increment(&config, false);
+        channel_config_set_ring(&config, false, __builtin_ctz(sizeof(m_divisors[voice])));
+        channel_config_set_dreq(&config, pio_get_dreq(pio, sm, true));
+        dma_channel_configure(m_channels[voice], &config, &pio->txf[sm], m_divisors[voice], 0, false);
+    }
+}
+
+/**
+ * Starts streaming a constant divisor to the voice, from the first block.
+ * The state machine should be restarted too, otherwise it plays what's left
+ * in its FIFO first.
+*/
+void DcoStream::start(uint8_t voice, uint32_t divisor) {
+    for (int i = 0; i < DCO_STREAM_SIZE; i++) {
+        m_divisors[voice][i] = divisor;
+    }
+    m_divisor[voice] = divisor;
+    m_rendered_end[voice] = DCO_STREAM_BLOCK;
+
+    dma_channel_set_read_addr(m_channels[voice], m_divisors[voice], false);
+    dma_channel_set_trans_count(m_channels[voice], 0xffffffff, true);
+}
+
+void DcoStream::stop(uint8_t voice) {
+    dma_channel_abort(m_channels[voice]);
+}
+
+/**
+ * Returns true if DMA has moved on to the last rendered block of the voice,
+ * ie. the block after it can be rendered. Also true if DMA is already past it
+ * (underrun).
+*/
+bool DcoStream::needs_block(uint8_t voice) {
+    return (int32_t)(m_read_count(voice) - (m_rendered_end[voice] - DCO_STREAM_BLOCK)) >= 0;
+}
+
+/**
+ * Renders the next block of the voice: a linear ramp from the last divisor to
+ * the given one. Words of the fractional program can't be interpolated (the
+ * low bits are a dither pattern) so those are just set at the start of the
+ * block.
+ *
+ * If DMA is already past the rendered block it has been playing the old
+ * blocks again. Then all of the ring is set to the divisor, and the block
+ * after the one playing now is the next one to render.
+*/
+void DcoStream::render_block(uint8_t voice, uint32_t divisor) {
+    uint32_t read = m_read_count(voice);
+    if ((int32_t)(read - m_rendered_end[voice]) >= 0) {
+        m_underruns++;
+        for (int i = 0; i < DCO_STREAM_SIZE; i++) {
+            m_divisors[voice][i] = divisor;
+        }
+        m_divisor[voice] = divisor;
+        m_rendered_end[voice] = (read / DCO_STREAM_BLOCK + 1) * DCO_STREAM_BLOCK;
+        return;
+    }
+
+    int32_t from = m_divisor[voice];
+    m_divisor[voice] = divisor;
+
+    uint32_t *divisors = &m_divisors[voice][m_rendered_end[voice] % DCO_STREAM_SIZE];
+    m_rendered_end[voice] += DCO_STREAM_BLOCK;
+    int32_t step = (int32_t)divisor - from;
+
+    for (int i = 0; i < DCO_STREAM_BLOCK; i++) {
+        if (DCO_FRACTIONAL || from == 0 || divisor == 0) {
+            divisors[i] = divisor;
+        } else {
+            divisors[i] = from + step * (i + 1) / DCO_STREAM_BLOCK;
+        }
+    }
+}
+
+uint32_t DcoStream::take_underruns() {
+    uint32_t underruns = m_underruns;
+    m_underruns = 0;
+    return underruns;
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+/**
+ * The transfer count of the channel counts down from 0xffffffff, set by
+ * start()
+*/
+uint32_t DcoStream::m_read_count(uint8_t voice) {
+    return 0xffffffff - dma_channel_hw_addr(m_channels[voice])->transfer_count;
+}
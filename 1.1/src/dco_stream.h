@@ -0,0 +1,70 @@
+#ifndef _DCO_STREAM_H
+#define _DCO_STREAM_H
+
+/**
+ * DCO modulation stream
+ *
+ * Each DCO state machine is fed by its own DMA channel, paced by the TX DREQ
+ * of the state machine, from a small ring of divisors. The state machine takes
+ * a divisor at the start of every period, so the ring plays one divisor per
+ * oscillator period without any CPU work per step.
+ *
+ * Like the DAC output, the ring of each voice is two blocks: while DMA plays
+ * one, the other one is rendered as a ramp from the last divisor to the new
+ * one. Modulations (pitch bend, glide) are smoothed over the periods of a
+ * block this way.
+ *
+ * The TX FIFO is always kept full, so a new divisor is heard only after the
+ * periods in the FIFO and the ring (12 by default). Note changes don't go
+ * through the stream, they restart the voice (see start()).
+ *
+ * The limits are in periods, not in time:
+ * - Latency of a modulation is 12 periods, ie. 6ms at 2kHz but 440ms at the
+ *   lowest note (A0, 27.5Hz).
+ * - A block must last longer than the gap between two output ticks, ie.
+ *   DCO_STREAM_BLOCK periods > OUTPUT_TICK_US plus the tick's jitter. Above
+ *   16kHz, or at lower notes if the output tick is late, DMA runs past the
+ *   rendered block and would replay old divisors. This is detected on the next
+ *   render, counted as an underrun, and the whole ring is set to the new
+ *   divisor (no ramp) so the stale block isn't played again.
+ */
+
+#include <inttypes.h>
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "settings.h"
+
+// Must be a power of two
+#define DCO_STREAM_SIZE     8
+#define DCO_STREAM_BLOCK    (DCO_STREAM_SIZE / 2)
+
+class DcoStream {
+public:
+    void init();
+
+    void start(uint8_t voice, uint32_t divisor);
+    void stop(uint8_t voice);
+
+    bool needs_block(uint8_t voice);
+    void render_block(uint8_t voice, uint32_t divisor);
+
+    // Blocks that DMA got to before they were rendered since the last call
+    uint32_t take_underruns();
+
+private:
+    // DMA reads the divisors of each voice as a ring, so each one must be
+    // aligned to its size
+    uint32_t m_divisors[VOICES][DCO_STREAM_SIZE] __attribute__((aligned(DCO_STREAM_SIZE * sizeof(uint32_t))));
+
+    uint m_channels[VOICES];
+    uint32_t m_divisor[VOICES];
+
+    // Divisors read by DMA (since start()) at the end of the last rendered
+    // block
+    uint32_t m_rendered_end[VOICES];
+    uint32_t m_underruns = 0;
+
+    uint32_t m_read_count(uint8_t voice);
+};
+
+#endif
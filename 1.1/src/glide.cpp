@@ -0,0 +1,56 @@
+#include "glide.h"
+
+/**
+ * Sets the glide time: per semitone, or of the whole glide if fixed_time is
+ * true. Takes effect from the next glide.
+*/
+void Glide::set_time(uint32_t time_us, bool fixed_time) {
+    m_time_us = time_us;
+    m_fixed_time = fixed_time;
+}
+
+/**
+ * Starts gliding from the current pitch (even if it's in the middle of a
+ * glide) to the given one.
+*/
+void Glide::start(int32_t to, uint32_t now_us) {
+    m_from = m_pitch;
+    m_to = to;
+    m_start_us = now_us;
+    m_tick = 0;
+
+    uint32_t distance = (to > m_from) ? to - m_from : m_from - to;
+    uint64_t time_us = m_fixed_time ? m_time_us : (uint64_t)m_time_us * distance / CENTS_PER_NOTE;
+    m_ticks = time_us / GLIDE_TICK_US;
+
+    m_gliding = (m_ticks > 0 && distance > 0);
+    if (!m_gliding) m_pitch = to;
+}
+
+/**
+ * Sets the pitch without gliding
+*/
+void Glide::jump(int32_t pitch) {
+    m_from = m_to = m_pitch = pitch;
+    m_gliding = false;
+}
+
+/**
+ * Returns the pitch at the given time. It only changes once per control tick.
+*/
+int32_t Glide::update(uint32_t now_us) {
+    if (!m_gliding) return m_pitch;
+
+    uint32_t tick = (now_us - m_start_us) / GLIDE_TICK_US;
+    if (tick == m_tick) return m_pitch;
+    m_tick = tick;
+
+    if (tick >= m_ticks) {
+        m_pitch = m_to;
+        m_gliding = false;
+    } else {
+        m_pitch = m_from + (int32_t)((int64_t)(m_to - m_from) * tick / m_ticks);
+    }
+
+    return m_pitch;
+}
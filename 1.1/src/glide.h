@@ -0,0 +1,47 @@
+#ifndef _GLIDE_H
+#define _GLIDE_H
+
+/**
+ * Glide (portamento)
+ *
+ * Moves a pitch linearly in cents (ie. exponentially in frequency) from one
+ * pitch to another. The position is calculated from the time elapsed since
+ * the glide started, in steps of a fixed control rate (GLIDE_RATE_HZ), so the
+ * glide time doesn't depend on how often update() is called. The start and
+ * target pitches are kept, a step is just an integer multiply and divide.
+ *
+ * The time is either per semitone (constant rate, longer glides for larger
+ * intervals) or for the whole glide (constant time).
+ */
+
+#include <inttypes.h>
+#include "settings.h"
+#include "pitch.h"
+
+#define GLIDE_TICK_US       (1000000 / GLIDE_RATE_HZ)
+
+class Glide {
+public:
+    void set_time(uint32_t time_us, bool fixed_time);
+
+    void start(int32_t to, uint32_t now_us);
+    void jump(int32_t pitch);
+    int32_t update(uint32_t now_us);
+
+    bool is_gliding() { return m_gliding; }
+    int32_t get_pitch() { return m_pitch; }
+
+private:
+    uint32_t m_time_us = PORTAMENTO_TIME_US;
+    bool m_fixed_time = PORTAMENTO_FIXED_TIME;
+
+    int32_t m_from = 0;
+    int32_t m_to = 0;
+    int32_t m_pitch = 0;
+    uint32_t m_start_us = 0;
+    uint32_t m_ticks = 0;
+    uint32_t m_tick = 0;
+    bool m_gliding = false;
+};
+
+#endif
@@ -8,10 +8,10 @@
 
 #include <inttypes.h>
 #include "settings.h"
+#include "pitch.h"
 
 #define MAX_PITCH_BEND      0x3fff
 #define PITCH_BEND_CENTER   0x2000
-#define BASE_NOTE           440.0f
 
 // const uint16_t DIV_COUNTER = 1250;
 
@@ -23,7 +23,10 @@ class IConverter {
         virtual void note_off(uint8_t channel, uint8_t note, uint8_t velocity) { }
         virtual void note_on(uint8_t channel, uint8_t note, uint8_t velocity) { }
         virtual void mod_wheel(uint8_t channel, uint8_t value) { }
-        virtual float get_freq(uint8_t voice) { return 0; }
+        virtual int32_t get_pitch(uint8_t voice) { return PITCH_OFF; }
+
+        // Moves glides forward, called at GLIDE_RATE_HZ while dirty
+        virtual void update(uint32_t now_us) { }
         virtual bool get_gate() { return false; }
 
         // TODO: implement this. Should return true if it should update the output
@@ -33,8 +36,6 @@ class IConverter {
         virtual void set_main_velocity(uint8_t main_velocity) { m_main_velocity = main_velocity; }
         virtual uint8_t get_main_velocity() { return m_main_velocity; }
 
-        float frequency_from_midi_note(int note);
-        uint16_t amp_for_frequency(float freq);
         void update_pitch_bend(uint16_t bend);
 
 
@@ -0,0 +1,57 @@
+#include "lfo.h"
+
+/**
+ * Moves the LFO forward by the control ticks elapsed since the last update.
+ * Returns true if the output value changed.
+*/
+bool Lfo::update(uint32_t now_us) {
+    uint32_t ticks = (now_us - m_last_us) / LFO_TICK_US;
+    if (ticks == 0) return false;
+    m_last_us += ticks * LFO_TICK_US;
+
+    uint32_t phase = m_phase + m_increment * ticks;
+    bool wrapped = phase < m_phase || ticks * (uint64_t)m_increment > 0xffffffff;
+    m_phase = phase;
+
+    int16_t value = 0;
+    switch (m_shape) {
+    case LFO_SINE:
+        value = m_sine(phase);
+        break;
+    case LFO_TRIANGLE:
+        // Rising in the first half, falling in the second
+        value = (int32_t)((phase < 0x80000000 ? phase : ~phase) >> 15) - 0x8000;
+        break;
+    case LFO_SAW:
+        value = (int16_t)((phase >> 16) - 0x8000);
+        break;
+    case LFO_SQUARE:
+        value = phase < 0x80000000 ? LFO_MAX : -LFO_MAX;
+        break;
+    case LFO_RANDOM:
+        // Sample and hold: a new value on every cycle (xorshift)
+        if (wrapped) {
+            m_random ^= m_random << 13;
+            m_random ^= m_random >> 17;
+            m_random ^= m_random << 5;
+        }
+        value = (int16_t)(m_random >> 16);
+        break;
+    }
+
+    if (value == m_value) return false;
+    m_value = value;
+    return true;
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+int16_t Lfo::m_sine(uint32_t phase) {
+    uint32_t index = phase >> 24;
+    int32_t fraction = (phase >> 16) & 0xff;
+    int32_t a = lfo_tables.sine[index];
+    int32_t b = lfo_tables.sine[index + 1];
+    return (int16_t)(a + (((b - a) * fraction) >> 8));
+}
@@ -0,0 +1,90 @@
+#ifndef _LFO_H
+#define _LFO_H
+
+/**
+ * LFO
+ *
+ * Fixed point LFO running at a fixed control rate (LFO_RATE_HZ). The phase is
+ * a 32 bit accumulator and the output is a signed 16 bit value. The sine is a
+ * table lookup with linear interpolation, the other shapes are computed from
+ * the phase, so a tick is only a few integer operations.
+ *
+ * Rates (0-127, like a CC value) are mapped exponentially from LFO_MIN_RATE
+ * over LFO_RATE_OCTAVES, the phase increments are calculated at compile time.
+ */
+
+#include <inttypes.h>
+#include "settings.h"
+
+#define LFO_TICK_US         (1000000 / LFO_RATE_HZ)
+#define LFO_SINE_TABLE_SIZE 256
+#define LFO_MAX             32767
+
+enum lfo_shape {
+    LFO_SINE,
+    LFO_TRIANGLE,
+    LFO_SAW,
+    LFO_SQUARE,
+    LFO_RANDOM
+};
+
+#define NO_OF_LFO_SHAPES 5
+
+struct LfoTables {
+    int16_t sine[LFO_SINE_TABLE_SIZE + 1];
+    uint32_t increment[128];
+
+    constexpr LfoTables(): sine(), increment() {
+        const double pi = 3.141592653589793;
+        const double ln2 = 0.6931471805599453;
+
+        // sin() is not constexpr, use a Taylor series
+        for (int i = 0; i <= LFO_SINE_TABLE_SIZE; i++) {
+            double x = 2 * pi * i / LFO_SINE_TABLE_SIZE;
+            if (x > pi) x -= 2 * pi;
+            double term = x, sum = x;
+            for (int n = 1; n < 12; n++) {
+                term *= -x * x / ((2 * n) * (2 * n + 1));
+                sum += term;
+            }
+            sine[i] = (int16_t)(sum * LFO_MAX + (sum < 0 ? -0.5 : 0.5));
+        }
+
+        // Ratio of two neighbouring rates: 2^(octaves / 127)
+        double x = ln2 * LFO_RATE_OCTAVES / 127;
+        double term = 1.0, step = 1.0;
+        for (int n = 1; n < 20; n++) {
+            term *= x / n;
+            step += term;
+        }
+
+        double rate = LFO_MIN_RATE;
+        for (int i = 0; i < 128; i++) {
+            increment[i] = (uint32_t)(rate / LFO_RATE_HZ * 4294967296.0);
+            rate *= step;
+        }
+    }
+};
+
+inline constexpr LfoTables lfo_tables;
+
+class Lfo {
+public:
+    void set_rate(uint8_t rate) { m_increment = lfo_tables.increment[rate & 0x7f]; }
+    void set_shape(lfo_shape shape) { m_shape = shape; }
+
+    bool update(uint32_t now_us);
+    int16_t get_value() { return m_value; }
+
+private:
+    lfo_shape m_shape = LFO_SINE;
+    uint32_t m_phase = 0;
+    uint32_t m_increment = lfo_tables.increment[LFO_DEFAULT_RATE];
+    uint32_t m_last_us = 0;
+    uint32_t m_random = 1;
+    int16_t m_value = 0;
+
+    int16_t m_sine(uint32_t phase);
+};
+
+#endif
@@ -12,16 +12,72 @@
  *
  * Classes
  * -------
- *      Synth: MidiParser
+ *      Synth: BatchMidiParser
  *          - parses incoming MIDI data
  *          - updates DCO frequencies and amp levels
+ *          - the control side (MIDI, converters) and the output side (DCOs,
+ *            envelope) can run on separate cores, see ENABLE_DUAL_CORE
+ *
+ *      Scheduler
+ *          - cooperative scheduler of the tasks on each core, with periods,
+ *            deadlines and priorities
+ *
+ *      MidiInput
+ *          - collects incoming MIDI bytes in the UART interrupt
+ *
+ *      BatchMidiParser: MidiParser
+ *          - parses a buffer of MIDI bytes in one go, with running status
+ *
+ *      DacOutput
+ *          - streams the envelope and filter mod to the DAC with DMA at a
+ *            fixed rate
+ *
+ *      DcoStream
+ *          - optionally feeds the DCO divisors with DMA, one per oscillator
+ *            period, see ENABLE_DCO_STREAM
+ *
+ *      Glide
+ *          - time based portamento in cents, used by the converters
+ *
+ *      Lfo
+ *          - fixed point LFO, modulates the pitch and/or the filter mod
  *
  *      IConverter
  *          - interface for different converters (modes). Converter
  *            implementations are in ./converters
  *
  *      UI
- *          - handles the interface, LEDs and stuff
+ *          - handles the interface, LEDs and stuff. Scanned by a repeating
+ *            timer, independent of the main loop
+ *
+ *      AdcInput
+ *          - samples the pots in the background with DMA, smoothed and with
+ *            hysteresis
+ *
+ *      OutputRecorder
+ *          - sends every output value over USB to compare the behaviour of
+ *            builds, see ENABLE_OUTPUT_RECORDER
+ *
+ *      SmfPlayer
+ *          - plays MIDI files streamed over USB through the MIDI input, see
+ *            ENABLE_SMF_PLAYER
+ *
+ *      SmfTrackParser
+ *          - parses a track of a MIDI file byte by byte, for the player and
+ *            the host replay tool (tests/tools/smf_replay.cpp)
+ *
+ *      Benchmark
+ *          - runs MIDI workloads on the converters and the synth at boot and
+ *            prints their cost, see ENABLE_BENCHMARK
+ *
+ *      Profiler
+ *          - times the main stages and the MIDI to output latency and
+ *            reports them over USB, see ENABLE_PROFILER and
+ *            ENABLE_LATENCY_TRACE
+ *
+ *      UsbWriter
+ *          - non-blocking USB output of the profiler and the recorder, one
+ *            buffer at a time
  *
  * @TODO:
  *
@@ -44,12 +100,12 @@
  */
 #include "pico/stdlib.h"
 #include "pico/binary_info.h"
+#include "pico/multicore.h"
 #include "hardware/gpio.h"
 #include "hardware/spi.h"
 #include "hardware/uart.h"
 #include "hardware/pio.h"
 #include "hardware/clocks.h"
-#include "frequency.pio.h"
 
 /*
  * Custom libraries
@@ -61,6 +117,12 @@
  */
 #include "ui.h"
 #include "synth.h"
+#include "scheduler.h"
+#include "profiler.h"
+#include "recorder.h"
+#include "usb_writer.h"
+#include "benchmark.h"
+#include "smf_player.h"
 #include "settings.h"
 
 /**
@@ -73,22 +135,62 @@ UI &ui = UI::get_instance();
 PIO pio = pio0;
 uint sm = pio_claim_unused_sm(pio, true);
 
+/**
+ * Both cores run a cooperative scheduler. Core 0 runs the control side (MIDI,
+ * UI events, glide) and telemetry, core 1 the output side (DCOs, envelope,
+ * mods). Without ENABLE_DUAL_CORE everything runs on core 0.
+*/
+Scheduler core0_scheduler;
+Scheduler core1_scheduler;
+
+void report() {
+    // Don't print in the middle of the profiler's or the recorder's text
+    UsbWriter::get_instance().finish();
+
+    core0_scheduler.print_stats("core0");
+    if (ENABLE_DUAL_CORE) {
+        core1_scheduler.print_stats("core1");
+    }
+
+    printf("Pitch mod time: %luus/s (DCO stream %s)\n", synth.take_mod_time_us(), ENABLE_DCO_STREAM ? "on" : "off");
+    if (ENABLE_DCO_STREAM) {
+        printf("DCO stream underruns: %lu\n", synth.take_dco_underruns());
+    }
+    printf("Max glide step: %luus\n", synth.take_max_glide_time_us());
+
+    ui_scan_stats scan = ui.take_scan_stats();
+    printf("UI scans: %lu, interval: %lu-%luus, max scan: %luus\n",
+           scan.scans, scan.min_interval_us, scan.max_interval_us, scan.max_time_us);
+}
+
+void add_output_task(Scheduler &scheduler) {
+    scheduler.add_task("output", []() { synth.process_output(); }, OUTPUT_TICK_US, OUTPUT_TICK_US, 0,
+                       []() { return synth.has_output_events(); });
+}
+
+/**
+ * Core 1 only runs the output side of the synth
+*/
+void core1_main() {
+    if (ENABLE_PROFILER) {
+        Profiler::get_instance().init_core();
+    }
+
+    add_output_task(core1_scheduler);
+    core1_scheduler.run();
+}
+
 int main() {
     stdio_init_all();
 
     printf("\n\n--- SHMØERGH FUNK LIVE ONE ---\r\n\n");
 
-    // Init PIOs: they must be initialised here in main.cpp
-    uint offset[2];
-    offset[0] = pio_add_program(settings.pio[0], &frequency_program);
-    offset[1] = pio_add_program(settings.pio[1], &frequency_program);
-
-    for (int i = 0; i < VOICES; i++) {
-        init_sm_pin(settings.pio[settings.voice_to_pio[i]],
-                    settings.voice_to_sm[i],
-                    offset[settings.voice_to_pio[i]],
-                    settings.reset_pins[i]);
-        pio_sm_set_enabled(settings.pio[settings.voice_to_pio[i]], settings.voice_to_sm[i], true);
+    if (ENABLE_PROFILER) {
+        Profiler::get_instance().init_core();
+    }
+
+    if (PRINT_TUNING_REPORT) {
+        Pitch::print_tuning_report();
     }
 
     // Initialise UI
@@ -102,6 +204,11 @@ int main() {
     synth.init(PARA);
     synth.init_dcos();
 
+    // Before core 1 is started, the benchmark runs the output side too
+    if (ENABLE_BENCHMARK) {
+        Benchmark::run();
+    }
+
     // Test -------------------------------
     // synth.set_adsr(false, true, false);
     // synth.set_solo(false);
@@ -111,11 +218,39 @@ int main() {
     // synth.set_velo_tracking(true);
     // ------------------------------------
 
-    // Main update loop
-    while (1) {
-        ui.scan();
-        synth.process();
+    if (ENABLE_DUAL_CORE) {
+        multicore_launch_core1(core1_main);
     }
 
+    // Main update loop. MIDI has the highest priority, that's where the
+    // latency is heard.
+    core0_scheduler.add_task("midi", []() { synth.process_midi(); }, 0, 0, 0,
+                             []() { return synth.has_midi(); });
+    core0_scheduler.add_task("ui", []() { synth.process_ui(); }, 0, 0, 2,
+                             []() { return synth.has_ui_events(); });
+    core0_scheduler.add_task("glide", []() { synth.process_glide(); }, GLIDE_TICK_US, GLIDE_TICK_US / 2, 2);
+
+    if (!ENABLE_DUAL_CORE) {
+        add_output_task(core0_scheduler);
+    }
+
+    if (ENABLE_SMF_PLAYER) {
+        core0_scheduler.add_task("smf", []() { SmfPlayer::get_instance().process(); }, 500, 500, 1);
+    }
+
+    if (ENABLE_PROFILER || ENABLE_LATENCY_TRACE) {
+        core0_scheduler.add_task("profiler", []() { Profiler::get_instance().process(); }, 10000, 10000, 9);
+    }
+
+    if (ENABLE_OUTPUT_RECORDER) {
+        core0_scheduler.add_task("recorder", []() { OutputRecorder::get_instance().process(); }, 2000, 2000, 8);
+    }
+
+    if (DEBUG_LOOP_JITTER) {
+        core0_scheduler.add_task("report", report, 1000000, 1000000, 9);
+    }
+
+    core0_scheduler.run();
+
     return 0;
 }
@@ -0,0 +1,115 @@
+#include "midi_input.h"
+
+void MidiInput::init() {
+    uart_init(MIDI_UART_INSTANCE, MIDI_BAUDRATE);
+    gpio_set_function(GP_MIDI_RX, GPIO_FUNC_UART);
+
+    // Without the FIFO the interrupt fires on every byte instead of waiting for
+    // the FIFO level or the RX timeout (32 bit periods, ~1ms at MIDI speed).
+    uart_set_fifo_enabled(MIDI_UART_INSTANCE, false);
+
+    irq_set_exclusive_handler(MIDI_UART_IRQ, m_on_uart_rx);
+    irq_set_enabled(MIDI_UART_IRQ, true);
+    uart_set_irq_enables(MIDI_UART_INSTANCE, true, false);
+}
+
+/**
+ * Reads the next byte from the ring buffer. Returns false if there's nothing
+ * to read. Only call it from the main loop.
+*/
+bool MidiInput::read(uint8_t &byte) {
+    uint32_t time;
+    return read(byte, time);
+}
+
+/**
+ * Same as above, with the receive time of the byte (Profiler::midi_time()) if
+ * ENABLE_LATENCY_TRACE is on, otherwise 0.
+*/
+bool MidiInput::read(uint8_t &byte, uint32_t &time) {
+    uint32_t tail = m_tail;
+    if (tail == m_head) return false;
+
+    // Make sure the byte is read only after the IRQ published it
+    __mem_fence_acquire();
+    byte = m_buffer[tail & (MIDI_RX_BUFFER_SIZE - 1)];
+    time = ENABLE_LATENCY_TRACE ? m_times[tail & (MIDI_RX_BUFFER_SIZE - 1)] : 0;
+    m_tail = tail + 1;
+    return true;
+}
+
+size_t MidiInput::peek(const uint8_t *&data) {
+    uint32_t tail = m_tail;
+    uint32_t available = m_head - tail;
+    if (!available) return 0;
+
+    __mem_fence_acquire();
+    uint32_t index = tail & (MIDI_RX_BUFFER_SIZE - 1);
+    data = &m_buffer[index];
+
+    // The rest is at the start of the ring, it's read on the next call
+    if (available > MIDI_RX_BUFFER_SIZE - index) {
+        available = MIDI_RX_BUFFER_SIZE - index;
+    }
+    return available;
+}
+
+void MidiInput::consume(size_t count) {
+    m_tail = m_tail + count;
+}
+
+size_t MidiInput::inject(const uint8_t *data, size_t length) {
+    size_t injected = 0;
+
+    while (injected < length) {
+        uint32_t interrupts = save_and_disable_interrupts();
+        uint32_t head = m_head;
+        if (head - m_tail >= MIDI_RX_BUFFER_SIZE) {
+            restore_interrupts(interrupts);
+            break;
+        }
+
+        m_buffer[head & (MIDI_RX_BUFFER_SIZE - 1)] = data[injected++];
+        if (ENABLE_LATENCY_TRACE) {
+            m_times[head & (MIDI_RX_BUFFER_SIZE - 1)] = Profiler::midi_time();
+        }
+
+        __mem_fence_release();
+        m_head = head + 1;
+        restore_interrupts(interrupts);
+    }
+
+    return injected;
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+void __not_in_flash_func(MidiInput::m_on_uart_rx)() {
+    MidiInput &input = get_instance();
+    uart_hw_t *uart = uart_get_hw(MIDI_UART_INSTANCE);
+    uint32_t time = ENABLE_LATENCY_TRACE ? Profiler::midi_time() : 0;
+
+    while (uart_is_readable(MIDI_UART_INSTANCE)) {
+        uint32_t data = uart->dr;
+        if (data & UART_UARTDR_OE_BITS) {
+            input.m_dropped++;
+        }
+
+        uint32_t head = input.m_head;
+        if (head - input.m_tail >= MIDI_RX_BUFFER_SIZE) {
+            input.m_dropped++;
+            continue;
+        }
+
+        input.m_buffer[head & (MIDI_RX_BUFFER_SIZE - 1)] = data & UART_UARTDR_DATA_BITS;
+        if (ENABLE_LATENCY_TRACE) {
+            input.m_times[head & (MIDI_RX_BUFFER_SIZE - 1)] = time;
+        }
+
+        // Publish the byte before moving the head
+        __mem_fence_release();
+        input.m_head = head + 1;
+    }
+}
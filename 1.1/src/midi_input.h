@@ -0,0 +1,74 @@
+#ifndef _MIDI_INPUT_H
+#define _MIDI_INPUT_H
+
+/**
+ * MIDI receive path
+ *
+ * The UART RX interrupt moves every incoming byte into a single-producer/
+ * single-consumer ring buffer (the IRQ is the only writer of the head, the main
+ * loop is the only writer of the tail), so no locking is needed. The main loop
+ * then drains everything that's available in one go. This way a long main loop
+ * pass (UI scan, DAC writes) can't overrun the UART.
+ *
+ * With ENABLE_LATENCY_TRACE each byte is timestamped on receipt as well.
+ *
+ * Bytes can also be injected from the main loop (replay, tests). The UART IRQ
+ * runs on the same core, so it's disabled while a byte is written.
+ */
+
+#include <inttypes.h>
+#include <utils.h>
+#include "hardware/uart.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "settings.h"
+#include "profiler.h"
+
+// Must be a power of two. At 31250 baud a byte arrives every 320us, so 256
+// bytes is about 80ms of uninterrupted MIDI traffic.
+#define MIDI_RX_BUFFER_SIZE 256
+
+class MidiInput {
+public:
+    static MidiInput& get_instance() {
+        static MidiInput instance;
+        return instance;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(MidiInput);
+
+    void init();
+    bool read(uint8_t &byte);
+    bool read(uint8_t &byte, uint32_t &time);
+
+    // Received bytes that can be read without copying: up to the end of the
+    // ring, call consume() when they're processed. Returns 0 if there's
+    // nothing to read.
+    size_t peek(const uint8_t *&data);
+    void consume(size_t count);
+
+    // Feeds bytes as if they were received, returns the number of bytes that
+    // fit. Only call it from core 0.
+    size_t inject(const uint8_t *data, size_t length);
+    bool is_empty() { return m_head == m_tail; }
+
+    // Number of bytes lost either in the UART (overrun) or because the ring
+    // buffer was full. Should always be 0.
+    uint32_t dropped() { return m_dropped; }
+
+protected:
+    MidiInput() = default;
+
+private:
+    uint8_t m_buffer[MIDI_RX_BUFFER_SIZE];
+    uint32_t m_times[ENABLE_LATENCY_TRACE ? MIDI_RX_BUFFER_SIZE : 1];
+
+    // Free running indexes, they're only masked when accessing the buffer
+    volatile uint32_t m_head = 0;
+    volatile uint32_t m_tail = 0;
+    volatile uint32_t m_dropped = 0;
+
+    static void m_on_uart_rx();
+};
+
+#endif
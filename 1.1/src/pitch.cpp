@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <math.h>
+#include "pitch.h"
+
+/**
+ * Returns the PIO divisor (Y register value) of a pitch given in cents. Notes
+ * without modulation come from the note table, everything else from the exp2
+ * table with linear interpolation.
+*/
+uint32_t Pitch::divisor(int32_t cents) {
+    if (cents < 0) return 0;
+
+    int32_t note = cents / CENTS_PER_NOTE;
+    if (note * CENTS_PER_NOTE == cents && note < MIDI_NOTES) {
+        return note_table.divisor[note];
+    }
+
+    return m_interpolated_divisor(cents);
+}
+
+/**
+ * Amp compensation of the DCO: the integrator output gets lower with higher
+ * frequencies so the amp is proportional to the frequency, ie. inversely
+ * proportional to the half period. Same as DIV_COUNTER * freq / MAX_FREQ.
+*/
+uint16_t Pitch::amp(uint32_t divisor) {
+    if (divisor == 0) return 0;
+    return (uint32_t)(DIV_COUNTER * (SYS_CLOCK_HZ / 2 / MAX_FREQ) * 8) / dco_half_period_eighths(divisor);
+}
+
+/**
+ * Frequency in Hz, rounded down. Not meant to be used in the audio path.
+*/
+uint32_t Pitch::freq(int32_t cents) {
+    uint32_t div = divisor(cents);
+    if (div == 0) return 0;
+    return (SYS_CLOCK_HZ / 2 * 8) / dco_half_period_eighths(div);
+}
+
+/**
+ * Prints the frequency the DCOs actually play and its error in cents for all
+ * MIDI notes, both from the note table and from the exp2 table (used for
+ * modulated pitches). Uses floats, only meant for debugging at boot.
+*/
+void Pitch::print_tuning_report() {
+    printf("Tuning at %lukHz sys clock\n", (uint32_t)(SYS_CLOCK_HZ / 1000));
+    printf("note  freq [Hz]  divisor  error [c]  exp2 error [c]\n");
+
+    float max_error = 0, max_exp2_error = 0;
+    for (int note = 0; note < MIDI_NOTES; note++) {
+        float freq = 440.0f * powf(2.0f, (note - 69) / 12.0f);
+        uint32_t div = note_table.divisor[note];
+        uint32_t exp2_div = m_interpolated_divisor(from_midi_note(note));
+
+        float actual = (float)(SYS_CLOCK_HZ / 2 * 8) / dco_half_period_eighths(div);
+        float exp2_actual = (float)(SYS_CLOCK_HZ / 2 * 8) / dco_half_period_eighths(exp2_div);
+        float error = 1200.0f * log2f(actual / freq);
+        float exp2_error = 1200.0f * log2f(exp2_actual / freq);
+
+        printf("%4d %10.3f %8lu %+10.3f %+15.3f\n", note, freq, div, error, exp2_error);
+
+        if (fabsf(error) > max_error) max_error = fabsf(error);
+        if (fabsf(exp2_error) > max_exp2_error) max_exp2_error = fabsf(exp2_error);
+    }
+
+    printf("Max error: %.3fc, exp2: %.3fc\n", max_error, max_exp2_error);
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+uint32_t Pitch::m_interpolated_divisor(int32_t cents) {
+    int32_t octave = cents / CENTS_PER_OCTAVE;
+    int32_t rest = cents - octave * CENTS_PER_OCTAVE;
+
+    // rest * 64 / 1200 = rest * 4 / 75, the remainder is the position between
+    // two table entries in 1/75 steps
+    int32_t position = rest * 4;
+    int32_t index = position / 75;
+    int32_t fraction = position - index * 75;
+
+    uint32_t a = exp2_table.half_period[index];
+    uint32_t b = exp2_table.half_period[index + 1];
+    uint32_t half_period = a - (a - b) * fraction / 75;
+
+    return dco_divisor(half_period >> octave);
+}
@@ -0,0 +1,168 @@
+#ifndef _PITCH_H
+#define _PITCH_H
+
+/**
+ * Pitch
+ *
+ * Pitch is handled in cents (MIDI note * 100) everywhere, so modulations like
+ * pitch bend, detune and portamento are just integer additions. The pitch is
+ * converted to a PIO divisor only when it's sent to the DCOs, with a fixed
+ * point exp2 table.
+ *
+ * PIO divisors of all MIDI notes are generated at compile time for the
+ * configured system clock. The RP2040 doesn't have an FPU
+ * so pow() and float divisions are slow; this way a note without modulation is
+ * only a table lookup.
+ *
+ * With DCO_FRACTIONAL the divisor is a word of the frequency_frac program:
+ * the half period in [31:8] and an 8 bit dither pattern in [7:0]. Bit n set
+ * makes half period n one cycle longer, so the average half period has 1/8
+ * cycle resolution.
+ */
+
+#include <inttypes.h>
+#include "hardware/clocks.h"
+#include "settings.h"
+
+#define MIDI_NOTES          128
+#define SYS_CLOCK_HZ        (SYS_CLK_KHZ * 1000)
+#define CENTS_PER_NOTE      100
+#define CENTS_PER_OCTAVE    1200
+#define PITCH_OFF           -1          // Voice is not playing
+
+// A half period is divisor + DCO_CYCLE_OVERHEAD PIO cycles, ie. Y + 5 with
+// frequency.pio (Y + 6 with frequency_frac). Must match the programs.
+#if DCO_FRACTIONAL
+#define DCO_CYCLE_OVERHEAD  6
+#define DCO_DITHER_BITS     8           // Half periods per word
+#define DCO_REFILL_CYCLES   7           // Extra cycles of reloading the word
+#else
+#define DCO_CYCLE_OVERHEAD  5
+#endif
+
+// Max error of the note table, checked at compile time
+#define MAX_NOTE_ERROR_CENTS 0.5
+
+// Steps of the exp2 table in an octave (18.75 cents). Linear interpolation
+// between the steps is accurate to ~0.03 cent.
+#define EXP2_TABLE_SIZE     64
+
+#if DCO_FRACTIONAL
+/**
+ * Converts a half period in 1/256 cycles to a frequency_frac word. The total of
+ * DCO_DITHER_BITS half periods is rounded to a whole cycle and the remainder
+ * cycles are spread evenly over the pattern (first order sigma-delta).
+*/
+constexpr uint32_t dco_divisor(uint32_t half_period) {
+    uint32_t cycles = ((half_period + 16) >> 5) - DCO_DITHER_BITS * DCO_CYCLE_OVERHEAD - DCO_REFILL_CYCLES;
+    uint32_t rest = cycles % DCO_DITHER_BITS;
+
+    uint32_t pattern = 0, sum = 0;
+    for (int i = 0; i < DCO_DITHER_BITS; i++) {
+        sum += rest;
+        if (sum >= DCO_DITHER_BITS) {
+            sum -= DCO_DITHER_BITS;
+            pattern |= 1 << i;
+        }
+    }
+
+    return ((cycles / DCO_DITHER_BITS) << 8) | pattern;
+}
+
+/**
+ * Average half period of a divisor in 1/8 cycles
+*/
+constexpr uint32_t dco_half_period_eighths(uint32_t divisor) {
+    uint32_t cycles = ((divisor >> 8) + DCO_CYCLE_OVERHEAD) * DCO_DITHER_BITS + DCO_REFILL_CYCLES;
+    for (int i = 0; i < DCO_DITHER_BITS; i++) {
+        cycles += (divisor >> i) & 1;
+    }
+    return cycles;
+}
+#else
+constexpr uint32_t dco_divisor(uint32_t half_period) {
+    return ((half_period + 128) >> 8) - DCO_CYCLE_OVERHEAD;
+}
+
+constexpr uint32_t dco_half_period_eighths(uint32_t divisor) {
+    return (divisor + DCO_CYCLE_OVERHEAD) * 8;
+}
+#endif
+
+struct NoteTable {
+    uint32_t divisor[MIDI_NOTES];
+    double max_error_cents;
+
+    constexpr NoteTable(): divisor(), max_error_cents(0) {
+        // 2^(n/12) for one octave, pow() can't be used in a constant expression
+        const double semitones[12] = {
+            1.0, 1.0594630943592953, 1.122462048309373, 1.189207115002721,
+            1.2599210498948732, 1.3348398541700344, 1.4142135623730951,
+            1.4983070768766815, 1.5874010519681994, 1.681792830507429,
+            1.7817974362806785, 1.887748625363387
+        };
+
+        for (int note = 0; note < MIDI_NOTES; note++) {
+            // Octaves and semitones from A4 (MIDI note 69, 440Hz)
+            int octave = (note + 3) / 12 - 6;
+            int semitone = note - 69 - octave * 12;
+
+            double f = 440.0 * semitones[semitone];
+            for (int i = 0; i < octave; i++) f *= 2.0;
+            for (int i = 0; i > octave; i--) f /= 2.0;
+
+            double half_period = SYS_CLOCK_HZ / 2 / f;
+            divisor[note] = dco_divisor((uint32_t)(half_period * 256 + 0.5));
+
+            // 1200 / ln(2) * (ratio - 1), close enough for small errors
+            double actual = dco_half_period_eighths(divisor[note]) / 8.0;
+            double error = 1731.2340490667560 * (half_period / actual - 1.0);
+            if (error < 0) error = -error;
+            if (error > max_error_cents) max_error_cents = error;
+        }
+    }
+};
+
+inline constexpr NoteTable note_table;
+
+static_assert(note_table.max_error_cents < MAX_NOTE_ERROR_CENTS, "System clock is too low for the DCO tuning");
+
+/**
+ * Half period of the DCO in 1/256 system clock cycles from MIDI note 0 down to
+ * the next octave. Lower octaves are just right shifts of this.
+*/
+struct Exp2Table {
+    uint32_t half_period[EXP2_TABLE_SIZE + 1];
+
+    constexpr Exp2Table(): half_period() {
+        const double note_0_freq = 440.0 / 64 * 1.189207115002721; // 440 * 2^(-69/12)
+        const double ln2 = 0.6931471805599453;
+
+        for (int i = 0; i <= EXP2_TABLE_SIZE; i++) {
+            // 2^(-i/64) with a Taylor series, exp() is not constexpr either
+            double x = -ln2 * i / EXP2_TABLE_SIZE;
+            double term = 1.0, sum = 1.0;
+            for (int n = 1; n < 20; n++) {
+                term *= x / n;
+                sum += term;
+            }
+            half_period[i] = (uint32_t)(SYS_CLOCK_HZ / 2 / note_0_freq * 256 * sum + 0.5);
+        }
+    }
+};
+
+inline constexpr Exp2Table exp2_table;
+
+class Pitch {
+public:
+    static int32_t from_midi_note(int note) { return note * CENTS_PER_NOTE; }
+    static uint32_t divisor(int32_t cents);
+    static uint16_t amp(uint32_t divisor);
+    static uint32_t freq(int32_t cents);
+    static void print_tuning_report();
+
+private:
+    static uint32_t m_interpolated_divisor(int32_t cents);
+};
+
+#endif
@@ -0,0 +1,232 @@
+#include "profiler.h"
+
+static const char *stage_names[NO_OF_PROFILE_STAGES] = {
+    "read_midi",
+    "update_dcos",
+    "apply_mods",
+    "envelope",
+    "ui_scan"
+};
+
+static const char *trace_names[NO_OF_TRACE_EVENTS] = {
+    "note->dco",
+    "gate on",
+    "gate off",
+    "bend->dco"
+};
+
+void Histogram::reset() {
+    count = 0;
+    min = UINT32_MAX;
+    max = 0;
+    sum = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        buckets[i] = 0;
+    }
+}
+
+void Histogram::add(uint32_t value) {
+    int bucket = value ? 32 - __builtin_clz(value) : 0;
+    if (bucket >= HISTOGRAM_BUCKETS) bucket = HISTOGRAM_BUCKETS - 1;
+
+    buckets[bucket]++;
+    count++;
+    sum += value;
+    if (value < min) min = value;
+    if (value > max) max = value;
+}
+
+uint32_t Histogram::mean() {
+    return count ? sum / count : 0;
+}
+
+/**
+ * Upper bound of the bucket the percentile falls in, but not more than the max
+*/
+uint32_t Histogram::percentile(uint8_t percent) {
+    uint32_t target = ((uint64_t)count * percent + 99) / 100;
+    uint32_t seen = 0;
+
+    for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+        seen += buckets[bucket];
+        if (seen >= target && seen > 0) {
+            uint32_t bound = (1u << bucket) - 1;
+            return bound < max ? bound : max;
+        }
+    }
+
+    return max;
+}
+
+void LatencyHistogram::reset() {
+    count = 0;
+    max = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        buckets[i] = 0;
+    }
+}
+
+void LatencyHistogram::add(uint32_t us) {
+    uint32_t bucket = us / LATENCY_BUCKET_US;
+    if (bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+
+    if (buckets[bucket] < UINT16_MAX) buckets[bucket]++;
+    count++;
+    if (us > max) max = us;
+}
+
+/**
+ * Upper bound of the bucket the percentile falls in, but not more than the max
+*/
+uint32_t LatencyHistogram::percentile(uint8_t percent) {
+    uint32_t target = ((uint64_t)count * percent + 99) / 100;
+    uint32_t seen = 0;
+
+    for (int bucket = 0; bucket < LATENCY_BUCKETS - 1; bucket++) {
+        seen += buckets[bucket];
+        if (seen >= target && seen > 0) {
+            uint32_t bound = (bucket + 1) * LATENCY_BUCKET_US;
+            return bound < max ? bound : max;
+        }
+    }
+
+    return max;
+}
+
+Profiler::Profiler() {
+    for (int stage = 0; stage < NO_OF_PROFILE_STAGES; stage++) {
+        m_stages[stage].reset();
+        m_reset[stage] = false;
+    }
+    for (int event = 0; event < NO_OF_TRACE_EVENTS; event++) {
+        m_latencies[event].reset();
+        m_reset_latency[event] = false;
+    }
+}
+
+/**
+ * SysTick free runs from the processor clock, without interrupts
+*/
+void Profiler::init_core() {
+    systick_hw->rvr = SYSTICK_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = (1 << 2) | (1 << 0); // CLKSOURCE | ENABLE
+}
+
+void Profiler::record(profile_stage stage, uint32_t cycles) {
+    if (m_reset[stage]) {
+        m_stages[stage].reset();
+        m_reset[stage] = false;
+    }
+    m_stages[stage].add(cycles);
+}
+
+/**
+ * Records the time since the MIDI byte that caused the event. Events that are
+ * not from MIDI have no time.
+*/
+void Profiler::trace(trace_event event, uint32_t midi_us) {
+    if (!midi_us) return;
+
+    if (m_reset_latency[event]) {
+        m_latencies[event].reset();
+        m_reset_latency[event] = false;
+    }
+    m_latencies[event].add(time_us_32() - midi_us);
+}
+
+void Profiler::process() {
+    UsbWriter &usb = UsbWriter::get_instance();
+    usb.process();
+    if (usb.is_busy()) return;
+
+    uint32_t now = time_us_32();
+    if ((int32_t)(now - m_next_report_us) < 0) return;
+    m_next_report_us = now + PROFILER_REPORT_US;
+
+    m_format_report();
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+void Profiler::m_format_report() {
+    size_t length = 0;
+    if (ENABLE_PROFILER) {
+        length = m_format_stages(length);
+    }
+    if (ENABLE_LATENCY_TRACE) {
+        length = m_format_latencies(length);
+    }
+
+    UsbWriter::get_instance().start(m_report, length);
+}
+
+/**
+ * One line per stage: count, min/mean/max in cycles, then the non-empty
+ * histogram buckets as bits:count
+*/
+size_t Profiler::m_format_stages(size_t length) {
+    length = m_append(length, "prof (cycles @ %luMHz)\r\n", clock_get_hz(clk_sys) / 1000000);
+
+    for (int stage = 0; stage < NO_OF_PROFILE_STAGES; stage++) {
+        // A stage that hasn't run since the last report is still waiting to be
+        // reset
+        Histogram histogram = m_stages[stage];
+        if (m_reset[stage]) histogram.reset();
+        m_reset[stage] = true;
+
+        length = m_append(length, "  %-11s n: %6lu", stage_names[stage], histogram.count);
+        if (!histogram.count) {
+            length = m_append(length, "\r\n");
+            continue;
+        }
+
+        length = m_append(length, " min: %6lu avg: %6lu max: %7lu |",
+                          histogram.min, histogram.mean(), histogram.max);
+        for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+            if (histogram.buckets[bucket]) {
+                length = m_append(length, " %d:%lu", bucket, histogram.buckets[bucket]);
+            }
+        }
+        length = m_append(length, "\r\n");
+    }
+
+    return length;
+}
+
+/**
+ * One line per event type with the latency percentiles in us
+*/
+size_t Profiler::m_format_latencies(size_t length) {
+    length = m_append(length, "latency (us)\r\n");
+
+    for (int event = 0; event < NO_OF_TRACE_EVENTS; event++) {
+        LatencyHistogram histogram = m_latencies[event];
+        if (m_reset_latency[event]) histogram.reset();
+        m_reset_latency[event] = true;
+
+        length = m_append(length, "  %-11s n: %6lu p50: %5lu p99: %5lu max: %5lu\r\n", trace_names[event],
+                          histogram.count, histogram.percentile(50), histogram.percentile(99), histogram.max);
+    }
+
+    return length;
+}
+
+/**
+ * Appends to the report at length and returns the new length. A report that
+ * doesn't fit is cut, the length is never more than the text in the buffer.
+*/
+size_t Profiler::m_append(size_t length, const char *format, ...) {
+    if (length >= PROFILER_REPORT_SIZE - 1) return PROFILER_REPORT_SIZE - 1;
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(m_report + length, PROFILER_REPORT_SIZE - length, format, args);
+    va_end(args);
+
+    if (written < 0) return length;
+    length += written;
+    return length < PROFILER_REPORT_SIZE - 1 ? length : PROFILER_REPORT_SIZE - 1;
+}
@@ -0,0 +1,170 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+/**
+ * Stage profiler
+ *
+ * Times the main stages of the synth (PROFILE(stage) at the top of a function)
+ * with the SysTick cycle counter of the core the stage runs on and collects
+ * min/mean/max and a log2 histogram of each in RAM. The report is formatted
+ * every PROFILER_REPORT_US and sent over USB with the UsbWriter, so it never
+ * waits for the host (or the UART). If the writer is busy the report waits.
+ *
+ * With ENABLE_PROFILER off PROFILE() is empty, nothing is measured.
+ *
+ * The latency tracer (ENABLE_LATENCY_TRACE) is reported here too: MIDI bytes
+ * are timestamped on receipt, the time goes with the events to the output
+ * side, and TRACE_LATENCY() records the time from the byte that completed
+ * the message to the divisor landing in the PIO FIFO or the envelope being
+ * triggered, with p50/p99/max of each event type.
+ *
+ * SysTick is 24 bit, so a single stage can be max. 2^24 cycles (134ms at
+ * 125MHz). A stage interrupted by an IRQ (e.g. the UI scan) includes the time
+ * of the IRQ.
+ */
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "hardware/structs/systick.h"
+#include "hardware/clocks.h"
+#include "pico/time.h"
+#include <utils.h>
+#include "settings.h"
+#include "usb_writer.h"
+
+#define HISTOGRAM_BUCKETS       25      // Values up to 24 bits
+#define LATENCY_BUCKET_US       10
+#define LATENCY_BUCKETS         200     // The last one is everything above 2ms
+#define PROFILER_REPORT_SIZE    1536
+#define SYSTICK_MASK            0xffffff
+
+enum profile_stage {
+    PROFILE_READ_MIDI,
+    PROFILE_UPDATE_DCOS,
+    PROFILE_APPLY_MODS,
+    PROFILE_UPDATE_ENVELOPE,
+    PROFILE_UI_SCAN,
+    NO_OF_PROFILE_STAGES
+};
+
+enum trace_event {
+    TRACE_NOTE_DCO,         // Note on/off to the divisors in the FIFO
+    TRACE_GATE_ON,          // Note on to m_adsr.note_on()
+    TRACE_GATE_OFF,         // Note off to m_adsr.note_off()
+    TRACE_PITCH_BEND,       // Pitch bend to the divisors in the FIFO
+    NO_OF_TRACE_EVENTS
+};
+
+/**
+ * Min, mean, max and log2 histogram of some values. Bucket n counts the values
+ * of n significant bits, ie. 2^(n-1) <= value < 2^n (bucket 0 is 0).
+ */
+struct Histogram {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[HISTOGRAM_BUCKETS];
+
+    void reset();
+    void add(uint32_t value);
+    uint32_t mean();
+    uint32_t percentile(uint8_t percent);
+};
+
+/**
+ * Latencies in LATENCY_BUCKET_US resolution
+ */
+struct LatencyHistogram {
+    uint32_t count;
+    uint32_t max;
+    uint16_t buckets[LATENCY_BUCKETS];
+
+    void reset();
+    void add(uint32_t us);
+    uint32_t percentile(uint8_t percent);
+};
+
+class Profiler {
+public:
+    static Profiler& get_instance() {
+        static Profiler instance;
+        return instance;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(Profiler);
+
+    // Starts SysTick of the calling core, call on both cores
+    void init_core();
+
+    static inline uint32_t cycles() {
+        return systick_hw->cvr;
+    }
+
+    void record(profile_stage stage, uint32_t cycles);
+
+    // Receive time of a MIDI byte for the tracer, never 0. 0 means the event
+    // is not from MIDI and it's not traced.
+    static inline uint32_t midi_time() {
+        return time_us_32() | 1;
+    }
+
+    void trace(trace_event event, uint32_t midi_us);
+
+    // Scheduler task, formats the report when it's due and sends the next chunk
+    void process();
+
+protected:
+    Profiler();
+
+private:
+    Histogram m_stages[NO_OF_PROFILE_STAGES];
+
+    // Set by the report, the stage's histogram is reset on its next record.
+    // This way only the core that runs the stage writes it.
+    volatile bool m_reset[NO_OF_PROFILE_STAGES];
+
+    LatencyHistogram m_latencies[NO_OF_TRACE_EVENTS];
+    volatile bool m_reset_latency[NO_OF_TRACE_EVENTS];
+
+    char m_report[PROFILER_REPORT_SIZE];
+    uint32_t m_next_report_us = 0;
+
+    void m_format_report();
+    size_t m_format_stages(size_t length);
+    size_t m_format_latencies(size_t length);
+    size_t m_append(size_t length, const char *format, ...) __attribute__((format(printf, 3, 4)));
+};
+
+/**
+ * Records the time from its construction to the end of the scope
+ */
+class ProfileScope {
+public:
+    ProfileScope(profile_stage stage): m_stage(stage), m_start(Profiler::cycles()) {}
+
+    ~ProfileScope() {
+        // SysTick counts down
+        Profiler::get_instance().record(m_stage, (m_start - Profiler::cycles()) & SYSTICK_MASK);
+    }
+
+private:
+    profile_stage m_stage;
+    uint32_t m_start;
+};
+
+#if ENABLE_PROFILER
+#define PROFILE(stage) ProfileScope _profile_scope(stage)
+#else
+#define PROFILE(stage)
+#endif
+
+#if ENABLE_LATENCY_TRACE
+#define TRACE_LATENCY(event, midi_us) Profiler::get_instance().trace(event, midi_us)
+#else
+#define TRACE_LATENCY(event, midi_us)
+#endif
+
+#endif
@@ -0,0 +1,57 @@
+#include "recorder.h"
+
+static const char record_types[NO_OF_RECORD_TYPES] = {'D', 'A', 'S', 'E', 'F'};
+
+void OutputRecorder::start() {
+    m_start_us = time_us_32();
+}
+
+/**
+ * Only call it from the output side
+*/
+void OutputRecorder::record(record_type type, uint8_t channel, uint32_t value) {
+    uint32_t head = m_head;
+    if (head - m_tail >= RECORDER_SIZE) {
+        m_dropped++;
+        return;
+    }
+
+    recorded_output &record = m_records[head & (RECORDER_SIZE - 1)];
+    record.time_us = time_us_32() - m_start_us;
+    record.type = type;
+    record.channel = channel;
+    record.value = value;
+
+    __mem_fence_release();
+    m_head = head + 1;
+}
+
+/**
+ * Formats as many records as fit in the text buffer and sends them. The next
+ * ones are only formatted when they're all sent.
+*/
+void OutputRecorder::process() {
+    UsbWriter &usb = UsbWriter::get_instance();
+    usb.process();
+    if (usb.is_busy()) return;
+
+    size_t length = 0;
+    uint32_t tail = m_tail;
+    while (tail != m_head) {
+        __mem_fence_acquire();
+        recorded_output &record = m_records[tail & (RECORDER_SIZE - 1)];
+
+        char line[32];
+        int line_length = snprintf(line, sizeof(line), "%" PRIu32 " %c %u %" PRIu32 "\n", record.time_us,
+                                   record_types[record.type], record.channel, record.value);
+        if (length + line_length > RECORDER_TEXT_SIZE) break;
+
+        memcpy(m_text + length, line, line_length);
+        length += line_length;
+        m_tail = ++tail;
+    }
+
+    if (length) {
+        usb.start(m_text, length);
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef _RECORDER_H
+#define _RECORDER_H
+
+/**
+ * Output recorder
+ *
+ * Records every value the synth sends to the hardware: DCO divisors, amp PWM
+ * levels, sync restarts and the envelope and filter mod DAC words, with the
+ * time since start(). The output side writes them into a single producer /
+ * single consumer ring and a core 0 task sends them over USB as text (with the
+ * UsbWriter, when it's free), one line per record:
+ *
+ *      <time us> <type> <channel> <value>
+ *
+ * Type is D (divisor), A (amp), S (sync, channel 0, value: voice mask), E
+ * (envelope) or F (filter mod). With the input injection of MidiInput and UI
+ * this gives a trace of the whole control path that can be compared between
+ * builds.
+ *
+ * With ENABLE_OUTPUT_RECORDER off RECORD_OUTPUT() is empty.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <utils.h>
+#include "hardware/sync.h"
+#include "pico/time.h"
+#include "settings.h"
+#include "usb_writer.h"
+
+// Must be a power of two
+#define RECORDER_SIZE       256
+#define RECORDER_TEXT_SIZE  512
+
+enum record_type {
+    RECORD_DIVISOR,
+    RECORD_AMP,
+    RECORD_SYNC,
+    RECORD_ENVELOPE,
+    RECORD_FILTER_MOD,
+    NO_OF_RECORD_TYPES
+};
+
+struct recorded_output {
+    uint32_t time_us;
+    uint8_t type;
+    uint8_t channel;
+    uint32_t value;
+};
+
+class OutputRecorder {
+public:
+    static OutputRecorder& get_instance() {
+        static OutputRecorder instance;
+        return instance;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(OutputRecorder);
+
+    // Restarts the time of the records from 0
+    void start();
+    void record(record_type type, uint8_t channel, uint32_t value);
+
+    // Scheduler task, sends the records over USB
+    void process();
+
+    // Records lost because the ring was full
+    uint32_t dropped() { return m_dropped; }
+
+protected:
+    OutputRecorder() = default;
+
+private:
+    recorded_output m_records[RECORDER_SIZE];
+
+    // Free running indexes like the MIDI input
+    volatile uint32_t m_head = 0;
+    volatile uint32_t m_tail = 0;
+    volatile uint32_t m_dropped = 0;
+    volatile uint32_t m_start_us = 0;
+
+    char m_text[RECORDER_TEXT_SIZE];
+};
+
+#if ENABLE_OUTPUT_RECORDER
+#define RECORD_OUTPUT(type, channel, value) OutputRecorder::get_instance().record(type, channel, value)
+#else
+#define RECORD_OUTPUT(type, channel, value)
+#endif
+
+#endif
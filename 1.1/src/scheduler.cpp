@@ -0,0 +1,170 @@
+#include "scheduler.h"
+
+/**
+ * Adds a task, tasks with the same priority run in the order they're added
+*/
+void Scheduler::add_task(const char *name, task_function run, uint32_t period_us, uint32_t deadline_us,
+                         uint8_t priority, task_ready_function ready) {
+    if (m_no_of_tasks >= SCHEDULER_MAX_TASKS) return;
+
+    // Keep the tasks sorted by priority
+    int i = m_no_of_tasks;
+    while (i > 0 && m_tasks[i - 1].priority > priority) {
+        m_tasks[i] = m_tasks[i - 1];
+        i--;
+    }
+
+    scheduler_task &task = m_tasks[i];
+    task.name = name;
+    task.run = run;
+    task.ready = ready;
+    task.period_us = period_us;
+    task.deadline_us = deadline_us;
+    task.priority = priority;
+    task.next_us = time_us_32() + period_us;
+    task.stats = {0, 0, 0, 0};
+
+    m_no_of_tasks++;
+    m_stats_start_us = time_us_32();
+}
+
+/**
+ * Runs the tasks on the calling core forever
+*/
+void Scheduler::run() {
+    m_core = get_core_num();
+    while (1) run_once();
+}
+
+/**
+ * Runs the highest priority task that is due, or waits if there's none
+*/
+void Scheduler::run_once() {
+    uint32_t now = time_us_32();
+
+    if (m_snapshot_requested) {
+        m_take_snapshot(now);
+    }
+
+    for (int i = 0; i < m_no_of_tasks; i++) {
+        scheduler_task &task = m_tasks[i];
+
+        if (task.period_us && (int32_t)(now - task.next_us) >= 0) {
+            m_run_task(task, now, true);
+            return;
+        }
+        if (task.ready && task.ready()) {
+            m_run_task(task, now, false);
+            return;
+        }
+    }
+
+    m_idle(now);
+}
+
+/**
+ * Prints the stats of the tasks since the last call. On the core that runs
+ * the scheduler (or before it runs) the snapshot is taken right away,
+ * otherwise the owning core is asked for it.
+*/
+void Scheduler::print_stats(const char *name) {
+    if (m_core != -1 && m_core != (int)get_core_num()) {
+        if (!m_request_snapshot()) {
+            printf("%s: no stats\n", name);
+            return;
+        }
+    } else {
+        m_take_snapshot(time_us_32());
+    }
+
+    // Idle is everything that's not spent in the tasks
+    uint32_t time = m_snapshot_us;
+    uint32_t busy_us = 0;
+    for (int i = 0; i < m_no_of_tasks; i++) {
+        busy_us += m_snapshot[i].total_run_us;
+    }
+    uint32_t idle = (busy_us < time) ? (uint32_t)((uint64_t)(time - busy_us) * 100 / time) : 0;
+    printf("%s: idle %lu%%\n", name, idle);
+
+    for (int i = 0; i < m_no_of_tasks; i++) {
+        task_stats &stats = m_snapshot[i];
+        printf("  %-10s runs: %6lu avg: %4luus max: %4luus missed: %lu\n", m_tasks[i].name, stats.runs,
+               stats.runs ? stats.total_run_us / stats.runs : 0, stats.max_run_us, stats.missed);
+    }
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+void Scheduler::m_run_task(scheduler_task &task, uint32_t now, bool periodic) {
+    if (periodic) {
+        if (now - task.next_us > task.deadline_us) {
+            task.stats.missed++;
+        }
+
+        // If it's more than a period late then skip the lost periods instead
+        // of running it again and again to catch up
+        task.next_us += task.period_us;
+        if ((int32_t)(now - task.next_us) >= 0) {
+            task.next_us = now + task.period_us;
+        }
+    }
+
+    task.run();
+
+    uint32_t run_us = time_us_32() - now;
+    task.stats.runs++;
+    task.stats.total_run_us += run_us;
+    if (run_us > task.stats.max_run_us) task.stats.max_run_us = run_us;
+}
+
+/**
+ * Nothing to do: wait for an event until the next periodic task is due
+*/
+void Scheduler::m_idle(uint32_t now) {
+    if (!SCHEDULER_WFE) return;
+
+    uint32_t wait_us = UINT32_MAX;
+    for (int i = 0; i < m_no_of_tasks; i++) {
+        if (m_tasks[i].period_us) {
+            uint32_t until = m_tasks[i].next_us - now;
+            if (until < wait_us) wait_us = until;
+        }
+    }
+
+    best_effort_wfe_or_timeout(make_timeout_time_us(wait_us));
+}
+
+/**
+ * Copies the stats to the snapshot and resets them, on the owning core
+*/
+void Scheduler::m_take_snapshot(uint32_t now) {
+    for (int i = 0; i < m_no_of_tasks; i++) {
+        m_snapshot[i] = m_tasks[i].stats;
+        m_tasks[i].stats = {0, 0, 0, 0};
+    }
+    m_snapshot_us = now - m_stats_start_us;
+    m_stats_start_us = now;
+
+    __mem_fence_release();
+    m_snapshot_requested = false;
+}
+
+/**
+ * Asks the owning core for a snapshot and waits for it. It's taken on the
+ * owner's next pass, so the wait is max. its longest task.
+*/
+bool Scheduler::m_request_snapshot() {
+    m_snapshot_requested = true;
+    __sev();
+
+    uint32_t start = time_us_32();
+    while (m_snapshot_requested) {
+        if (time_us_32() - start > SCHEDULER_STATS_TIMEOUT_US) return false;
+        tight_loop_contents();
+    }
+
+    __mem_fence_acquire();
+    return true;
+}
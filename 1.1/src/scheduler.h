@@ -0,0 +1,85 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+/**
+ * Cooperative task scheduler
+ *
+ * Replaces the bare main loop: every task has a period and/or a ready
+ * function (event trigger), a deadline and a priority. On every pass the
+ * highest priority task that is due runs, then it starts again from the top,
+ * so a long low priority task can only delay the others by its own run time.
+ *
+ * A periodic task is late if it starts later than its deadline after it was
+ * due, these are counted as missed deadlines. If nothing is due the core
+ * waits for an event (interrupt, SEV from the other core) or the next
+ * periodic task with __wfe() (SCHEDULER_WFE). Idle time is the time that's
+ * not spent in the tasks.
+ *
+ * The stats are only written by the core that runs the scheduler. Another core
+ * asks for them: the owner copies them to a snapshot and resets them on its
+ * next pass, and the snapshot is printed.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "pico/time.h"
+#include "hardware/sync.h"
+#include "settings.h"
+
+#define SCHEDULER_MAX_TASKS 10
+#define SCHEDULER_STATS_TIMEOUT_US  10000   // Max wait for the other core's stats
+
+typedef void (*task_function)();
+typedef bool (*task_ready_function)();
+
+struct task_stats {
+    uint32_t runs;
+    uint32_t missed;
+    uint32_t max_run_us;
+    uint32_t total_run_us;
+};
+
+struct scheduler_task {
+    const char *name;
+    task_function run;
+    task_ready_function ready;  // NULL if it's only periodic
+    uint32_t period_us;         // 0 if it only runs when it's ready
+    uint32_t deadline_us;
+    uint8_t priority;           // 0 is the highest
+    uint32_t next_us;
+
+    // Stats since the last snapshot
+    task_stats stats;
+};
+
+class Scheduler {
+public:
+    void add_task(const char *name, task_function run, uint32_t period_us, uint32_t deadline_us,
+                  uint8_t priority, task_ready_function ready = NULL);
+
+    void run_once();
+    void run();
+
+    // Prints the stats since the last call, can be called from either core
+    void print_stats(const char *name);
+
+private:
+    scheduler_task m_tasks[SCHEDULER_MAX_TASKS];
+    int m_no_of_tasks = 0;
+    uint32_t m_stats_start_us = 0;
+
+    // Core that runs the scheduler, -1 until run() is called
+    volatile int m_core = -1;
+
+    // Taken by the owning core when it's requested
+    task_stats m_snapshot[SCHEDULER_MAX_TASKS];
+    uint32_t m_snapshot_us = 0;
+    volatile bool m_snapshot_requested = false;
+
+    void m_run_task(scheduler_task &task, uint32_t now, bool periodic);
+    void m_idle(uint32_t now);
+    void m_take_snapshot(uint32_t now);
+    bool m_request_snapshot();
+};
+
+#endif
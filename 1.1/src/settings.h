@@ -8,10 +8,32 @@
 #include "hardware/pio.h"
 
 // GLOBAL
+#define ENABLE_DUAL_CORE    true        // Run the outputs (DCOs, envelope) on core 1
+#define DEBUG_LOOP_JITTER   false       // Print scheduler and timing stats every second
+#define SCHEDULER_WFE       true        // Sleep until the next task or interrupt
+#define OUTPUT_TICK_US      250         // Output side (envelope, mods) period
+#define PRINT_TUNING_REPORT false       // Print the tuning error of all notes at boot
+#define ENABLE_PROFILER     false       // Time the main stages, see profiler.h.
+                                        // Compiled out if it's off.
+#define ENABLE_LATENCY_TRACE false      // Trace MIDI to DCO/envelope latency, it's
+                                        // sent with the profiler report
+#define PROFILER_REPORT_US  1000000     // Profiler report period, sent over USB
+#ifndef ENABLE_OUTPUT_RECORDER          // The host replay tool turns it on
+#define ENABLE_OUTPUT_RECORDER false    // Send every output value over USB, see
+                                        // recorder.h
+#endif
+#define ENABLE_BENCHMARK    false       // Run the benchmark at boot, see benchmark.h
+#ifndef ENABLE_SMF_PLAYER               // The host replay tool turns it on
+#define ENABLE_SMF_PLAYER   false       // Play MIDI files sent over USB, see
+                                        // smf_player.h
+#endif
+#define SMF_REALTIME        true        // Play the events at their time, otherwise
+                                        // as fast as possible
+#define SMF_REMAP_CHANNEL   true        // Play all channels on MIDI_CHANNEL
 #define VOICES              6
 #define FAT_MONO_VOICES     3
 #define PARA_STACK_VOICES   false
-#define DEFAULT_FREQ        220.0
+#define DEFAULT_NOTE        57          // A3, 220Hz
 #define MAX_FREQ            5000.0      // This depends on the integrator's RC constant.
                                         // Rint = 200kohm, Cint = 1nF
                                         // fmax = 1/RC = 5kHz
@@ -21,8 +43,13 @@
                                         // get in a stuck state when a too low note
                                         // is played.
 
-#define PORTAMENTO_TIME     10
-#define DETUNE_FACTOR       1.02f       // Only available in FAT mode, should be > 1
+#define PORTAMENTO_TIME_US  40000       // Glide time per semitone, or of the
+                                        // whole glide if PORTAMENTO_FIXED_TIME
+#define PORTAMENTO_FIXED_TIME false
+#define GLIDE_RATE_HZ       1000        // Control rate of the glide, it's a
+                                        // scheduler task
+#define DETUNE_CENTS        34          // Only available in FAT mode, should be > 0
+                                        // (34 cents = x1.02 in frequency)
 
 #define ENVELOPE_DAC_SIZE   4096
 #define FILTER_MOD_DAC_SIZE 4096
@@ -59,18 +86,62 @@
 
 // DAC
 #define DAC_SPI_PORT        spi0
+#define DAC_SPI_BAUDRATE    10000000    // MCP48X2 max is 20MHz
 #define GP_DAC_SCK          6
 #define GP_DAC_MOSI         7
-#define GP_DAC_CS           5
+#define GP_DAC_CS           5           // Must be the CSn pin of DAC_SPI_PORT
+
+// Envelope output. The DAC gets a frame at ENVELOPE_RATE_HZ by DMA, in blocks
+// of ENVELOPE_BLOCK_SIZE frames. The ADSR itself is only read once per block
+// (1kHz by default), the frames of a block are a linear ramp to that value.
+// So the envelope's shape has 1ms resolution, the 8kHz only smooths the
+// steps. A block is also the latency of the envelope.
+#define ENVELOPE_RATE_HZ    8000
+#define ENVELOPE_BLOCK_SIZE 8
+
+// DCO
+#define ENABLE_DCO_STREAM   false       // Feed the DCOs from DMA, modulations are
+                                        // ramped over oscillator periods. Adds
+                                        // 12 periods of latency, and underruns
+                                        // when 4 periods are shorter than an
+                                        // output tick (see dco_stream.h)
+#ifndef DCO_FRACTIONAL                  // The host tests build both programs
+#define DCO_FRACTIONAL      false       // Dither the DCO periods for 1/8 cycle
+                                        // resolution (frequency_frac program)
+#endif
+#define GP_DCO_SYNC         29          // Start trigger of the DCO state machines.
+                                        // RESERVED, don't use it for anything
+                                        // else. Only its input override is set,
+                                        // the pad isn't driven. On the Pico it's
+                                        // the VSYS/3 ADC input, which isn't used
+                                        // (GP 25 would flash the onboard LED).
+
+// LFO. It's off by default: with the LFO the modwheel sets its amount and no
+// longer opens the filter (DAC B), the rest can be set with CCs.
+#define ENABLE_LFO          false
+#define LFO_RATE_HZ         1000        // Control rate
+#define LFO_MIN_RATE        0.1         // Hz, at rate 0
+#define LFO_RATE_OCTAVES    8           // Rate 127 = 25.6Hz
+#define LFO_DEFAULT_RATE    80          // ~3.3Hz
+#define LFO_DEFAULT_DEPTH   127
+#define LFO_TO_PITCH        true
+#define LFO_TO_FILTER       false
+#define LFO_PITCH_DEPTH     50          // Cents at full depth and modwheel
+#define LFO_FILTER_DEPTH    1024        // DAC value at full depth and modwheel
+#define CC_LFO_RATE         76
+#define CC_LFO_DEPTH        77
+#define CC_LFO_SHAPE        78
 
 // MIDI
-#define MIDI_CHANNEL                4
+#define MIDI_CHANNEL                4           // Low nibble of the status byte (0-15),
+                                                // ie. channel 5 on the sending device
 #define OCTAVES                     10
 #define MIDI_UART_INSTANCE          uart1
+#define MIDI_UART_IRQ               UART1_IRQ
 #define GP_MIDI_RX                  9
 #define MIDI_BAUDRATE               31250
 #define MIDI_OCTAVE_SHIFT           0 // Not implemented
-#define PITCH_BEND_SEMITONES        1 // Min. 1
+#define PITCH_BEND_SEMITONES        2 // Bend range up and down, min. 1
 
 // UI
 #define MUX_BINARY_PIN_A            4
@@ -0,0 +1,176 @@
+#include "smf_player.h"
+
+static const uint8_t header_id[4] = {'M', 'T', 'h', 'd'};
+static const uint8_t track_id[4] = {'M', 'T', 'r', 'k'};
+
+static uint32_t read_be(const uint8_t *bytes, int length) {
+    uint32_t value = 0;
+    for (int i = 0; i < length; i++) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+void SmfPlayer::process() {
+    for (int i = 0; i < SMF_BYTES_PER_CALL; i++) {
+        if (m_event_length && !m_send_event()) return;
+
+        int c = getchar_timeout_us(0);
+        if (c == PICO_ERROR_TIMEOUT) return;
+
+        m_parse(c);
+    }
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+/**
+ * Injects the pending event if it's due. Returns false if it has to wait,
+ * either for its time or for room in the MIDI input.
+*/
+bool SmfPlayer::m_send_event() {
+    if (SMF_REALTIME && time_us_64() - m_start_us < m_event_us) return false;
+
+    m_event_sent += MidiInput::get_instance().inject(m_event + m_event_sent, m_event_length - m_event_sent);
+    if (m_event_sent < m_event_length) return false;
+
+    m_event_length = 0;
+    return true;
+}
+
+void SmfPlayer::m_parse(uint8_t byte) {
+    switch (m_state) {
+    case SMF_HEADER:
+        // Sliding window until MThd
+        if (m_count == 4) {
+            for (int i = 0; i < 3; i++) m_bytes[i] = m_bytes[i + 1];
+            m_count = 3;
+        }
+        m_bytes[m_count++] = byte;
+        if (m_count == 4 && !memcmp(m_bytes, header_id, 4)) {
+            m_state = SMF_HEADER_DATA;
+            m_count = 0;
+        }
+        break;
+
+    case SMF_HEADER_DATA:
+        // Length, format, tracks and division
+        m_bytes[m_count++] = byte;
+        if (m_count == 10) {
+            m_start_file();
+        }
+        break;
+
+    case SMF_CHUNK:
+        m_bytes[m_count++] = byte;
+        if (m_count < 8) break;
+
+        m_count = 0;
+        m_length = read_be(m_bytes + 4, 4);
+        if (!memcmp(m_bytes, track_id, 4)) {
+            m_track.start(m_length);
+            m_state = SMF_TRACK;
+            if (m_track.is_finished()) m_end_track();
+        } else {
+            m_state = m_length ? SMF_SKIP_CHUNK : SMF_CHUNK;
+        }
+        break;
+
+    case SMF_SKIP_CHUNK:
+        if (--m_length == 0) m_state = SMF_CHUNK;
+        break;
+
+    case SMF_TRACK: {
+        smf_event event;
+        if (m_track.parse(byte, event)) {
+            m_play(event);
+        }
+        if (m_track.is_finished()) {
+            m_end_track();
+        }
+        break;
+    }
+    }
+}
+
+/**
+ * The event's time is after the previous one's, channel events wait for it in
+ * m_event
+*/
+void SmfPlayer::m_play(smf_event &event) {
+    m_add_ticks(event.delta);
+
+    if (event.type == SMF_EVENT_TEMPO) {
+        if (!m_smpte) m_tempo = event.tempo;
+        return;
+    }
+
+    memcpy(m_event, event.data, event.length);
+    if (SMF_REMAP_CHANNEL) {
+        m_event[0] = (m_event[0] & 0xf0) | MIDI_CHANNEL;
+    }
+    m_event_length = event.length;
+    m_event_sent = 0;
+}
+
+void SmfPlayer::m_start_file() {
+    m_length = read_be(m_bytes, 4);
+    uint16_t format = read_be(m_bytes + 4, 2);
+    m_tracks = read_be(m_bytes + 6, 2);
+    uint16_t division = read_be(m_bytes + 8, 2);
+
+    // These tracks should play at the same time, not one after the other
+    if (format == 1 && m_tracks > 1) {
+        printf("SMF: format 1 with %" PRIu32 " tracks, merge it to format 0 first\n", m_tracks);
+        m_count = 0;
+        m_state = SMF_HEADER;
+        return;
+    }
+
+    // Negative SMPTE frames per second and ticks per frame, the tempo doesn't
+    // apply then
+    m_smpte = division & 0x8000;
+    if (m_smpte) {
+        m_division = (uint32_t)(-(int8_t)(division >> 8)) * (division & 0xff);
+        m_tempo = 1000000;
+    } else {
+        m_division = division;
+        m_tempo = SMF_DEFAULT_TEMPO;
+    }
+    if (!m_division) m_division = 96;
+
+    m_tick_remainder = 0;
+    m_event_us = 0;
+    m_start_us = time_us_64();
+    if (ENABLE_OUTPUT_RECORDER) {
+        OutputRecorder::get_instance().start();
+    }
+
+    // The header may be longer in later versions
+    m_count = 0;
+    m_state = SMF_CHUNK;
+    if (m_length > 6) {
+        m_length -= 6;
+        m_state = SMF_SKIP_CHUNK;
+    }
+    if (!m_tracks) m_state = SMF_HEADER;
+}
+
+/**
+ * After the last track it waits for the next file
+*/
+void SmfPlayer::m_end_track() {
+    m_count = 0;
+    m_state = SMF_CHUNK;
+    if (--m_tracks == 0) {
+        m_state = SMF_HEADER;
+    }
+}
+
+void SmfPlayer::m_add_ticks(uint32_t ticks) {
+    uint64_t time = (uint64_t)ticks * m_tempo + m_tick_remainder;
+    m_event_us += time / m_division;
+    m_tick_remainder = time % m_division;
+}
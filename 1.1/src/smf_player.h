@@ -0,0 +1,95 @@
+#ifndef _SMF_PLAYER_H
+#define _SMF_PLAYER_H
+
+/**
+ * Standard MIDI File player
+ *
+ * Plays an SMF that is sent over USB (stdin), for replaying recordings
+ * through the whole synth. The file is parsed as it's read, byte by byte, and
+ * reading stops while an event waits for its time, so the host is held back
+ * by USB flow control and files of any length can be streamed.
+ *
+ * Channel events are injected into MidiInput, so they go the same way as the
+ * ones from the MIDI port. With SMF_REALTIME they're played at their time
+ * (tempo changes included), otherwise as fast as the synth takes them. Sysex
+ * and meta events other than tempo are skipped. The player starts the
+ * OutputRecorder's time when a file starts, so with ENABLE_OUTPUT_RECORDER the
+ * outputs of a replay can be compared to another one.
+ *
+ * Tracks are played one after the other. That's right for format 0 and 2, but
+ * the tracks of format 1 should play at the same time, and they can only be
+ * merged with the whole file at hand. Format 1 files with more than one track
+ * are skipped, merge them to format 0 first (tests/tools/smf_replay does).
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <utils.h>
+#include "pico/stdio.h"
+#include "pico/time.h"
+#include "settings.h"
+#include "midi_input.h"
+#include "recorder.h"
+#include "smf_track.h"
+
+#define SMF_BYTES_PER_CALL  64
+#define SMF_DEFAULT_TEMPO   500000      // us per quarter note, 120 BPM
+
+enum smf_state {
+    SMF_HEADER,             // Looking for MThd
+    SMF_HEADER_DATA,
+    SMF_CHUNK,              // Chunk id and length after the header
+    SMF_SKIP_CHUNK,         // Not a track
+    SMF_TRACK
+};
+
+class SmfPlayer {
+public:
+    static SmfPlayer& get_instance() {
+        static SmfPlayer instance;
+        return instance;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(SmfPlayer);
+
+    // Scheduler task, reads the file and plays the events that are due
+    void process();
+
+protected:
+    SmfPlayer() = default;
+
+private:
+    smf_state m_state = SMF_HEADER;
+
+    // Bytes of the header or chunk header being read
+    uint8_t m_bytes[10];
+    uint32_t m_count = 0;
+    uint32_t m_length = 0;              // Chunk length
+
+    uint32_t m_tracks = 0;
+    SmfTrackParser m_track;
+
+    // Ticks to time: us = ticks * m_tempo / m_division
+    uint32_t m_tempo = SMF_DEFAULT_TEMPO;
+    uint32_t m_division = 96;
+    bool m_smpte = false;
+    uint64_t m_tick_remainder = 0;
+
+    uint64_t m_start_us = 0;
+    uint64_t m_event_us = 0;            // Time of the next event since the start
+
+    // Event waiting for its time (m_event_length is set)
+    uint8_t m_event[3];
+    uint8_t m_event_length = 0;
+    uint8_t m_event_sent = 0;
+
+    bool m_send_event();
+    void m_parse(uint8_t byte);
+    void m_play(smf_event &event);
+    void m_start_file();
+    void m_end_track();
+    void m_add_ticks(uint32_t ticks);
+};
+
+#endif
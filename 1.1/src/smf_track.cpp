@@ -0,0 +1,140 @@
+#include "smf_track.h"
+
+void SmfTrackParser::start(uint32_t length) {
+    m_remaining = length;
+    m_ticks = 0;
+    m_running_status = 0;
+    m_next_delta();
+}
+
+bool SmfTrackParser::parse(uint8_t byte, smf_event &event) {
+    if (!m_remaining) return false;
+    m_remaining--;
+    return m_parse(byte, event);
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+bool SmfTrackParser::m_parse(uint8_t byte, smf_event &event) {
+    switch (m_state) {
+    case SMF_DELTA:
+        if (m_read_vlq(byte)) {
+            m_ticks += m_value;
+            m_state = SMF_STATUS;
+        }
+        break;
+
+    case SMF_STATUS:
+        if (byte == 0xff) {
+            m_state = SMF_META_TYPE;
+        } else if (byte == 0xf0 || byte == 0xf7) {
+            m_value = 0;
+            m_state = SMF_SYSEX_LENGTH;
+        } else if (byte & 0x80) {
+            m_start_event(byte);
+        } else if (m_running_status) {
+            // Running status, this is already the first data byte
+            m_start_event(m_running_status);
+            return m_parse(byte, event);
+        } else {
+            m_next_delta();
+        }
+        break;
+
+    case SMF_DATA:
+        m_event[m_count++] = byte;
+        if (m_count == m_event_size) {
+            event.delta = m_ticks;
+            event.type = SMF_EVENT_MIDI;
+            event.length = m_event_size;
+            for (int i = 0; i < m_event_size; i++) event.data[i] = m_event[i];
+
+            m_ticks = 0;
+            m_next_delta();
+            return true;
+        }
+        break;
+
+    case SMF_META_TYPE:
+        m_meta_type = byte;
+        m_value = 0;
+        m_state = SMF_META_LENGTH;
+        break;
+
+    case SMF_META_LENGTH:
+        if (m_read_vlq(byte)) {
+            m_length = m_value;
+            m_count = 0;
+            m_state = SMF_META_DATA;
+            if (!m_length) return m_end_meta(event);
+        }
+        break;
+
+    case SMF_META_DATA:
+        if (m_count < sizeof(m_meta)) m_meta[m_count] = byte;
+        if (++m_count == m_length) return m_end_meta(event);
+        break;
+
+    case SMF_SYSEX_LENGTH:
+        if (m_read_vlq(byte)) {
+            m_length = m_value;
+            if (m_length) {
+                m_state = SMF_SKIP;
+            } else {
+                m_next_delta();
+            }
+        }
+        break;
+
+    case SMF_SKIP:
+        if (--m_length == 0) m_next_delta();
+        break;
+    }
+
+    return false;
+}
+
+/**
+ * Reads the next byte of a variable length quantity into m_value, returns true
+ * on its last byte
+*/
+bool SmfTrackParser::m_read_vlq(uint8_t byte) {
+    m_value = (m_value << 7) | (byte & 0x7f);
+    return !(byte & 0x80);
+}
+
+void SmfTrackParser::m_start_event(uint8_t status) {
+    // System messages are not played and don't set the running status
+    if (status >= 0xf0) {
+        m_next_delta();
+        return;
+    }
+
+    m_running_status = status;
+    m_event[0] = status;
+    m_event_size = ((status & 0xe0) == 0xc0) ? 2 : 3;   // Program change and channel pressure
+    m_count = 1;
+    m_state = SMF_DATA;
+}
+
+/**
+ * Only tempo changes are returned
+*/
+bool SmfTrackParser::m_end_meta(smf_event &event) {
+    m_next_delta();
+    if (m_meta_type != 0x51 || m_length != 3) return false;
+
+    event.delta = m_ticks;
+    event.type = SMF_EVENT_TEMPO;
+    event.length = 0;
+    event.tempo = ((uint32_t)m_meta[0] << 16) | (m_meta[1] << 8) | m_meta[2];
+    m_ticks = 0;
+    return true;
+}
+
+void SmfTrackParser::m_next_delta() {
+    m_value = 0;
+    m_state = SMF_DELTA;
+}
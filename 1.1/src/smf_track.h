@@ -0,0 +1,74 @@
+#ifndef _SMF_TRACK_H
+#define _SMF_TRACK_H
+
+/**
+ * Standard MIDI File track parser
+ *
+ * Parses the data of an MTrk chunk byte by byte, so a track can be read as
+ * it's streamed. It only keeps what's needed to play the track: channel
+ * events (with running status) and tempo changes, each with the ticks since
+ * the previous one. Sysex, system and other meta events are skipped, their
+ * delta times are added to the next event.
+ *
+ * The SmfPlayer uses one for the track being played, the host replay tool one
+ * per track to merge them.
+ */
+
+#include <inttypes.h>
+
+enum smf_track_state {
+    SMF_DELTA,
+    SMF_STATUS,
+    SMF_DATA,
+    SMF_META_TYPE,
+    SMF_META_LENGTH,
+    SMF_META_DATA,
+    SMF_SYSEX_LENGTH,
+    SMF_SKIP                // Rest of a sysex or meta event
+};
+
+enum smf_event_type {
+    SMF_EVENT_MIDI,         // data: status and data bytes, length: 2 or 3
+    SMF_EVENT_TEMPO         // tempo: us per quarter note
+};
+
+struct smf_event {
+    uint32_t delta;         // Ticks since the previous event of the track
+    uint8_t type;
+    uint8_t data[3];
+    uint8_t length;
+    uint32_t tempo;
+};
+
+class SmfTrackParser {
+public:
+    // Starts a track chunk of the given length
+    void start(uint32_t length);
+
+    // Parses the next byte of the track, returns true if it completed an event
+    bool parse(uint8_t byte, smf_event &event);
+
+    bool is_finished() { return m_remaining == 0; }
+
+private:
+    smf_track_state m_state = SMF_DELTA;
+    uint32_t m_remaining = 0;
+    uint32_t m_ticks = 0;               // Since the last event returned
+    uint32_t m_value = 0;               // Variable length quantity being read
+    uint32_t m_length = 0;              // Meta or sysex length
+    uint32_t m_count = 0;
+    uint8_t m_running_status = 0;
+    uint8_t m_meta_type = 0;
+    uint8_t m_meta[3];
+
+    uint8_t m_event[3];
+    uint8_t m_event_size = 0;
+
+    bool m_parse(uint8_t byte, smf_event &event);
+    bool m_read_vlq(uint8_t byte);
+    void m_start_event(uint8_t status);
+    bool m_end_meta(smf_event &event);
+    void m_next_delta();
+};
+
+#endif
@@ -6,15 +6,14 @@
 Synth::Synth(): m_adsr(ENVELOPE_DAC_SIZE) {}
 
 void Synth::init(device_mode default_mode) {
+    queue_init(&m_output_queue, sizeof(output_event), OUTPUT_QUEUE_SIZE);
 
     // DAC init
     sleep_ms(500);
-    m_dac.init(DAC_SPI_PORT, GP_DAC_CS, GP_DAC_SCK, GP_DAC_MOSI);
+    m_dac.init();
 
     // MIDI init
-    uart_init(MIDI_UART_INSTANCE, MIDI_BAUDRATE);
-    gpio_set_function(GP_MIDI_RX, GPIO_FUNC_UART);
-    m_input_buffer.init(m_buffer_var, MIDI_BUFFER_SIZE);
+    m_midi_input.init();
 
     for (int i = 0; i < VOICES; i++) {
         // PWM init
@@ -31,6 +30,9 @@ void Synth::init(device_mode default_mode) {
     for (int i = 0; i < VOICES; i++) {
         m_notes_played[i] = -1;
         m_chord_notes[i] = -1;
+        m_sent_pitches[i] = INT32_MIN;
+        m_voice_pitches[i] = PITCH_OFF;
+        m_voice_midi_us[i] = 0;
     }
 
     set_mode(default_mode);
@@ -40,8 +42,38 @@ void Synth::init(device_mode default_mode) {
 }
 
 void Synth::init_dcos() {
+    const pio_program_t *program = DCO_FRACTIONAL ? &frequency_frac_program : &frequency_program;
+    m_dco_offsets[0] = pio_add_program(settings.pio[0], program);
+    m_dco_offsets[1] = pio_add_program(settings.pio[1], program);
+
+    // The state machines wait for the sync pin's input, it's forced with the
+    // input override so nothing is driven on the pin
+    gpio_set_inover(GP_DCO_SYNC, GPIO_OVERRIDE_LOW);
+
     for (int i = 0; i < VOICES; i++) {
-        m_set_frequency(settings.pio[settings.voice_to_pio[i]], settings.voice_to_sm[i], DEFAULT_FREQ);
+        if (DCO_FRACTIONAL) {
+            init_sm_pin_frac(settings.pio[settings.voice_to_pio[i]],
+                             settings.voice_to_sm[i],
+                             m_dco_offsets[settings.voice_to_pio[i]],
+                             settings.reset_pins[i],
+                             GP_DCO_SYNC);
+        } else {
+            init_sm_pin(settings.pio[settings.voice_to_pio[i]],
+                        settings.voice_to_sm[i],
+                        m_dco_offsets[settings.voice_to_pio[i]],
+                        settings.reset_pins[i],
+                        GP_DCO_SYNC);
+        }
+        pio_sm_set_enabled(settings.pio[settings.voice_to_pio[i]], settings.voice_to_sm[i], true);
+        m_set_divisor(settings.pio[settings.voice_to_pio[i]], settings.voice_to_sm[i], note_table.divisor[DEFAULT_NOTE]);
+    }
+
+    if (ENABLE_DCO_STREAM) {
+        m_dco_stream.init();
+        for (int i = 0; i < VOICES; i++) {
+            m_stream_divisors[i] = note_table.divisor[DEFAULT_NOTE];
+            m_dco_stream.start(i, m_stream_divisors[i]);
+        }
     }
 }
 
@@ -56,28 +88,19 @@ void Synth::set_mode(device_mode mode) {
         // Mono and fat mode uses the same converter, the diff is only the
         // number of voices played
         case MONO:
-            m_ui.chord_on = false;
+            m_set_chord_on(false);
             m_converter = &m_mono;
-
-            // Reset all voices to 0V
-            for (int voice = 0; voice < VOICES; voice++) {
-                pwm_set_chan_level(m_amp_pwm_slices[voice], pwm_gpio_to_channel(settings.amp_pins[voice]), 0);
-            }
+            m_voices = 1;
             break;
 
         case FAT_MONO:
-            m_ui.chord_on = false;
+            m_set_chord_on(false);
             m_converter = &m_mono;
             m_voices = FAT_MONO_VOICES;
-
-            // Reset all voices to 0V
-            for (int voice = 0; voice < VOICES; voice++) {
-                pwm_set_chan_level(m_amp_pwm_slices[voice], pwm_gpio_to_channel(settings.amp_pins[voice]), 0);
-            }
             break;
 
         case PARA:
-            m_ui.chord_on = false;
+            m_set_chord_on(false);
             m_converter = &m_para;
             m_voices = VOICES;
             m_converter->set_dirty(true);
@@ -85,7 +108,16 @@ void Synth::set_mode(device_mode mode) {
     }
 
     settings.mode = mode;
+    m_push_event(OUTPUT_MODE, mode);
+
+    // Voices that are not used by the mode are silenced by the output side, so
+    // make sure they are sent again when they're used next time
+    for (int voice = 0; voice < VOICES; voice++) {
+        m_sent_pitches[voice] = INT32_MIN;
+    }
+
     m_converter->reset();
+    m_update_gate();
     m_update_dcos();
 }
 
@@ -100,32 +132,84 @@ void Synth::set_velo_tracking(bool velo_tracking) {
 }
 
 /**
- * Called in the main loop
+ * Control side of the synth: these are the tasks of the main scheduler. They
+ * read MIDI and the UI, run the converters and send the results to the output
+ * side.
 */
-void Synth::process() {
-    // Update settings from switches and pots
-    if (m_ui.updated) {
-        set_adsr(m_ui.switches[mux_switch::SOFT], m_ui.switches[mux_switch::HOLD], m_ui.switches[mux_switch::RING]);
-        set_portamento(m_ui.switches[mux_switch::PORTAMENTO]);
-        set_detune(m_ui.switches[mux_switch::DETUNE]);
-        set_solo(m_ui.switches[mux_switch::SOLO_CHORD]);
-        set_velo_tracking(m_ui.switches[mux_switch::WAH_VELOCITY]);
-        set_kb_tracking(m_ui.switches[mux_switch::KB_TRACKING]);
-
-        if (m_ui.synth_mode != settings.mode) {
-            set_mode(m_ui.synth_mode);
-        }
-    }
+bool Synth::has_midi() {
+    return !m_midi_input.is_empty();
+}
 
-    // Process synth
+void Synth::process_midi() {
     m_read_midi();
 
     if (ENABLE_CHORD_MEMORY) {
         m_set_chord();
     }
+}
 
-    m_update_envelope();
+bool Synth::has_ui_events() {
+    return m_ui.has_events();
+}
+
+/**
+ * Updates settings from switches and pots that changed
+*/
+void Synth::process_ui() {
+    ui_event event;
+    while (m_ui.read_event(event)) {
+        m_handle_ui_event(event);
+    }
+
+    // Changes were lost on a full queue, the panel is applied as it is now
+    if (m_ui.take_resync()) {
+        m_resync_ui();
+    }
+}
+
+/**
+ * Called at GLIDE_RATE_HZ
+*/
+void Synth::process_glide() {
+    m_update_portamento();
+}
+
+/**
+ * Output side of the synth, a task of the main scheduler or, with
+ * ENABLE_DUAL_CORE, of core 1's. It owns the DCOs, the amp PWMs and the DAC, so
+ * timing of these isn't affected by ADC reads, MUX settling or printf on the
+ * other side.
+*/
+bool Synth::has_output_events() {
+    return !queue_is_empty(&m_output_queue);
+}
+
+void Synth::process_output() {
+    m_read_output_events();
+
+    uint32_t start = DEBUG_LOOP_JITTER ? time_us_32() : 0;
+    if (ENABLE_LFO) {
+        m_update_lfo();
+    }
     m_apply_mods();
+    if (ENABLE_DCO_STREAM) {
+        m_render_dco_streams();
+    }
+    if (DEBUG_LOOP_JITTER) {
+        m_mod_time_us += time_us_32() - start;
+    }
+
+    m_update_envelope();
+}
+
+uint32_t Synth::take_mod_time_us() {
+    uint32_t time = m_mod_time_us;
+    m_mod_time_us = 0;
+    return time;
+}
+
+uint32_t Synth::take_dco_underruns() {
+    return m_dco_stream.take_underruns();
 }
 
 /**
@@ -139,7 +223,7 @@ void Synth::note_on(uint8_t channel, uint8_t note, uint8_t velocity) {
 
     // When chord is ON, then fill the paraphonic player with the number of
     // notes. If a new note is played, turn off the previous note.
-    if (ENABLE_CHORD_MEMORY && m_ui.chord_on) {
+    if (ENABLE_CHORD_MEMORY && m_chord_on) {
         chord_off();
         m_converter->reset();
         active_chord_base_note = note;
@@ -149,10 +233,10 @@ void Synth::note_on(uint8_t channel, uint8_t note, uint8_t velocity) {
             uint8_t chord_note = note + diff;
             m_converter->note_on(channel, chord_note, velocity);
         }
-        m_update_dcos();
+        m_update_dcos(true);
     } else {
         m_converter->note_on(channel, note, velocity);
-        m_update_dcos();
+        m_update_dcos(true);
 
         // Save played notes to history
         if (!m_no_of_played_notes) {
@@ -167,12 +251,11 @@ void Synth::note_on(uint8_t channel, uint8_t note, uint8_t velocity) {
         m_increase_no_of_played_notes();
     }
 
+    m_update_gate();
+
     // Velocity
     m_last_velocity = m_converter->get_main_velocity();
     m_update_filter_mod(m_last_velocity);     // Only update KB tracking output on note on
-
-    // Pitch bend
-    m_last_midi_pitch_bend = 0;
 }
 
 /**
@@ -183,7 +266,7 @@ void Synth::note_off(uint8_t channel, uint8_t note, uint8_t velocity) {
     if (channel != MIDI_CHANNEL) return;
 
     if (note < LOWEST_MIDI_NOTE) return;
-    if (ENABLE_CHORD_MEMORY && m_ui.chord_on) {
+    if (ENABLE_CHORD_MEMORY && m_chord_on) {
         if (m_no_of_played_notes) {
             m_no_of_played_notes = 0;
         }
@@ -195,13 +278,15 @@ void Synth::note_off(uint8_t channel, uint8_t note, uint8_t velocity) {
             uint8_t chord_note = note + diff;
             m_converter->note_off(channel, chord_note, velocity);
         }
-        m_update_dcos();
+        m_update_dcos(true);
     } else {
         m_converter->note_off(channel, note, velocity);
-        m_update_dcos();
+        m_update_dcos(true);
         m_remove_played_note(note);
         m_decrease_no_of_played_notes();
     }
+
+    m_update_gate();
 }
 
 void Synth::chord_off() {
@@ -223,8 +308,27 @@ void Synth::cc(uint8_t channel, uint8_t data1, uint8_t data2) {
 
     if (data1 == 1) { // CC value 1 = modwheel
         m_modwheel = data2;
+        if (ENABLE_LFO) {
+            m_push_lfo_amount();
+        } else {
+            m_update_filter_mod(m_last_velocity);
+        }
+    }
+
+    if (ENABLE_LFO) {
+        switch (data1) {
+        case CC_LFO_RATE:
+            m_push_event(OUTPUT_LFO_RATE, data2);
+            break;
+        case CC_LFO_DEPTH:
+            m_lfo_depth = data2;
+            m_push_lfo_amount();
+            break;
+        case CC_LFO_SHAPE:
+            m_push_event(OUTPUT_LFO_SHAPE, data2 * NO_OF_LFO_SHAPES / 128);
+            break;
+        }
     }
-    m_update_filter_mod(m_last_velocity);
 }
 
 /**
@@ -234,11 +338,7 @@ void Synth::cc(uint8_t channel, uint8_t data1, uint8_t data2) {
 void Synth::pitch_bend(uint8_t channel, uint16_t bend) {
     if (channel != MIDI_CHANNEL) return;
 
-    // m_converter->update_pitch_bend(bend);
-    // m_update_dcos();
-
-    m_midi_pitch_bend = bend;
-    m_pitch_bend_dirty = (m_midi_pitch_bend != m_last_midi_pitch_bend);
+    m_push_event(OUTPUT_PITCH_BEND, bend);
 }
 
 /**
@@ -247,62 +347,77 @@ void Synth::pitch_bend(uint8_t channel, uint16_t bend) {
 */
 void Synth::set_adsr(bool soft, bool hold, bool ring) {
     int shr = (soft << 2) | (hold << 1) | ring;
+    uint64_t attack, decay, release;
+    int sustain;
 
     switch (shr) {
     case 0b001:
-        m_attack = ATTACK_SHORT;
-        m_decay = m_ui.decay_long * 100000;
-        m_sustain = SUSTAIN_OFF;
-        m_release = RELEASE_SHORT;
+        attack = ATTACK_SHORT;
+        decay = m_ui.decay_long * 100000;
+        sustain = SUSTAIN_OFF;
+        release = RELEASE_SHORT;
         break;
     case 0b010:
-        m_attack = ATTACK_SHORT;
-        m_decay = DECAY_SHORT;
-        m_sustain = SUSTAIN_ON;
-        m_release = RELEASE_SHORT;
+        attack = ATTACK_SHORT;
+        decay = DECAY_SHORT;
+        sustain = SUSTAIN_ON;
+        release = RELEASE_SHORT;
         break;
     case 0b011:
-        m_attack = ATTACK_SHORT;
-        m_decay = DECAY_SHORT;
-        m_sustain = SUSTAIN_ON;
-        m_release = m_ui.release_long * 100000;
+        attack = ATTACK_SHORT;
+        decay = DECAY_SHORT;
+        sustain = SUSTAIN_ON;
+        release = m_ui.release_long * 100000;
         break;
     case 0b100:
-        m_attack = ATTACK_LONG;
-        m_decay = DECAY_SHORT;
-        m_sustain = SUSTAIN_OFF;
-        m_release = RELEASE_SHORT;
+        attack = ATTACK_LONG;
+        decay = DECAY_SHORT;
+        sustain = SUSTAIN_OFF;
+        release = RELEASE_SHORT;
         break;
     case 0b101:
-        m_attack = ATTACK_LONG;
-        m_decay = m_ui.decay_long * 100000;
-        m_sustain = SUSTAIN_OFF;
-        m_release = RELEASE_SHORT;
+        attack = ATTACK_LONG;
+        decay = m_ui.decay_long * 100000;
+        sustain = SUSTAIN_OFF;
+        release = RELEASE_SHORT;
         break;
     case 0b110:
-        m_attack = ATTACK_LONG;
-        m_decay = DECAY_SHORT;
-        m_sustain = SUSTAIN_ON;
-        m_release = RELEASE_SHORT;
+        attack = ATTACK_LONG;
+        decay = DECAY_SHORT;
+        sustain = SUSTAIN_ON;
+        release = RELEASE_SHORT;
         break;
     case 0b111:
-        m_attack = ATTACK_LONG;
-        m_decay = DECAY_SHORT;
-        m_sustain = SUSTAIN_ON;
-        m_release = m_ui.release_long * 100000;
+        attack = ATTACK_LONG;
+        decay = DECAY_SHORT;
+        sustain = SUSTAIN_ON;
+        release = m_ui.release_long * 100000;
         break;
     default:
-        m_attack = ATTACK_SHORT;
-        m_decay = DECAY_MID;
-        m_sustain = SUSTAIN_OFF;
-        m_release = RELEASE_SHORT;
+        attack = ATTACK_SHORT;
+        decay = DECAY_MID;
+        sustain = SUSTAIN_OFF;
+        release = RELEASE_SHORT;
         break;
     }
 
-    m_adsr.set_attack(m_attack);
-    m_adsr.set_decay(m_decay);
-    m_adsr.set_sustain(m_sustain);
-    m_adsr.set_release(m_release);
+    // Only send values that changed
+    if (attack != m_attack) {
+        m_attack = attack;
+        m_push_event(OUTPUT_ATTACK, m_attack);
+    }
+    if (decay != m_decay) {
+        m_decay = decay;
+        m_push_event(OUTPUT_DECAY, m_decay);
+    }
+    if (sustain != m_sustain) {
+        m_sustain = sustain;
+        m_push_event(OUTPUT_SUSTAIN, m_sustain);
+    }
+    if (release != m_release) {
+        m_release = release;
+        m_push_event(OUTPUT_RELEASE, m_release);
+    }
 }
 
 /** ----------------------------------------------------------------------------
@@ -310,199 +425,571 @@ void Synth::set_adsr(bool soft, bool hold, bool ring) {
 */
 
 /**
- * Reads incoming MIDI messages via MidiParser parent class. This function is
- * called for infinity from the main loop.
+ * Reads incoming MIDI messages via BatchMidiParser parent class. This function
+ * is called for infinity from the main loop. Bytes are collected by the UART
+ * interrupt in the background, here we parse everything that arrived since
+ * the last call, straight from the receive buffer. The parser calls this
+ * class's midi message methods such as note_on, note_off etc.
 */
 void Synth::m_read_midi() {
-    if (!uart_is_readable(MIDI_UART_INSTANCE)) return;
-
-    uint8_t data = uart_getc(MIDI_UART_INSTANCE);
-    m_input_buffer.write_byte(data);
+    PROFILE(PROFILE_READ_MIDI);
 
-    while (!m_input_buffer.is_empty()) {
-        uint8_t byte = 0;
-        m_input_buffer.read_byte(byte);
+    // The latency tracer needs the receive time of each byte
+    if (ENABLE_LATENCY_TRACE) {
+        uint8_t data = 0;
+        while (m_midi_input.read(data, m_midi_us)) {
+            parse_bytes(&data, 1);
+        }
 
-        // Parent class call which will eventually call this class's midi
-        // message methods such as note_on, note_off etc.
-        this->parse_byte(byte);
+        // Anything else (glide, UI) is not traced
+        m_midi_us = 0;
+        return;
     }
-}
 
-void Synth::m_set_frequency(PIO pio, uint sm, float freq) {
-    uint32_t clk_div = clock_get_hz(clk_sys) / 2 / freq;
-    if (freq == 0) clk_div = 0;
-    pio_sm_put(pio, sm, clk_div);
-    pio_sm_exec(pio, sm, pio_encode_pull(false, false));
-    pio_sm_exec(pio, sm, pio_encode_out(pio_y, 32));
+    const uint8_t *data;
+    size_t length;
+    while ((length = m_midi_input.peek(data))) {
+        parse_bytes(data, length);
+        m_midi_input.consume(length);
+    }
 }
 
 /**
- * Updates DCOs
+ * Calculates the DCO pitches of the current mode and sends them to the output
+ * side. Pitch bend is applied by the output side. On note events (sync) the
+ * changed voices are restarted together so voices playing the same note are
+ * in phase.
 */
-void Synth::m_update_dcos(void) {
+void Synth::m_update_dcos(bool sync) {
+    PROFILE(PROFILE_UPDATE_DCOS);
+
     if (m_converter->is_dirty()) {
-        // Sometimes the delay in setting the frequency of the PIOs can cause them
-        // to be out of phase by 180deg. This causes phase cancellation with voices
-        // playing the same note (e.g. in mono mode). To minimise the chances of
-        // this, first calculate the frequencies and amplitudes (which require time)
-        // and set the frequency and amp only after then, in a separate loop.
-        float freq;
-        int amp;
-        float freqs[VOICES];
-        uint16_t amps[VOICES];
+        int32_t pitch;
+        int32_t pitches[VOICES];
 
         switch (settings.mode)
         {
         case MONO:
-            freq = m_converter->get_freq(0);
-            amp = m_converter->amp_for_frequency(freq); // (int)(DIV_COUNTER * freq / MAX_FREQ);
-
-            m_set_frequency(settings.pio[settings.voice_to_pio[0]], settings.voice_to_sm[0], freq);
-            pwm_set_chan_level(m_amp_pwm_slices[0], pwm_gpio_to_channel(settings.amp_pins[0]), amp);
-            return;
+            pitches[0] = m_converter->get_pitch(0);
             break;
 
         case FAT_MONO:
-            freq = m_converter->get_freq(0);
+            pitch = m_converter->get_pitch(0);
 
-            freqs[0] = freqs[1] = freqs[2] = freq;
-            if (settings.detune) {
-                freqs[1] = freq * DETUNE_FACTOR;
-                freqs[2] = freq * (1.0 - (DETUNE_FACTOR - 1.0));
-            }
-            for (int voice = 0; voice < FAT_MONO_VOICES; voice++) {
-                // amps[voice] = (int)(DIV_COUNTER * freqs[voice] / MAX_FREQ);
-                amps[voice] = m_converter->amp_for_frequency(freqs[voice]);
+            pitches[0] = pitches[1] = pitches[2] = pitch;
+            if (settings.detune && pitch != PITCH_OFF) {
+                pitches[1] = pitch + DETUNE_CENTS;
+                pitches[2] = pitch - DETUNE_CENTS;
             }
             break;
 
         case PARA:
             for (int voice = 0; voice < VOICES; voice++) {
-                freqs[voice] = m_converter->get_freq(voice);
-                amps[voice] = m_converter->amp_for_frequency(freqs[voice]); //(int)(DIV_COUNTER * freqs[voice] / MAX_FREQ);
+                pitches[voice] = m_converter->get_pitch(voice);
             }
             break;
         }
 
         for (int voice = 0; voice < m_voices; voice++) {
-            m_set_frequency(settings.pio[settings.voice_to_pio[voice]], settings.voice_to_sm[voice], freqs[voice]);
-            pwm_set_chan_level(m_amp_pwm_slices[voice], pwm_gpio_to_channel(settings.amp_pins[voice]), amps[voice]);
+            m_push_voice(voice, pitches[voice]);
+        }
+
+        if (sync) {
+            m_push_event(OUTPUT_SYNC, 0);
         }
     }
 }
 
-void Synth::m_apply_mods() {
-    switch (settings.mode)
-    {
-    case MONO:
-        if (settings.portamento && m_converter->is_dirty() || m_pitch_bend_dirty) {
-            float freq = m_converter->get_freq(0);
-
-            m_last_midi_pitch_bend = m_midi_pitch_bend;
-            freq = m_pitch_bend_freq(freq, m_midi_pitch_bend);
-
-            int amp = m_converter->amp_for_frequency(freq); // (int)(DIV_COUNTER * freq / MAX_FREQ);
+/**
+ * Applies the whole panel, after UI events were lost. Chord button presses
+ * are not a state, those can't be recovered.
+*/
+void Synth::m_resync_ui() {
+    set_adsr(m_ui.get_switch(SOFT), m_ui.get_switch(HOLD), m_ui.get_switch(RING));
+    set_portamento(m_ui.get_switch(PORTAMENTO));
+    set_detune(m_ui.get_switch(DETUNE));
+    set_solo(m_ui.get_switch(SOLO_CHORD));
+    set_kb_tracking(m_ui.get_switch(KB_TRACKING));
+    set_velo_tracking(m_ui.get_switch(WAH_VELOCITY));
+
+    if (m_ui.synth_mode != settings.mode) {
+        set_mode(m_ui.synth_mode);
+    }
+}
 
-            m_set_frequency(settings.pio[settings.voice_to_pio[0]], settings.voice_to_sm[0], freq);
-            pwm_set_chan_level(m_amp_pwm_slices[0], pwm_gpio_to_channel(settings.amp_pins[0]), amp);
+/**
+ * Applies a change of the panel. ADSR settings depend on more switches and the
+ * ring length pot, so they're set together.
+*/
+void Synth::m_handle_ui_event(ui_event &event) {
+    switch (event.type) {
+    case UI_SWITCH:
+        switch (event.id) {
+        case SOFT:
+        case HOLD:
+        case RING:
+            set_adsr(m_ui.get_switch(SOFT), m_ui.get_switch(HOLD), m_ui.get_switch(RING));
+            break;
+        case PORTAMENTO:
+            set_portamento(event.value);
+            break;
+        case DETUNE:
+            set_detune(event.value);
+            break;
+        case SOLO_CHORD:
+            set_solo(event.value);
+            break;
+        case KB_TRACKING:
+            set_kb_tracking(event.value);
+            break;
+        case WAH_VELOCITY:
+            set_velo_tracking(event.value);
+            break;
         }
         break;
-
-    case FAT_MONO:
-        if (settings.portamento && m_converter->is_dirty() || m_pitch_bend_dirty) {
-            float freq = m_converter->get_freq(0);
-
-            m_last_midi_pitch_bend = m_midi_pitch_bend;
-            freq = m_pitch_bend_freq(freq, m_midi_pitch_bend);
-
-            float freqs[VOICES];
-            freqs[0] = freqs[1] = freqs[2] = freq;
-            if (settings.detune) {
-                freqs[1] = freq * DETUNE_FACTOR;
-                freqs[2] = freq * (1.0 - (DETUNE_FACTOR - 1.0));
-            }
-
-            for (int voice = 0; voice < FAT_MONO_VOICES; voice++) {
-                m_set_frequency(settings.pio[settings.voice_to_pio[voice]], settings.voice_to_sm[voice], freqs[voice]);
-                // pwm_set_chan_level(m_amp_pwm_slices[voice], pwm_gpio_to_channel(settings.amp_pins[voice]), (int)(DIV_COUNTER * freqs[voice] / MAX_FREQ));
-                pwm_set_chan_level(m_amp_pwm_slices[voice], pwm_gpio_to_channel(settings.amp_pins[voice]), m_converter->amp_for_frequency(freqs[voice]));
-            }
-        }
+    case UI_RING_LENGTH:
+        set_adsr(m_ui.get_switch(SOFT), m_ui.get_switch(HOLD), m_ui.get_switch(RING));
         break;
-
-    case PARA:
-        if (m_pitch_bend_dirty) {
-            for (int voice = 0; voice < VOICES; voice++) {
-                float freq = m_converter->get_freq(voice);
-                uint16_t amp = m_converter->amp_for_frequency(freq);
-                m_last_midi_pitch_bend = m_midi_pitch_bend;
-                freq = m_pitch_bend_freq(freq, m_midi_pitch_bend);
-                m_set_frequency(settings.pio[settings.voice_to_pio[voice]], settings.voice_to_sm[voice], freq);
-                // pwm_set_chan_level(m_amp_pwm_slices[voice], pwm_gpio_to_channel(settings.amp_pins[voice]), (int)(DIV_COUNTER * freq / MAX_FREQ));
-                pwm_set_chan_level(m_amp_pwm_slices[voice], pwm_gpio_to_channel(settings.amp_pins[voice]), amp);
-            }
+    case UI_MODE:
+        if (event.value != settings.mode) {
+            set_mode(static_cast<device_mode>(event.value));
         }
         break;
-
-    default:
+    case UI_CHORD:
+        m_set_chord_on(!m_chord_on);
+        m_set_chord();
+        break;
+    case UI_CHORD_RESET:
+        // A long press clears the chord, but only while it's on
+        if (m_chord_on) {
+            m_set_chord_on(false);
+            m_reset_chord = true;
+            m_set_chord();
+        }
         break;
     }
 }
 
-void Synth::m_update_envelope() {
+/**
+ * Moves the glides of the converter and updates the DCOs while they're
+ * gliding. All the gliding voices are updated in one go, and only the changed
+ * pitches are sent.
+*/
+void Synth::m_update_portamento() {
+    uint32_t now = time_us_32();
 
-    // Trigger ADSR only if the gate is on and it's not already on
-    if (m_converter->get_gate() && !m_adsr.is_on()) {
-        m_adsr.note_on();
-    } else if (!m_converter->get_gate() && m_adsr.is_on()) {
-        m_adsr.note_off();
+    if (settings.portamento && m_converter->is_dirty()) {
+        m_converter->update(now);
+        m_update_dcos();
+
+        if (DEBUG_LOOP_JITTER) {
+            uint32_t time = time_us_32() - now;
+            if (time > m_max_glide_time_us) m_max_glide_time_us = time;
+        }
     }
+}
+
+uint32_t Synth::take_max_glide_time_us() {
+    uint32_t time = m_max_glide_time_us;
+    m_max_glide_time_us = 0;
+    return time;
+}
 
-    // Set DAC channel A. TODO: update MCP48X2 library to be able to set
-    // channel with its own method
-    m_dac.config(MCP48X2_CHANNEL_A, MCP48X2_GAIN_X2, 1);
-    m_dac.write(m_adsr.envelope());
+/**
+ * Sends the gate to the output side when it changes. It's called after each
+ * note event so that a quick note off + note on retriggers the envelope.
+*/
+void Synth::m_update_gate() {
+    bool gate = m_converter->get_gate();
+    if (gate != m_gate) {
+        m_gate = gate;
+        m_push_event(OUTPUT_GATE, m_gate);
+    }
 }
 
 void Synth::m_update_filter_mod(uint8_t velocity) {
     int kb_mv = 0;
 
     if (settings.kb_tracking) {
-        int freq = (int)m_converter->get_freq(0);
+        int freq = Pitch::freq(m_converter->get_pitch(0));
         if (freq < KB_TRACK_MIN_FREQ) {
             freq = KB_TRACK_MIN_FREQ;
         } else if (freq > KB_TRACK_MAX_FREQ) {
             freq = KB_TRACK_MAX_FREQ;
         }
         kb_mv = Utils::map(freq, KB_TRACK_MIN_FREQ, KB_TRACK_MAX_FREQ, 0, FILTER_MOD_DAC_SIZE - 1);
-        kb_mv = (int)((float)kb_mv * KB_TRACK_FACTOR);
+        kb_mv = kb_mv * (int)(KB_TRACK_FACTOR * 10) / 10;
     }
 
     if (settings.velo_tracking) {
         kb_mv += velocity * VELO_FACTOR;
     }
 
-    int modwheel_mv = Utils::map(m_modwheel, 0, 127, 0, FILTER_MOD_DAC_SIZE - 1);
-    kb_mv += modwheel_mv;
+    if (!ENABLE_LFO) {
+        kb_mv += Utils::map(m_modwheel, 0, 127, 0, FILTER_MOD_DAC_SIZE - 1);
+    }
 
     if (kb_mv >= FILTER_MOD_DAC_SIZE) {
         kb_mv = FILTER_MOD_DAC_SIZE - 1;
     }
 
-    m_dac.config(MCP48X2_CHANNEL_B, MCP48X2_GAIN_X2, 1);
-    m_dac.write(kb_mv);
+    m_push_filter_mod(kb_mv);
 }
 
 void Synth::m_reset_filter_mod() {
     if (!settings.kb_tracking && !settings.velo_tracking) {
-        m_dac.config(MCP48X2_CHANNEL_B, MCP48X2_GAIN_X2, 1);
-        m_dac.write(Utils::map(m_modwheel, 0, 127, 0, FILTER_MOD_DAC_SIZE - 1));
+        m_push_filter_mod(ENABLE_LFO ? 0 : Utils::map(m_modwheel, 0, 127, 0, FILTER_MOD_DAC_SIZE - 1));
+    }
+}
+
+/**
+ * Sends the filter mod to the output side if it has changed, so a flood of
+ * CC messages doesn't flood the output side too.
+*/
+void Synth::m_push_filter_mod(int value) {
+    if (value == m_sent_filter_mod) return;
+    m_sent_filter_mod = value;
+    m_push_event(OUTPUT_FILTER_MOD, value);
+}
+
+void Synth::m_push_lfo_amount() {
+    m_push_event(OUTPUT_LFO_AMOUNT, m_lfo_depth * m_modwheel);
+}
+
+void Synth::m_push_event(uint8_t type, uint32_t value) {
+    output_event event;
+    event.type = type;
+    event.voice = 0;
+    event.value = value;
+    event.midi_us = m_midi_us;
+    m_send_event(event);
+}
+
+/**
+ * Sends a voice to the output side if its pitch has changed
+*/
+void Synth::m_push_voice(uint8_t voice, int32_t pitch) {
+    if (pitch == m_sent_pitches[voice]) return;
+    m_sent_pitches[voice] = pitch;
+
+    output_event event;
+    event.type = OUTPUT_VOICE;
+    event.voice = voice;
+    event.pitch = pitch;
+    event.midi_us = m_midi_us;
+    m_send_event(event);
+}
+
+void Synth::m_send_event(output_event &event) {
+    if (queue_try_add(&m_output_queue, &event)) return;
+
+    // On a single core nobody else empties the queue, so do it here
+    if (!ENABLE_DUAL_CORE) {
+        m_read_output_events();
+    }
+    queue_add_blocking(&m_output_queue, &event);
+}
+
+/**
+ * Output side: applies all the events that the control side has sent since
+ * the last call. DCOs are not updated here, only marked as dirty, so that they
+ * can be updated together in m_apply_mods().
+*/
+void Synth::m_read_output_events() {
+    output_event event;
+
+    while (queue_try_remove(&m_output_queue, &event)) {
+        switch (event.type) {
+        case OUTPUT_VOICE:
+            m_voice_pitches[event.voice] = event.pitch;
+            m_dirty_voices |= (1 << event.voice);
+            m_voice_midi_us[event.voice] = event.midi_us;
+            break;
+        case OUTPUT_SYNC:
+            m_sync_voices |= m_dirty_voices;
+            break;
+        case OUTPUT_GATE:
+            m_output_gate = event.value;
+            m_gate_midi_us = event.midi_us;
+            break;
+        case OUTPUT_PITCH_BEND:
+            m_midi_pitch_bend = event.value;
+            m_bend_midi_us = event.midi_us;
+            break;
+        case OUTPUT_FILTER_MOD:
+            m_filter_mod = event.value;
+            m_commit_filter_mod();
+            break;
+        case OUTPUT_ATTACK:
+            m_adsr.set_attack(event.value);
+            break;
+        case OUTPUT_DECAY:
+            m_adsr.set_decay(event.value);
+            break;
+        case OUTPUT_SUSTAIN:
+            m_adsr.set_sustain(event.value);
+            break;
+        case OUTPUT_RELEASE:
+            m_adsr.set_release(event.value);
+            break;
+        case OUTPUT_MODE:
+            m_set_output_mode(static_cast<device_mode>(event.value));
+            break;
+        case OUTPUT_LFO_RATE:
+            m_lfo.set_rate(event.value);
+            break;
+        case OUTPUT_LFO_SHAPE:
+            m_lfo.set_shape(static_cast<lfo_shape>(event.value));
+            break;
+        case OUTPUT_LFO_AMOUNT:
+            m_lfo_amount = event.value;
+            break;
+        }
+    }
+}
+
+void Synth::m_set_output_mode(device_mode mode) {
+    switch (mode) {
+    case MONO:
+        m_output_voices = 1;
+        break;
+    case FAT_MONO:
+        m_output_voices = FAT_MONO_VOICES;
+        break;
+    case PARA:
+        m_output_voices = VOICES;
+        break;
+    }
+
+    // Changes queued for the voices of the previous mode are dropped
+    m_dirty_voices = 0;
+    m_sync_voices = 0;
+
+    // Reset all voices to 0V in mono modes
+    if (mode != PARA) {
+        for (int voice = 0; voice < VOICES; voice++) {
+            m_voice_pitches[voice] = PITCH_OFF;
+            pwm_set_chan_level(m_amp_pwm_slices[voice], pwm_gpio_to_channel(settings.amp_pins[voice]), 0);
+            RECORD_OUTPUT(RECORD_AMP, voice, 0);
+        }
     }
 }
 
-float Synth::m_pitch_bend_freq(float freq, uint16_t pitch_bend) {
-    return freq - (freq * ((0x2000 - pitch_bend) / (67000.0f / PITCH_BEND_SEMITONES)));
+/**
+ * Sets the divisor of a running DCO. The programs pick up the new divisor
+ * themselves at the end of a period (or pattern), so it's only one FIFO write.
+ * If the previous divisor is still waiting it's replaced; the program falls
+ * back to the current divisor if it finds the FIFO empty in between.
+*/
+void Synth::m_set_divisor(PIO pio, uint sm, uint32_t divisor) {
+    if (!pio_sm_is_tx_fifo_empty(pio, sm)) {
+        pio_sm_clear_fifos(pio, sm);
+    }
+    pio_sm_put(pio, sm, divisor);
+}
+
+/**
+ * Sets the divisors of the given voices and restarts them at the same time.
+ * The state machines are stopped, loaded with the new divisor and parked on
+ * the `sync` entry of the program, where they wait for the trigger pin. Then
+ * they're enabled, and the trigger starts all of them on the same clock cycle
+ * on both PIOs.
+*/
+void Synth::m_set_divisors_in_sync(uint8_t voices, uint32_t *divisors) {
+    uint32_t sm_masks[2] = {0, 0};
+    for (int voice = 0; voice < VOICES; voice++) {
+        if (voices & (1 << voice)) {
+            sm_masks[settings.voice_to_pio[voice]] |= (1 << settings.voice_to_sm[voice]);
+        }
+    }
+
+    for (int voice = 0; voice < VOICES; voice++) {
+        if (ENABLE_DCO_STREAM && (voices & (1 << voice))) {
+            m_dco_stream.stop(voice);
+        }
+    }
+
+    for (int i = 0; i < 2; i++) {
+        pio_set_sm_mask_enabled(settings.pio[i], sm_masks[i], false);
+        pio_restart_sm_mask(settings.pio[i], sm_masks[i]);
+    }
+
+    for (int voice = 0; voice < VOICES; voice++) {
+        if (voices & (1 << voice)) {
+            PIO pio = settings.pio[settings.voice_to_pio[voice]];
+            uint sm = settings.voice_to_sm[voice];
+            pio_sm_clear_fifos(pio, sm);
+            pio_sm_put(pio, sm, divisors[voice]);
+            pio_sm_exec(pio, sm, pio_encode_set(pio_pins, 0));
+            pio_sm_exec(pio, sm, pio_encode_jmp(m_dco_offsets[settings.voice_to_pio[voice]] + (DCO_FRACTIONAL ? frequency_frac_offset_sync : frequency_offset_sync)));
+        }
+    }
+
+    for (int i = 0; i < 2; i++) {
+        pio_clkdiv_restart_sm_mask(settings.pio[i], sm_masks[i]);
+        pio_set_sm_mask_enabled(settings.pio[i], sm_masks[i], true);
+    }
+
+    // All of them are waiting now, pulse the trigger
+    gpio_set_inover(GP_DCO_SYNC, GPIO_OVERRIDE_HIGH);
+    busy_wait_at_least_cycles(8);
+    gpio_set_inover(GP_DCO_SYNC, GPIO_OVERRIDE_LOW);
+
+    for (int voice = 0; voice < VOICES; voice++) {
+        if (ENABLE_DCO_STREAM && (voices & (1 << voice))) {
+            m_stream_divisors[voice] = divisors[voice];
+            m_dco_stream.start(voice, divisors[voice]);
+        }
+    }
+}
+
+/**
+ * Renders the next block of the DCO streams that need it, with the latest
+ * divisors. The stream ramps to them over the periods of the block.
+*/
+void Synth::m_render_dco_streams() {
+    for (int voice = 0; voice < VOICES; voice++) {
+        if (m_dco_stream.needs_block(voice)) {
+            m_dco_stream.render_block(voice, m_stream_divisors[voice]);
+        }
+    }
+}
+
+/**
+ * Moves the LFO and works out its pitch and filter mod. These are only
+ * committed by m_apply_mods() and m_commit_filter_mod() if they changed.
+*/
+void Synth::m_update_lfo() {
+    if (!m_lfo.update(time_us_32())) return;
+
+    // LFO_MAX * 127 * 127 still fits
+    int32_t value = m_lfo.get_value() * m_lfo_amount / (127 * 127);
+
+    if (LFO_TO_PITCH) {
+        m_lfo_cents = value * LFO_PITCH_DEPTH / LFO_MAX;
+    }
+
+    if (LFO_TO_FILTER) {
+        m_lfo_filter_mod = value * LFO_FILTER_DEPTH / LFO_MAX;
+        m_commit_filter_mod();
+    }
+}
+
+void Synth::m_commit_filter_mod() {
+    int32_t value = m_filter_mod + m_lfo_filter_mod;
+    if (value < 0) value = 0;
+    if (value >= FILTER_MOD_DAC_SIZE) value = FILTER_MOD_DAC_SIZE - 1;
+    m_dac.set_filter_mod(value);
+}
+
+/**
+ * Applies the pitch mods (bend and LFO) and updates the voices that changed.
+ * If the pitch mod changed then all voices of the mode are updated.
+*/
+void Synth::m_apply_mods() {
+    PROFILE(PROFILE_APPLY_MODS);
+
+    // Voices above the mode's (e.g. queued before a mode change) have no
+    // divisor calculated, they're never set
+    uint8_t mode_voices = (1 << m_output_voices) - 1;
+    uint8_t voices = m_dirty_voices & mode_voices;
+    int32_t pitch_mod = m_pitch_bend_cents(m_midi_pitch_bend) + m_lfo_cents;
+    if (pitch_mod != m_pitch_mod) {
+        m_pitch_mod = pitch_mod;
+        voices = mode_voices;
+    } else {
+        // The bend didn't change the pitch (e.g. it's the same value again)
+        m_bend_midi_us = 0;
+    }
+    if (!voices) {
+        m_dirty_voices = 0;
+        m_sync_voices = 0;
+        return;
+    }
+
+    // Voices changed by a note event are restarted together so they're in
+    // phase, otherwise voices playing the same note (e.g. in mono mode) can
+    // cancel each other. Other changes (pitch bend, LFO, glide steps) are set
+    // without a restart to keep the waveform continuous. Either way calculate
+    // all the divisors first (which require time) and set them after that.
+    uint32_t divisors[VOICES];
+    for (int voice = 0; voice < m_output_voices; voice++) {
+        if (voices & (1 << voice)) {
+            divisors[voice] = 0;
+            if (m_voice_pitches[voice] != PITCH_OFF) {
+                divisors[voice] = Pitch::divisor(m_voice_pitches[voice] + m_pitch_mod);
+            }
+        }
+    }
+
+    uint8_t sync_voices = voices & m_sync_voices;
+    if (sync_voices) {
+        m_set_divisors_in_sync(sync_voices, divisors);
+        RECORD_OUTPUT(RECORD_SYNC, 0, sync_voices);
+    }
+
+    for (int voice = 0; voice < m_output_voices; voice++) {
+        if (voices & (1 << voice)) {
+            if (ENABLE_DCO_STREAM) {
+                m_stream_divisors[voice] = divisors[voice];
+            } else if (!(sync_voices & (1 << voice))) {
+                m_set_divisor(settings.pio[settings.voice_to_pio[voice]], settings.voice_to_sm[voice], divisors[voice]);
+            }
+            uint16_t amp = Pitch::amp(divisors[voice]);
+            pwm_set_chan_level(m_amp_pwm_slices[voice], pwm_gpio_to_channel(settings.amp_pins[voice]), amp);
+            RECORD_OUTPUT(RECORD_DIVISOR, voice, divisors[voice]);
+            RECORD_OUTPUT(RECORD_AMP, voice, amp);
+        }
+    }
+
+    if (ENABLE_LATENCY_TRACE) {
+        m_trace_dcos(voices);
+    }
+
+    m_dirty_voices = 0;
+    m_sync_voices = 0;
+}
+
+/**
+ * Latency tracer: the divisors of the voices are in the PIO FIFOs (or the DCO
+ * streams) now, record the time since the MIDI messages that changed them
+*/
+void Synth::m_trace_dcos(uint8_t voices) {
+    for (int voice = 0; voice < m_output_voices; voice++) {
+        if (voices & (1 << voice)) {
+            TRACE_LATENCY(TRACE_NOTE_DCO, m_voice_midi_us[voice]);
+            m_voice_midi_us[voice] = 0;
+        }
+    }
+
+    TRACE_LATENCY(TRACE_PITCH_BEND, m_bend_midi_us);
+    m_bend_midi_us = 0;
+}
+
+void Synth::m_update_envelope() {
+    PROFILE(PROFILE_UPDATE_ENVELOPE);
+
+    // Trigger ADSR only if the gate is on and it's not already on
+    if (m_output_gate && !m_adsr.is_on()) {
+        m_adsr.note_on();
+        TRACE_LATENCY(TRACE_GATE_ON, m_gate_midi_us);
+        m_gate_midi_us = 0;
+    } else if (!m_output_gate && m_adsr.is_on()) {
+        m_adsr.note_off();
+        TRACE_LATENCY(TRACE_GATE_OFF, m_gate_midi_us);
+        m_gate_midi_us = 0;
+    }
+
+    // Channel A of the DAC is streamed by DMA, only render the next block when
+    // the previous one is being played. This is the only place the ADSR is
+    // read, once per block.
+    if (m_dac.needs_block()) {
+        m_dac.render_block(m_adsr.envelope());
+    }
+}
+
+int32_t Synth::m_pitch_bend_cents(uint16_t pitch_bend) {
+    return ((int32_t)pitch_bend - PITCH_BEND_CENTER) * PITCH_BEND_SEMITONES * CENTS_PER_NOTE / PITCH_BEND_CENTER;
 }
 
 void Synth::m_increase_no_of_played_notes() {
@@ -557,13 +1044,23 @@ void Synth::m_reset_chord_notes() {
     }
 }
 
+/**
+ * The chord LED shows the state, it's only changed here
+*/
+void Synth::m_set_chord_on(bool chord_on) {
+    m_chord_on = chord_on;
+    if (ENABLE_CHORD_MEMORY) {
+        gpio_put(LED_CHORD, chord_on);
+    }
+}
+
 void Synth::m_set_chord() {
-    if (settings.mode != PARA && m_ui.chord_on) {
-        m_ui.chord_on = false;
+    if (settings.mode != PARA && m_chord_on) {
+        m_set_chord_on(false);
         return;
     }
 
-    if (m_ui.chord_on) {
+    if (m_chord_on) {
         if (!m_chord_set) {
             m_reset_chord_notes();
             m_no_of_chord_notes = 0;
@@ -583,7 +1080,7 @@ void Synth::m_set_chord() {
 
                 // Turn off chord if there's no notes to build a chord from
                 if (!m_chord_set) {
-                    m_ui.chord_on = false;
+                    m_set_chord_on(false);
                 }
             } else {
                 for (int i = 0; i < VOICES; i++) {
@@ -602,9 +1099,9 @@ void Synth::m_set_chord() {
         }
     } else {
         chord_off();
-        if (m_chord_set && m_ui.reset_chord) {
+        if (m_chord_set && m_reset_chord) {
             m_reset_chord_notes();
-            m_ui.reset_chord = false;
+            m_reset_chord = false;
             m_chord_set = false;
             m_record_history = true;
         }
@@ -6,26 +6,63 @@
 #include "math.h"
 
 #include "hardware/pio.h"
+#include "frequency.pio.h"
 #include "hardware/clocks.h"
 #include "hardware/pwm.h"
+#include "pico/util/queue.h"
 
 #include <utils.h>
 #include <midi_parser.h>
-#include <ringbuffer.h>
 #include <adsr.h>
-#include <mcp48x2.h>
 
+#include "midi_input.h"
+#include "batch_midi_parser.h"
+#include "dac_output.h"
+#include "dco_stream.h"
+#include "lfo.h"
+#include "profiler.h"
+#include "recorder.h"
 #include "i_converter.h"
 #include "./converters/para.h"
 #include "./converters/mono.h"
 
-#define MIDI_BUFFER_SIZE 32
+#define OUTPUT_QUEUE_SIZE 64
 #define MIDDLE_C 60
 #define TOP_NOTE 127
 
 // const uint16_t DIV_COUNTER = 1250;
 
-class Synth: public MidiParser {
+// Events sent from the control side (MIDI, converters, UI) to the output side
+// (DCOs, amps, envelope and filter mod DAC). With ENABLE_DUAL_CORE these run on
+// different cores.
+enum output_event_type {
+    OUTPUT_VOICE,           // voice, pitch: cents
+    OUTPUT_SYNC,            // restart the voices changed so far in phase
+    OUTPUT_GATE,            // value: 0 or 1
+    OUTPUT_PITCH_BEND,      // value: 14 bit MIDI pitch bend
+    OUTPUT_FILTER_MOD,      // value: DAC channel B value
+    OUTPUT_ATTACK,          // value: us
+    OUTPUT_DECAY,           // value: us
+    OUTPUT_SUSTAIN,         // value: DAC value
+    OUTPUT_RELEASE,         // value: us
+    OUTPUT_MODE,            // value: device_mode
+    OUTPUT_LFO_RATE,        // value: 0-127
+    OUTPUT_LFO_SHAPE,       // value: lfo_shape
+    OUTPUT_LFO_AMOUNT       // value: depth * modwheel, 0-127*127
+};
+
+struct output_event {
+    uint8_t type;
+    uint8_t voice;
+    union {
+        uint32_t value;
+        int32_t pitch;
+    };
+    uint32_t midi_us;       // Receive time of the MIDI message that caused it,
+                            // 0 if it's not from MIDI or not traced
+};
+
+class Synth: public BatchMidiParser {
 public:
     static Synth& get_instance() {
         static Synth instance;
@@ -36,7 +73,27 @@ public:
 
     void init(device_mode default_mode);
     void init_dcos();
-    void process();
+    // Control side tasks
+    bool has_midi();
+    void process_midi();
+    bool has_ui_events();
+    void process_ui();
+    void process_glide();
+
+    // Output side task
+    bool has_output_events();
+    void process_output();
+
+    // Time spent on pitch modulation on the output side since the last call,
+    // only measured if DEBUG_LOOP_JITTER is on
+    uint32_t take_mod_time_us();
+
+    // DCO stream blocks that weren't rendered in time since the last call
+    uint32_t take_dco_underruns();
+
+    // Worst time of a glide step (all voices) since the last call, only
+    // measured if DEBUG_LOOP_JITTER is on
+    uint32_t take_max_glide_time_us();
 
     void note_on(uint8_t channel, uint8_t note, uint8_t velocity);
     void note_off(uint8_t channel, uint8_t note, uint8_t velocity);
@@ -59,6 +116,8 @@ public:
     int m_history_records = 0;
     bool m_record_history = true;
     bool m_chord_set = false;
+    bool m_chord_on = false;
+    bool m_reset_chord = false;
     int m_note_history[VOICES];
     int active_chord_base_note = -1;
 
@@ -68,33 +127,63 @@ public:
     void m_reset_chord_notes();
     void m_reset_note_history();
     void m_set_chord();
+    void m_set_chord_on(bool chord_on);
     void chord_off();
 
 protected:
     Synth();
 
 private:
+    // Control side
     IConverter *m_converter;
     Mono m_mono;
     Para m_para;
     int m_voices = VOICES;
 
-    uint64_t m_attack;
-    uint64_t m_decay;
-    int m_sustain;
-    uint64_t m_release;
+    uint64_t m_attack = 0;
+    uint64_t m_decay = 0;
+    int m_sustain = -1;
+    uint64_t m_release = 0;
+
+    bool m_gate = false;
+    int32_t m_sent_pitches[VOICES];
+    int m_sent_filter_mod = -1;
+    uint8_t m_lfo_depth = LFO_DEFAULT_DEPTH;
+    volatile uint32_t m_max_glide_time_us = 0;
+    uint32_t m_midi_us = 0;                 // Receive time of the current MIDI byte
 
+    queue_t m_output_queue;
+
+    // Output side
     ADSR m_adsr;
-    MCP48X2 m_dac;
+    DacOutput m_dac;
+    DcoStream m_dco_stream;
 
     uint8_t m_amp_pwm_slices[VOICES];
+    int m_output_voices = VOICES;
+    bool m_output_gate = false;
+    int32_t m_voice_pitches[VOICES];
+    uint8_t m_dirty_voices = 0;
+    uint8_t m_sync_voices = 0;
+    uint m_dco_offsets[2];
+    uint32_t m_stream_divisors[VOICES];
+    volatile uint32_t m_mod_time_us = 0;
+
+    // MIDI receive time of the pending changes for the latency tracer
+    uint32_t m_voice_midi_us[VOICES];
+    uint32_t m_gate_midi_us = 0;
+    uint32_t m_bend_midi_us = 0;
 
-    bool m_pitch_bend_dirty;
     uint16_t m_midi_pitch_bend = 0x2000;
-    uint16_t m_last_midi_pitch_bend = 0x2000;
+    int32_t m_pitch_mod = 0;                // Cents, pitch bend + LFO
+
+    Lfo m_lfo;
+    int32_t m_lfo_amount = 0;
+    int32_t m_lfo_cents = 0;
+    int32_t m_lfo_filter_mod = 0;
+    int32_t m_filter_mod = 0;
 
-    uint8_t m_buffer_var[MIDI_BUFFER_SIZE];
-    RingBuffer m_input_buffer;
+    MidiInput &m_midi_input = MidiInput::get_instance();
 
     uint8_t m_modwheel = 0;
     uint8_t m_last_velocity = 0;
@@ -102,15 +191,32 @@ private:
     UI &m_ui = UI::get_instance();
 
     void m_read_midi();
-    void m_set_frequency(PIO pio, uint sm, float freq);
-    void m_update_dcos(void);
-    void m_apply_mods();
-
-    void m_update_envelope();
+    void m_handle_ui_event(ui_event &event);
+    void m_resync_ui();
+    void m_update_dcos(bool sync = false);
+    void m_update_portamento();
+    void m_update_gate();
     void m_update_filter_mod(uint8_t velocity);
     void m_reset_filter_mod();
 
-    float m_pitch_bend_freq(float freq, uint16_t pitch_bend);
+    void m_push_event(uint8_t type, uint32_t value);
+    void m_push_voice(uint8_t voice, int32_t pitch);
+    void m_push_filter_mod(int value);
+    void m_push_lfo_amount();
+    void m_send_event(output_event &event);
+
+    void m_read_output_events();
+    void m_set_output_mode(device_mode mode);
+    void m_set_divisor(PIO pio, uint sm, uint32_t divisor);
+    void m_set_divisors_in_sync(uint8_t voices, uint32_t *divisors);
+    void m_update_lfo();
+    void m_commit_filter_mod();
+    void m_apply_mods();
+    void m_trace_dcos(uint8_t voices);
+    void m_render_dco_streams();
+    void m_update_envelope();
+
+    int32_t m_pitch_bend_cents(uint16_t pitch_bend);
 };
 
 #endif
\ No newline at end of file
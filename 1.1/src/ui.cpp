@@ -4,7 +4,7 @@ void UI::init() {
     adc_init();
     adc_gpio_init(ADC_RING_LEN_PIN);
     adc_gpio_init(ADC_SYNTH_MODE_PIN);
-    adc_select_input(ADC_RING_LEN_CHANNEL);
+    m_adc.init((1 << ADC_RING_LEN_CHANNEL) | (1 << ADC_SYNTH_MODE_CHANNEL));
 
     // Binary MUX GPIO setup
     gpio_init(MUX_BINARY_PIN_A);
@@ -30,37 +30,125 @@ void UI::init() {
     m_mux_step = 0;
 }
 
+/**
+ * Reads the initial state of everything and sends it as events, so the synth
+ * starts with the settings of the panel
+*/
 void UI::init_scan() {
     for (int i = 0; i < NO_OF_SWITCHES; i++) {
         gpio_put(MUX_BINARY_PIN_A, i & (1 << 0));
         gpio_put(MUX_BINARY_PIN_B, i & (1 << 1));
         gpio_put(MUX_BINARY_PIN_C, i & (1 << 2));
-        bool sw_read = !gpio_get(MUX_BINARY_INPUT);
-        switches[static_cast<mux_switch>(i)] = false;
+        sleep_us(MUX_SETTLE_US);
+        bool value = !gpio_get(MUX_BINARY_INPUT);
+
+        m_switch_reads[i] = 0;
+        if (value) m_switches |= (1 << i);
+        m_push_event(UI_SWITCH, i, value);
     }
 
-    adc_select_input(ADC_RING_LEN_CHANNEL);
-    release_long = adc_read();
+    // Back to the first switch for scan()
+    m_mux_step = 0;
+    gpio_put(MUX_BINARY_PIN_A, 0);
+    gpio_put(MUX_BINARY_PIN_B, 0);
+    gpio_put(MUX_BINARY_PIN_C, 0);
+
+    m_read_pots();
+    m_push_event(UI_RING_LENGTH, 0, release_long);
+    m_push_event(UI_MODE, 0, synth_mode);
 
-    adc_select_input(ADC_SYNTH_MODE_CHANNEL);
-    release_long = adc_read();
+    // Start scanning. The callback runs in the timer IRQ of this core, a
+    // negative delay means the period is from start to start.
+    m_reset_scan_stats();
+    m_last_scan_us = time_us_32();
+    add_repeating_timer_us(-UI_SCAN_PERIOD_US, m_on_scan_timer, NULL, &m_scan_timer);
 }
 
-void UI::scan() {
-    // Read switches (muxed). The CD4051 needs some time to settle after setting
-    // the input address (X0...X7). This is a simple way to add a little delay
-    // to the whole scan cycle. Also note that it only works reliably if the
-    // delay is in between reading the input and setting the address. That's why
-    // here the address is only set after reading the input for the next cycle.
-    if (m_scan_cycle < SCAN_CYCLE) {
-        m_scan_cycle++;
-        updated = false;
-        return;
+/**
+ * Reads the next UI event. Returns false if there's nothing to read.
+*/
+bool UI::read_event(ui_event &event) {
+    uint32_t tail = m_events_tail;
+    if (tail == m_events_head) return false;
+
+    __mem_fence_acquire();
+    event = m_events[tail & (UI_EVENT_QUEUE_SIZE - 1)];
+    m_events_tail = tail + 1;
+    return true;
+}
+
+/**
+ * Returns true if events were lost since the last call. The flag is cleared
+ * before the panel is read, so a change while it's read sets it again.
+*/
+bool UI::take_resync() {
+    if (!m_resync) return false;
+    m_resync = false;
+    return true;
+}
+
+/**
+ * Returns the timing of the scan since the last call. Scans are counted in the
+ * timer IRQ, so the numbers may be off by one scan.
+*/
+ui_scan_stats UI::take_scan_stats() {
+    ui_scan_stats stats = m_scan_stats;
+    m_reset_scan_stats();
+    return stats;
+}
+
+void UI::override_switch(mux_switch sw, bool value) {
+    if (value) {
+        m_switch_override_values |= (1 << sw);
+    } else {
+        m_switch_override_values &= ~(1 << sw);
     }
+    m_switch_overrides |= (1 << sw);
+}
 
-    bool switch_value = !gpio_get(MUX_BINARY_INPUT);
-    mux_switch current_switch = static_cast<mux_switch>(m_mux_step);
-    switches[current_switch] = switch_value;
+void UI::release_overrides() {
+    m_switch_overrides = 0;
+    m_adc.release_overrides();
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+bool UI::m_on_scan_timer(repeating_timer_t *timer) {
+    UI &ui = get_instance();
+    uint32_t start = time_us_32();
+
+    uint32_t interval = start - ui.m_last_scan_us;
+    ui.m_last_scan_us = start;
+    if (interval < ui.m_scan_stats.min_interval_us) ui.m_scan_stats.min_interval_us = interval;
+    if (interval > ui.m_scan_stats.max_interval_us) ui.m_scan_stats.max_interval_us = interval;
+
+    ui.m_scan();
+
+    uint32_t time = time_us_32() - start;
+    if (time > ui.m_scan_stats.max_time_us) ui.m_scan_stats.max_time_us = time;
+    ui.m_scan_stats.scans++;
+
+    return true;
+}
+
+void UI::m_reset_scan_stats() {
+    m_scan_stats.scans = 0;
+    m_scan_stats.min_interval_us = UINT32_MAX;
+    m_scan_stats.max_interval_us = 0;
+    m_scan_stats.max_time_us = 0;
+}
+
+void UI::m_scan() {
+    PROFILE(PROFILE_UI_SCAN);
+
+    // Read switches (muxed). The CD4051 needs some time to settle after setting
+    // the input address (X0...X7). It only works reliably if the delay is in
+    // between reading the input and setting the address. That's why here the
+    // address is only set after reading the input for the next scan, a whole
+    // UI_SCAN_PERIOD_US before the next read.
+    m_read_switch(static_cast<mux_switch>(m_mux_step), !gpio_get(MUX_BINARY_INPUT));
 
     m_mux_step++;
 
@@ -69,57 +157,112 @@ void UI::scan() {
     gpio_put(MUX_BINARY_PIN_C, m_mux_step & (1 << 2));
 
     m_mux_step &= 0x7; // Reset to 0 after 8 steps
-    m_scan_cycle = 0;
 
-    // Read ADC
-    adc_select_input(ADC_RING_LEN_CHANNEL);
-    uint16_t adc_read_value = adc_read();
+    // Read pots, only send events if they changed
+    uint16_t last_decay_long = decay_long;
+    uint16_t last_release_long = release_long;
+    device_mode last_synth_mode = synth_mode;
+    m_read_pots();
 
-    decay_long = Utils::map(adc_read_value >> 4, 0, 256, DECAY_LONG_MIN, DECAY_LONG_MAX);
-    release_long = Utils::map(adc_read_value >> 4, 0, 256, RELEASE_LONG_MIN, RELEASE_LONG_MAX);
-
-    adc_select_input(ADC_SYNTH_MODE_CHANNEL);
-
-    synth_mode = static_cast<device_mode>(Utils::map(adc_read(), 0, 4096, 0, NO_OF_MODES));
-
-    updated = true;
+    if (decay_long != last_decay_long || release_long != last_release_long) {
+        m_push_event(UI_RING_LENGTH, 0, release_long);
+    }
+    if (synth_mode != last_synth_mode) {
+        m_push_event(UI_MODE, 0, synth_mode);
+    }
 
-    // Read chord button
+    // Read chord button. The chord state (and its LED) belongs to the synth,
+    // only the presses are sent.
     if (ENABLE_CHORD_MEMORY) {
         bool chord_is_pushed = !gpio_get(BTN_CHORD);
 
         if (chord_is_pushed && !m_btn_chord_pushed) {
             m_t_chord_pushed = Utils::millis();
             m_btn_chord_pushed = true;
+            m_btn_chord_held = false;
         }
 
         // Not a long press
         if (m_btn_chord_pushed && !chord_is_pushed) {
             uint32_t pushtime = Utils::millis() - m_t_chord_pushed;
             if (pushtime > 50 && pushtime < LONG_PRESS_MILLIS) {
-                chord_on = !chord_on;
+                m_push_event(UI_CHORD, 0, 0);
             }
             m_btn_chord_pushed = false;
 
         // Keep on pushing...
-        } else if (chord_is_pushed && chord_on) {
+        } else if (chord_is_pushed && !m_btn_chord_held) {
             uint32_t pushtime = Utils::millis() - m_t_chord_pushed;
             if (pushtime >= LONG_PRESS_MILLIS) {
-                chord_on = false;
-                reset_chord = true;
+                m_push_event(UI_CHORD_RESET, 0, 0);
+                m_btn_chord_held = true;
             }
         }
-
-        gpio_put(LED_CHORD, chord_on);
     }
 
     // debug();
 }
 
+/**
+ * Debounces a switch: it only changes after reading the new value
+ * SWITCH_DEBOUNCE_READS times in a row, then an event is sent.
+*/
+void UI::m_read_switch(mux_switch sw, bool value) {
+    if (m_switch_overrides & (1 << sw)) {
+        value = m_switch_override_values & (1 << sw);
+    }
+
+    if (value == get_switch(sw)) {
+        m_switch_reads[sw] = 0;
+        return;
+    }
+
+    if (++m_switch_reads[sw] < SWITCH_DEBOUNCE_READS) return;
+
+    m_switch_reads[sw] = 0;
+    m_switches ^= (1 << sw);
+    m_push_event(UI_SWITCH, sw, value);
+}
+
+/**
+ * Updates the pots from the ADC. The ADC samples them in the background, and
+ * they're quantized with hysteresis so they only change if they're moved.
+*/
+void UI::m_read_pots() {
+    m_adc.update();
+
+    int ring_length = m_adc.get_step(ADC_RING_LEN_CHANNEL, 256);
+    decay_long = Utils::map(ring_length, 0, 256, DECAY_LONG_MIN, DECAY_LONG_MAX);
+    release_long = Utils::map(ring_length, 0, 256, RELEASE_LONG_MIN, RELEASE_LONG_MAX);
+
+    synth_mode = static_cast<device_mode>(m_adc.get_step(ADC_SYNTH_MODE_CHANNEL, NO_OF_MODES));
+}
+
+void UI::m_push_event(ui_event_type type, uint8_t id, uint16_t value) {
+    uint32_t head = m_events_head;
+
+    // The synth reads the events on every loop so this shouldn't happen. If
+    // it does, the change is not queued and the synth reads the whole panel
+    // instead.
+    if (head - m_events_tail >= UI_EVENT_QUEUE_SIZE) {
+        m_resync = true;
+        return;
+    }
+
+    ui_event &event = m_events[head & (UI_EVENT_QUEUE_SIZE - 1)];
+    event.type = type;
+    event.id = id;
+    event.value = value;
+    event.time_us = time_us_32();
+
+    __mem_fence_release();
+    m_events_head = head + 1;
+}
+
 void UI::debug() {
     printf("Binary inputs:\n");
     for (int i = 0; i < NO_OF_SWITCHES; i++) {
-        printf("%d: %d\n", i, (int)switches[static_cast<mux_switch>(i)]);
+        printf("%d: %d\n", i, (int)get_switch(static_cast<mux_switch>(i)));
     }
     printf("Ring length: %lu\n", release_long);
     printf("Synth mode: %d\n", synth_mode);
@@ -4,18 +4,62 @@
 #include <stdio.h>
 #include <math.h>
 #include <utils.h>
-#include <map>
 #include <pico/stdio.h>
 #include "hardware/adc.h"
 #include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
 #include "settings.h"
+#include "adc_input.h"
+#include "profiler.h"
 #include <button.h>
 
-// The UI doesn't have to be scanned in every processor cycle. To save processor
-// time define the number cycles for which the UI should not be scanned.
-#define SCAN_CYCLE 100
+// The UI is scanned by a repeating timer, one mux step at a time. The CD4051
+// needs some time to settle after setting the address, the address is set
+// right after reading the input so it has a whole period to settle.
+#define UI_SCAN_PERIOD_US   1000
+#define MUX_SETTLE_US       20
 #define LONG_PRESS_MILLIS 1000
 
+static_assert(UI_SCAN_PERIOD_US >= MUX_SETTLE_US, "The mux needs more time to settle");
+
+// A switch has to read the same this many times in a row to change. Each
+// switch is read on every 8th scan.
+#define SWITCH_DEBOUNCE_READS 3
+
+// Must be a power of two
+#define UI_EVENT_QUEUE_SIZE 16
+
+/**
+ * UI changes. The UI only sends an event when something really changed, so
+ * the synth doesn't have to check everything on every scan.
+*/
+enum ui_event_type {
+    UI_SWITCH,              // id: mux_switch, value: 0 or 1
+    UI_MODE,                // value: device_mode
+    UI_RING_LENGTH,         // decay_long and release_long changed
+    UI_CHORD,               // Chord button pressed (short press)
+    UI_CHORD_RESET          // Chord button held for LONG_PRESS_MILLIS
+};
+
+struct ui_event {
+    uint8_t type;
+    uint8_t id;
+    uint16_t value;
+    uint32_t time_us;
+};
+
+/**
+ * Timing of the scan timer, to check that it really runs at a fixed rate.
+ * Interval is the time between two scans, time is the duration of a scan.
+*/
+struct ui_scan_stats {
+    uint32_t scans;
+    uint32_t min_interval_us;
+    uint32_t max_interval_us;
+    uint32_t max_time_us;
+};
+
 class UI {
 public:
     static UI& get_instance() {
@@ -25,26 +69,62 @@ public:
 
     DISALLOW_COPY_AND_ASSIGN(UI);
 
-    std::map<mux_switch, bool> switches;
     device_mode synth_mode = device_mode::MONO;
     uint16_t release_long = RELEASE_LONG_MIN;
     uint16_t decay_long = DECAY_LONG_MIN;
-    bool updated = true;
-    bool chord_on = false;
-    bool reset_chord = false;
 
     void init();
     void init_scan();
-    void scan();
+
+    // Returns the stats since the last call
+    ui_scan_stats take_scan_stats();
+
+    bool get_switch(mux_switch sw) { return m_switches & (1 << sw); }
+
+    // Input injection: these replace the panel until they're released. Changes
+    // are debounced and sent as events just like the real ones.
+    void override_switch(mux_switch sw, bool value);
+    void override_pot(uint8_t channel, uint16_t value) { m_adc.set_override(channel, value); }
+    void release_overrides();
+    bool read_event(ui_event &event);
+    bool has_events() { return m_events_head != m_events_tail || m_resync; }
+
+    // True if events were lost because the queue was full, the whole panel
+    // has to be read again. Clears the flag.
+    bool take_resync();
 
 protected:
     UI() = default;
 
 private:
     uint16_t m_mux_step = 0;
-    int m_scan_cycle = 0;
+    repeating_timer_t m_scan_timer;
+    uint32_t m_last_scan_us = 0;
+    ui_scan_stats m_scan_stats;
+    AdcInput m_adc;
+
+    // Debounced state of the switches, bit n is mux_switch n
+    uint8_t m_switches = 0;
+    uint8_t m_switch_reads[NO_OF_SWITCHES];
+    volatile uint8_t m_switch_overrides = 0;
+    volatile uint8_t m_switch_override_values = 0;
+
+    // Single producer (scan) single consumer (synth) queue, free running
+    // indexes like the MIDI input
+    ui_event m_events[UI_EVENT_QUEUE_SIZE];
+    volatile uint32_t m_events_head = 0;
+    volatile uint32_t m_events_tail = 0;
+    volatile bool m_resync = false;
+
+    static bool m_on_scan_timer(repeating_timer_t *timer);
+    void m_scan();
+    void m_reset_scan_stats();
+    void m_read_switch(mux_switch sw, bool value);
+    void m_read_pots();
+    void m_push_event(ui_event_type type, uint8_t id, uint16_t value);
 
     bool m_btn_chord_pushed = false;
+    bool m_btn_chord_held = false;
     uint32_t m_t_chord_pushed = 0;
 
     void debug();
@@ -0,0 +1,54 @@
+#include "usb_writer.h"
+#include "tusb.h"
+
+bool UsbWriter::start(const char *data, size_t length) {
+    if (is_busy()) return false;
+
+    m_data = data;
+    m_length = length;
+    m_sent = 0;
+    process();
+    return true;
+}
+
+/**
+ * Writes as much as there's room for in the CDC FIFO. The stdio_usb task must
+ * not run in between, it can send and flush the same FIFO.
+*/
+void UsbWriter::process() {
+    if (!is_busy()) return;
+
+    uint32_t interrupts = save_and_disable_interrupts();
+
+    if (!tud_cdc_connected()) {
+        m_sent = m_length;
+        restore_interrupts(interrupts);
+        return;
+    }
+
+    uint32_t available = tud_cdc_write_available();
+    size_t remaining = m_length - m_sent;
+    if (available > remaining) available = remaining;
+    if (available) {
+        m_sent += tud_cdc_write(m_data + m_sent, available);
+        tud_cdc_write_flush();
+    }
+
+    restore_interrupts(interrupts);
+}
+
+/**
+ * Waits until the host takes the rest of the buffer, or drops it after
+ * USB_WRITER_FINISH_TIMEOUT_US
+*/
+void UsbWriter::finish() {
+    uint32_t start = time_us_32();
+    while (is_busy()) {
+        if (time_us_32() - start > USB_WRITER_FINISH_TIMEOUT_US) {
+            m_sent = m_length;
+            return;
+        }
+        process();
+        tight_loop_contents();
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef _USB_WRITER_H
+#define _USB_WRITER_H
+
+/**
+ * Non-blocking text output over USB
+ *
+ * Sends a buffer to the USB CDC FIFO in chunks, only as much as there's room
+ * for on each process() call, so the caller never waits for the host. It goes
+ * straight to USB, not through stdio, so it doesn't wait for the UART either.
+ * If no host is connected the text is dropped.
+ *
+ * There's one writer for all the clients (profiler, recorder). It sends one
+ * buffer at a time and start() fails until that's all sent, so the text of
+ * the clients is never mixed. printf() goes to the same port, so wait with
+ * finish() before printing.
+ *
+ * stdio_usb runs the TinyUSB task from an IRQ of core 0, so the writer must be
+ * used on core 0 too. Interrupts are disabled around the TinyUSB calls.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <utils.h>
+#include "hardware/sync.h"
+#include "pico/time.h"
+
+#define USB_WRITER_FINISH_TIMEOUT_US 50000
+
+class UsbWriter {
+public:
+    static UsbWriter& get_instance() {
+        static UsbWriter instance;
+        return instance;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(UsbWriter);
+
+    // Starts sending the buffer if the port is free, false if it's still
+    // sending another one. The buffer must stay untouched until it's sent.
+    bool start(const char *data, size_t length);
+    void process();
+    bool is_busy() { return m_sent < m_length; }
+
+    // Sends the rest of the current buffer, waiting for the host
+    void finish();
+
+protected:
+    UsbWriter() = default;
+
+private:
+    const char *m_data = NULL;
+    size_t m_length = 0;
+    size_t m_sent = 0;
+};
+
+#endif
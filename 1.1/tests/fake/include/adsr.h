@@ -0,0 +1,38 @@
+#ifndef _ADSR_H
+#define _ADSR_H
+
+/**
+ * pico-lib's ADSR: linear segments in time (us), the envelope is sampled at
+ * the current virtual time. The sustain level and the output are in the range
+ * of the size given to the constructor.
+ */
+
+#include "pico.h"
+
+class ADSR {
+public:
+    ADSR(int size);
+
+    void set_attack(uint64_t attack_us);
+    void set_decay(uint64_t decay_us);
+    void set_sustain(int sustain);
+    void set_release(uint64_t release_us);
+
+    void note_on();
+    void note_off();
+    bool is_on() { return m_on; }
+    uint16_t envelope();
+
+private:
+    int m_max;
+    uint64_t m_attack = 0;
+    uint64_t m_decay = 0;
+    int m_sustain = 0;
+    uint64_t m_release = 0;
+
+    bool m_on = false;
+    uint64_t m_start_us = 0;
+    int m_from = 0;
+};
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef _BUTTON_H
+#define _BUTTON_H
+
+#include "pico.h"
+
+class Button {};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef _FAKE_HAL_H
+#define _FAKE_HAL_H
+
+/**
+ * Host model of the RP2040
+ *
+ * Time is virtual, in system clock cycles (125MHz). The firmware takes no
+ * time to run, time only moves when the tests move it (or the firmware
+ * sleeps or busy waits). While it moves, everything that would happen in the
+ * background happens at its time:
+ *
+ * - repeating timers (UI scan) call their callbacks
+ * - bytes sent with fake_uart_send() arrive at the wire speed and raise the
+ *   UART IRQ
+ * - the ADC samples and the DMA timers tick, DMA moves their data
+ * - the PIO state machines run, if they're simulated
+ *
+ * Every divisor written to a PIO TX FIFO, every PWM level and every word sent
+ * to the SPI (DAC) goes into the trace with its time, so a test can check
+ * what the hardware got and when, without knowing how the firmware got there.
+ * So do the changes of the GPIOs that the firmware sets.
+ */
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include "pico.h"
+
+#define FAKE_CYCLES_PER_US (SYS_CLK_KHZ / 1000)
+
+enum fake_trace_type {
+    FAKE_TRACE_PIO,         // channel: pio * 4 + sm, value: word put in the TX FIFO
+    FAKE_TRACE_PWM,         // channel: slice * 2 + channel, value: level
+    FAKE_TRACE_DAC,         // channel: SPI, value: 16 bit frame
+    FAKE_TRACE_GPIO         // channel: GPIO, value: level seen by the peripherals,
+                            // only SIO outputs and input overrides
+};
+
+struct fake_trace_entry {
+    uint64_t cycle;
+    fake_trace_type type;
+    uint8_t channel;
+    uint32_t value;
+
+    uint64_t time_us() const { return cycle / FAKE_CYCLES_PER_US; }
+};
+
+struct fake_pio_edge {
+    uint64_t cycle;
+    bool level;
+};
+
+// Resets everything to the power on state, time is 0
+void fake_hal_reset();
+
+// Virtual time
+uint64_t fake_cycles();
+void fake_advance_cycles(uint64_t cycles);
+void fake_advance_us(uint64_t us);
+void fake_advance_to_us(uint64_t time_us);
+
+// Moves the time until the given cycle or the first interrupt (timer, UART),
+// whichever comes first. Returns true if it was an interrupt.
+bool fake_wait_for_event(uint64_t until_cycle);
+
+// Time the calling core asked to wait for with best_effort_wfe_or_timeout()
+// since the last call, or UINT64_MAX if it didn't
+uint64_t fake_take_wfe(uint core);
+
+void fake_set_core_num(uint core);
+
+// SysTick counts the host's time at the system clock (default), or the
+// instructions the process runs (Linux perf events). Returns false if they
+// can't be counted.
+bool fake_systick_count_instructions(bool count);
+
+// Called when the firmware waits for something that another core or an
+// interrupt would do on the device, e.g. queue_add_blocking() on a full queue
+void fake_hal_set_wait_hook(std::function<void()> hook);
+
+// Trace of the outputs
+void fake_trace_enable(bool enabled);
+const std::vector<fake_trace_entry> &fake_trace();
+void fake_trace_clear();
+std::vector<fake_trace_entry> fake_trace_of(fake_trace_type type, int channel = -1);
+void fake_trace_write(FILE *file);
+
+// PIO. Without simulation the state machines don't run, their FIFOs just fill
+// up, the trace of the divisors is still there.
+void fake_pio_simulate(bool simulate);
+void fake_pio_step(uint64_t cycles);
+const std::vector<fake_pio_edge> &fake_pio_edges(uint pio, uint sm);
+void fake_pio_clear_edges();
+uint32_t fake_pio_get_x(uint pio, uint sm);
+uint32_t fake_pio_get_y(uint pio, uint sm);
+
+// GPIO inputs. The hook (if set) gives the level of any pin that's not
+// driven by the Pico, e.g. the output of a mux.
+void fake_gpio_set_input(uint gpio, bool value);
+void fake_gpio_set_input_hook(std::function<int(uint gpio)> hook);
+bool fake_gpio_get_output(uint gpio);
+
+// ADC input in 12 bits
+void fake_adc_set(uint input, uint16_t value);
+
+// Sends the bytes to the UART at the baud rate, after the ones sent already
+void fake_uart_send(uint uart, const uint8_t *data, size_t length);
+uint64_t fake_uart_idle_cycle(uint uart);
+
+// USB CDC and stdin
+void fake_usb_capture(bool capture);
+std::string fake_usb_take();
+void fake_stdin_set(const std::string &data);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef _HARDWARE_ADC_H
+#define _HARDWARE_ADC_H
+
+/**
+ * The ADC samples the inputs set by fake_adc_set() at the rate of its clock
+ * divider (48MHz / (div + 1)), round robin if it's set. With the FIFO's DREQ
+ * on, every sample is a DMA request, DMA reads the sample from the FIFO
+ * register.
+ */
+
+#include "pico.h"
+
+#define NUM_ADC_CHANNELS 5
+
+typedef struct {
+    uint32_t cs;
+    uint32_t result;
+    uint32_t fcs;
+    uint32_t fifo;
+    uint32_t div;
+} adc_hw_t;
+
+extern adc_hw_t *adc_hw;
+
+void adc_init();
+void adc_gpio_init(uint gpio);
+void adc_select_input(uint input);
+void adc_set_round_robin(uint input_mask);
+void adc_fifo_setup(bool enabled, bool dreq_enabled, uint16_t dreq_threshold, bool error_in_fifo,
+                    bool byte_shift);
+void adc_set_clkdiv(float clkdiv);
+void adc_run(bool run);
+void adc_fifo_drain();
+uint16_t adc_read();
+
+#endif
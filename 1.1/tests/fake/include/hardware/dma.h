@@ -0,0 +1,107 @@
+#ifndef _HARDWARE_DMA_H
+#define _HARDWARE_DMA_H
+
+/**
+ * DMA engine
+ *
+ * A busy channel moves a transfer whenever its DREQ allows it: timer and ADC
+ * DREQs give one transfer per tick or sample, the PIO TX DREQs while the
+ * state machine's FIFO isn't full, everything else (SPI TX, permanent) is
+ * always ready. Writes to the SPI data register, a PIO TX FIFO or the
+ * registers of another channel (e.g. al3_read_addr_trig) and reads of the ADC
+ * FIFO go to the peripherals, the rest is plain memory.
+ *
+ * The address registers are pointer sized, so a 32 bit transfer to a channel
+ * register moves a pointer: a ring of addresses steps by sizeof(void *) on the
+ * host, like it steps by 4 on the RP2040.
+ */
+
+#include "pico.h"
+
+#define NUM_DMA_CHANNELS 12
+#define NUM_DMA_TIMERS 4
+
+#define DREQ_PIO0_TX0 0
+#define DREQ_PIO0_RX0 4
+#define DREQ_PIO1_TX0 8
+#define DREQ_PIO1_RX0 12
+#define DREQ_SPI0_TX 16
+#define DREQ_SPI0_RX 17
+#define DREQ_SPI1_TX 18
+#define DREQ_SPI1_RX 19
+#define DREQ_UART0_TX 20
+#define DREQ_UART0_RX 21
+#define DREQ_UART1_TX 22
+#define DREQ_UART1_RX 23
+#define DREQ_ADC 36
+#define DREQ_DMA_TIMER0 59
+#define DREQ_FORCE 63
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+typedef struct {
+    uintptr_t read_addr;
+    uintptr_t write_addr;
+    uint32_t transfer_count;
+    uint32_t ctrl_trig;
+    uint32_t al1_ctrl;
+    uintptr_t al1_read_addr;
+    uintptr_t al1_write_addr;
+    uint32_t al1_transfer_count_trig;
+    uint32_t al2_ctrl;
+    uint32_t al2_transfer_count;
+    uintptr_t al2_read_addr;
+    uintptr_t al2_write_addr_trig;
+    uint32_t al3_ctrl;
+    uintptr_t al3_write_addr;
+    uint32_t al3_transfer_count;
+    uintptr_t al3_read_addr_trig;
+} dma_channel_hw_t;
+
+typedef struct {
+    enum dma_channel_transfer_size size;
+    bool read_increment;
+    bool write_increment;
+    bool ring_write;
+    uint8_t ring_size_bits;
+    uint8_t dreq;
+    uint8_t chain_to;
+    bool enable;
+} dma_channel_config;
+
+int dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(uint channel);
+dma_channel_hw_t *dma_channel_hw_addr(uint channel);
+
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config *config, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *config, bool increment);
+void channel_config_set_write_increment(dma_channel_config *config, bool increment);
+void channel_config_set_ring(dma_channel_config *config, bool write, uint size_bits);
+void channel_config_set_dreq(dma_channel_config *config, uint dreq);
+void channel_config_set_chain_to(dma_channel_config *config, uint channel);
+void channel_config_set_enable(dma_channel_config *config, bool enable);
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_set_config(uint channel, const dma_channel_config *config, bool trigger);
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger);
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger);
+void dma_channel_set_trans_count(uint channel, uint32_t transfer_count, bool trigger);
+void dma_channel_start(uint channel);
+void dma_start_channel_mask(uint32_t mask);
+void dma_channel_abort(uint channel);
+bool dma_channel_is_busy(uint channel);
+
+int dma_claim_unused_timer(bool required);
+void dma_timer_set_fraction(uint timer, uint16_t numerator, uint16_t denominator);
+
+static inline uint dma_get_timer_dreq(uint timer) {
+    return DREQ_DMA_TIMER0 + timer;
+}
+
+#endif
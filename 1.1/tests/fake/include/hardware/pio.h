@@ -0,0 +1,139 @@
+#ifndef _HARDWARE_PIO_H
+#define _HARDWARE_PIO_H
+
+/**
+ * PIO blocks
+ *
+ * Every state machine has its instruction memory, FIFOs, registers and
+ * config like the real one, and an interpreter runs the instructions cycle by
+ * cycle while the virtual time moves, if the PIO is simulated
+ * (fake_pio_simulate()), and always in busy_wait_at_least_cycles(). Writes to
+ * a TX FIFO are recorded in the trace (see fake_hal.h), the channel is
+ * pio * 4 + sm, and so are the edges of the set pins of each state machine.
+ *
+ * Only the clock divider 1 is supported, the DCOs always run at the system
+ * clock. Side set, IRQs and autopush/autopull are not supported.
+ */
+
+#include "pico.h"
+#include "hardware/gpio.h"
+
+#define NUM_PIOS 2
+#define NUM_PIO_STATE_MACHINES 4
+#define PIO_INSTRUCTION_COUNT 32
+#define PIO_FIFO_DEPTH 4
+
+// Writing txf[sm] puts a word in the TX FIFO, like the FIFO register
+struct fake_pio_tx_fifo {
+    uint8_t pio;
+    uint8_t sm;
+    fake_pio_tx_fifo &operator=(uint32_t value);
+};
+
+typedef struct {
+    fake_pio_tx_fifo txf[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t fake_pio_hw[NUM_PIOS];
+
+#define pio0 (&fake_pio_hw[0])
+#define pio1 (&fake_pio_hw[1])
+
+typedef struct pio_program {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+typedef struct {
+    uint8_t wrap_target;
+    uint8_t wrap;
+    uint8_t set_base;
+    uint8_t set_count;
+    uint8_t in_base;
+    uint8_t out_base;
+    uint8_t out_count;
+    bool in_shift_right;
+    bool out_shift_right;
+    uint8_t pull_threshold;
+    uint8_t push_threshold;
+} pio_sm_config;
+
+enum pio_src_dest {
+    pio_pins = 0,
+    pio_x = 1,
+    pio_y = 2,
+    pio_null = 3,
+    pio_pindirs = 4,
+    pio_exec_mov = 4,
+    pio_status = 5,
+    pio_pc = 5,
+    pio_isr = 6,
+    pio_osr = 7,
+    pio_exec_out = 7
+};
+
+static inline uint pio_get_index(PIO pio) {
+    return pio == pio1 ? 1 : 0;
+}
+
+static inline uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+    return pio_get_index(pio) * 8 + (is_tx ? 0 : 4) + sm;
+}
+
+// Instruction encoding, only the ones the firmware uses
+static inline uint pio_encode_jmp(uint addr) {
+    return 0x0000 | (addr & 0x1f);
+}
+
+static inline uint pio_encode_set(enum pio_src_dest dest, uint value) {
+    return 0xe000 | ((dest & 7) << 5) | (value & 0x1f);
+}
+
+static inline uint pio_encode_nop() {
+    return 0xa042;
+}
+
+pio_sm_config pio_get_default_sm_config();
+void sm_config_set_wrap(pio_sm_config *config, uint wrap_target, uint wrap);
+void sm_config_set_set_pins(pio_sm_config *config, uint set_base, uint set_count);
+void sm_config_set_out_pins(pio_sm_config *config, uint out_base, uint out_count);
+void sm_config_set_in_pins(pio_sm_config *config, uint in_base);
+void sm_config_set_out_shift(pio_sm_config *config, bool shift_right, bool autopull, uint pull_threshold);
+void sm_config_set_in_shift(pio_sm_config *config, bool shift_right, bool autopush, uint push_threshold);
+void sm_config_set_clkdiv_int_frac(pio_sm_config *config, uint16_t div_int, uint8_t div_frac);
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program);
+uint pio_add_program(PIO pio, const pio_program_t *program);
+void pio_remove_program(PIO pio, const pio_program_t *program, uint offset);
+void pio_clear_instruction_memory(PIO pio);
+
+void pio_sm_claim(PIO pio, uint sm);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_unclaim(PIO pio, uint sm);
+
+void pio_gpio_init(PIO pio, uint pin);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_config(PIO pio, uint sm, const pio_sm_config *config);
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_set_sm_mask_enabled(PIO pio, uint32_t mask, bool enabled);
+void pio_sm_restart(PIO pio, uint sm);
+void pio_restart_sm_mask(PIO pio, uint32_t mask);
+void pio_sm_clkdiv_restart(PIO pio, uint sm);
+void pio_clkdiv_restart_sm_mask(PIO pio, uint32_t mask);
+void pio_enable_sm_mask_in_sync(PIO pio, uint32_t mask);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+uint8_t pio_sm_get_pc(PIO pio, uint sm);
+
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm);
+bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm);
+uint pio_sm_get_tx_fifo_level(PIO pio, uint sm);
+
+#endif
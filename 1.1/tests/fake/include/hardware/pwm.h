@@ -0,0 +1,30 @@
+#ifndef _HARDWARE_PWM_H
+#define _HARDWARE_PWM_H
+
+/**
+ * PWM levels are recorded in the trace, the channel is slice * 2 + channel
+ * (ie. the GPIO modulo 16).
+ */
+
+#include "pico.h"
+
+#define NUM_PWM_SLICES 8
+
+enum pwm_chan {
+    PWM_CHAN_A = 0,
+    PWM_CHAN_B = 1
+};
+
+static inline uint pwm_gpio_to_slice_num(uint gpio) {
+    return (gpio >> 1) & 7;
+}
+
+static inline uint pwm_gpio_to_channel(uint gpio) {
+    return gpio & 1;
+}
+
+void pwm_set_wrap(uint slice, uint16_t wrap);
+void pwm_set_enabled(uint slice, bool enabled);
+void pwm_set_chan_level(uint slice, uint channel, uint16_t level);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef _HARDWARE_SPI_H
+#define _HARDWARE_SPI_H
+
+/**
+ * Transmit side of the SPIs. Every word written to the data register (by the
+ * CPU or DMA) is recorded in the trace as a DAC word, see fake_hal.h. The
+ * TX DREQ is always ready, the SPI never holds DMA back.
+ */
+
+#include "pico.h"
+
+#define NUM_SPIS 2
+
+typedef struct {
+    uint32_t cr0;
+    uint32_t cr1;
+    uint32_t dr;
+    uint32_t sr;
+} spi_hw_t;
+
+typedef struct spi_inst spi_inst_t;
+
+extern spi_hw_t fake_spi_hw[NUM_SPIS];
+
+#define spi0 ((spi_inst_t *)&fake_spi_hw[0])
+#define spi1 ((spi_inst_t *)&fake_spi_hw[1])
+
+typedef enum {
+    SPI_CPHA_0 = 0,
+    SPI_CPHA_1 = 1
+} spi_cpha_t;
+
+typedef enum {
+    SPI_CPOL_0 = 0,
+    SPI_CPOL_1 = 1
+} spi_cpol_t;
+
+typedef enum {
+    SPI_LSB_FIRST = 0,
+    SPI_MSB_FIRST = 1
+} spi_order_t;
+
+static inline spi_hw_t *spi_get_hw(spi_inst_t *spi) {
+    return (spi_hw_t *)spi;
+}
+
+static inline uint spi_get_index(spi_inst_t *spi) {
+    return spi == spi1 ? 1 : 0;
+}
+
+uint spi_init(spi_inst_t *spi, uint baudrate);
+void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order);
+uint spi_get_dreq(spi_inst_t *spi, bool is_tx);
+bool spi_is_writable(spi_inst_t *spi);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef _HARDWARE_STRUCTS_SYSTICK_H
+#define _HARDWARE_STRUCTS_SYSTICK_H
+
+/**
+ * The SysTick counter is the only thing that runs in real time: it counts
+ * down at the system clock rate from the host's monotonic clock, so the
+ * profiler and the benchmark measure the host.
+ */
+
+#include "pico.h"
+
+struct fake_systick_counter {
+    operator uint32_t() const;
+    fake_systick_counter &operator=(uint32_t value);
+};
+
+typedef struct {
+    uint32_t csr;
+    uint32_t rvr;
+    fake_systick_counter cvr;
+    uint32_t calib;
+} systick_hw_t;
+
+extern systick_hw_t *systick_hw;
+
+#endif
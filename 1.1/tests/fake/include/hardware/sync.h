@@ -0,0 +1,21 @@
+#ifndef _HARDWARE_SYNC_H
+#define _HARDWARE_SYNC_H
+
+/**
+ * Everything runs on one host thread, interrupts (timer callbacks, UART
+ * bytes) only come in while the virtual time is moved. So these only keep
+ * the state.
+ */
+
+#include "pico.h"
+
+uint32_t save_and_disable_interrupts();
+void restore_interrupts(uint32_t status);
+
+void __mem_fence_acquire();
+void __mem_fence_release();
+void __dmb();
+void __wfe();
+void __sev();
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef _HARDWARE_UART_H
+#define _HARDWARE_UART_H
+
+/**
+ * Receive side of the UARTs. The other end of the wire is
+ * fake_uart_send(): it sends bytes at the baud rate (10 bits each), each one
+ * lands in the RX FIFO (32 deep, or 1 with the FIFO off) and raises the IRQ
+ * if it's enabled. Reading the data register pops the FIFO.
+ */
+
+#include "pico.h"
+
+#define NUM_UARTS 2
+#define UART_FIFO_DEPTH 32
+
+#define UART_UARTDR_OE_BITS 0x00000800
+#define UART_UARTDR_DATA_BITS 0x000000ff
+
+// Reading it pops the RX FIFO of the UART
+struct fake_uart_data_register {
+    uint index;
+    operator uint32_t();
+};
+
+typedef struct {
+    fake_uart_data_register dr;
+} uart_hw_t;
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_hw_t fake_uart_hw[NUM_UARTS];
+
+#define uart0 ((uart_inst_t *)&fake_uart_hw[0])
+#define uart1 ((uart_inst_t *)&fake_uart_hw[1])
+
+static inline uart_hw_t *uart_get_hw(uart_inst_t *uart) {
+    return (uart_hw_t *)uart;
+}
+
+static inline uint uart_get_index(uart_inst_t *uart) {
+    return uart == uart1 ? 1 : 0;
+}
+
+uint uart_init(uart_inst_t *uart, uint baudrate);
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data);
+bool uart_is_readable(uart_inst_t *uart);
+char uart_getc(uart_inst_t *uart);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef _MIDI_PARSER_H
+#define _MIDI_PARSER_H
+
+/**
+ * pico-lib's byte by byte MIDI parser. The callbacks get the channel as the
+ * low nibble of the status (0-15), like BatchMidiParser's.
+ */
+
+#include "pico.h"
+
+class MidiParser {
+public:
+    virtual ~MidiParser() {}
+
+    void parse_byte(uint8_t byte);
+
+    virtual void note_on(uint8_t channel, uint8_t note, uint8_t velocity) {}
+    virtual void note_off(uint8_t channel, uint8_t note, uint8_t velocity) {}
+    virtual void cc(uint8_t channel, uint8_t data1, uint8_t data2) {}
+    virtual void pitch_bend(uint8_t channel, uint16_t bend) {}
+
+private:
+    uint8_t m_status = 0;
+    uint8_t m_data[2];
+    uint8_t m_count = 0;
+};
+
+#endif
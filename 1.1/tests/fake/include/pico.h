@@ -0,0 +1,38 @@
+#ifndef _PICO_H
+#define _PICO_H
+
+/**
+ * Host stand-in of the Pico SDK
+ *
+ * The headers under fake/include have the same names and the same API as the
+ * parts of the SDK (and pico-lib) that the firmware uses, so the sources in
+ * src/ build for the host unchanged. Instead of registers they drive a model
+ * in virtual time, see fake_hal.h.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef unsigned int uint;
+
+#define __not_in_flash_func(name) name
+#define __time_critical_func(name) name
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+
+#define SYS_CLK_KHZ 125000
+#define PICO_ERROR_TIMEOUT -1
+
+void fake_hal_panic(const char *message, const char *file, int line);
+
+#define hard_assert(condition) do { \
+        if (!(condition)) fake_hal_panic(#condition, __FILE__, __LINE__); \
+    } while (0)
+
+// Advances the virtual time by the cycles, see fake_hal.h
+void busy_wait_at_least_cycles(uint32_t cycles);
+void tight_loop_contents();
+uint get_core_num();
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef _PICO_MULTICORE_H
+#define _PICO_MULTICORE_H
+
+/**
+ * There's no second core on the host: the entry is kept, but not run. The
+ * host harness runs core 1's scheduler itself.
+ */
+
+#include "pico.h"
+
+void multicore_launch_core1(void (*entry)(void));
+
+#endif
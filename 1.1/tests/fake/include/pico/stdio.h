@@ -0,0 +1,15 @@
+#ifndef _PICO_STDIO_H
+#define _PICO_STDIO_H
+
+/**
+ * printf() goes to the host's stdout. getchar_timeout_us() reads the bytes
+ * given to fake_stdin_set(), it never waits.
+ */
+
+#include "pico.h"
+
+void stdio_init_all();
+int getchar_timeout_us(uint32_t timeout_us);
+bool stdio_usb_connected();
+
+#endif
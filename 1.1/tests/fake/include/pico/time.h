@@ -0,0 +1,42 @@
+#ifndef _PICO_TIME_H
+#define _PICO_TIME_H
+
+/**
+ * Virtual time. It only moves when the tests (fake_hal.h) or a sleep move it,
+ * so the code under test takes no time.
+ */
+
+#include "pico.h"
+
+typedef uint64_t absolute_time_t;
+
+uint32_t time_us_32();
+uint64_t time_us_64();
+absolute_time_t get_absolute_time();
+uint64_t to_us_since_boot(absolute_time_t time);
+absolute_time_t make_timeout_time_us(uint64_t us);
+absolute_time_t delayed_by_us(absolute_time_t time, uint64_t us);
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to);
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+// Doesn't wait, the wait is recorded for the host harness (fake_take_wfe())
+bool best_effort_wfe_or_timeout(absolute_time_t timeout);
+
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *timer);
+
+struct repeating_timer {
+    int64_t delay_us;
+    repeating_timer_callback_t callback;
+    void *user_data;
+};
+
+// The callback runs from fake_advance_us() and friends, as if it was the
+// timer IRQ
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data,
+                            repeating_timer_t *timer);
+bool cancel_repeating_timer(repeating_timer_t *timer);
+
+#endif
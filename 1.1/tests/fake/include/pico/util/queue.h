@@ -0,0 +1,30 @@
+#ifndef _PICO_UTIL_QUEUE_H
+#define _PICO_UTIL_QUEUE_H
+
+/**
+ * Same as the SDK's queue, without the spin lock. queue_add_blocking() on a
+ * full queue calls the wait hook (fake_hal_set_wait_hook()), which should
+ * empty it like the other core would.
+ */
+
+#include "pico.h"
+
+typedef struct {
+    uint8_t *data;
+    uint element_size;
+    uint element_count;
+    uint head;
+    uint level;
+} queue_t;
+
+void queue_init(queue_t *queue, uint element_size, uint element_count);
+void queue_free(queue_t *queue);
+uint queue_get_level(queue_t *queue);
+bool queue_is_empty(queue_t *queue);
+bool queue_is_full(queue_t *queue);
+bool queue_try_add(queue_t *queue, const void *data);
+bool queue_try_remove(queue_t *queue, void *data);
+void queue_add_blocking(queue_t *queue, const void *data);
+void queue_remove_blocking(queue_t *queue, void *data);
+
+#endif
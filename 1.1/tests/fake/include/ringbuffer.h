@@ -0,0 +1,20 @@
+#ifndef _RINGBUFFER_H
+#define _RINGBUFFER_H
+
+#include "pico.h"
+
+class RingBuffer {
+public:
+    void init(uint8_t *buffer, int size);
+    void write_byte(uint8_t byte);
+    void read_byte(uint8_t &byte);
+    bool is_empty() { return m_head == m_tail; }
+
+private:
+    uint8_t *m_buffer = NULL;
+    int m_size = 0;
+    int m_head = 0;
+    int m_tail = 0;
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef _TUSB_H
+#define _TUSB_H
+
+/**
+ * The CDC port of TinyUSB. It's connected while it's captured
+ * (fake_usb_capture()), everything written to it is kept for the tests.
+ */
+
+#include "pico.h"
+
+#define CFG_TUD_CDC_TX_BUFSIZE 256
+
+bool tud_cdc_connected();
+uint32_t tud_cdc_write_available();
+uint32_t tud_cdc_write(const void *buffer, uint32_t length);
+uint32_t tud_cdc_write_flush();
+
+#endif
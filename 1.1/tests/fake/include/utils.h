@@ -0,0 +1,20 @@
+#ifndef _UTILS_H
+#define _UTILS_H
+
+/**
+ * pico-lib's utils, millis() is in virtual time
+ */
+
+#include "pico.h"
+
+#define DISALLOW_COPY_AND_ASSIGN(TypeName) \
+    TypeName(const TypeName&) = delete; \
+    void operator=(const TypeName&) = delete
+
+class Utils {
+public:
+    static long map(long x, long in_min, long in_max, long out_min, long out_max);
+    static uint32_t millis();
+};
+
+#endif
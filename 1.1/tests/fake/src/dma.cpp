@@ -0,0 +1,367 @@
+#include <string.h>
+#include <stddef.h>
+#include "fake_internal.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+
+#define DMA_MAX_TRANSFERS_PER_SERVICE 1000000
+
+struct fake_dma_timer {
+    bool claimed = false;
+    uint64_t period = 0;
+    uint64_t next = UINT64_MAX;
+    uint32_t requests = 0;
+};
+
+static dma_channel_hw_t g_hw[NUM_DMA_CHANNELS];
+static dma_channel_config g_configs[NUM_DMA_CHANNELS];
+static bool g_busy[NUM_DMA_CHANNELS];
+static uint32_t g_reload_counts[NUM_DMA_CHANNELS];
+static bool g_claimed[NUM_DMA_CHANNELS];
+static fake_dma_timer g_timers[NUM_DMA_TIMERS];
+static bool g_servicing = false;
+
+void fake_dma_reset() {
+    memset(g_hw, 0, sizeof(g_hw));
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        g_configs[channel] = dma_channel_get_default_config(channel);
+        g_busy[channel] = false;
+        g_reload_counts[channel] = 0;
+        g_claimed[channel] = false;
+    }
+    for (uint timer = 0; timer < NUM_DMA_TIMERS; timer++) {
+        g_timers[timer] = fake_dma_timer();
+    }
+}
+
+int dma_claim_unused_channel(bool required) {
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        if (!g_claimed[channel]) {
+            g_claimed[channel] = true;
+            return channel;
+        }
+    }
+    hard_assert(!required);
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel) {
+    g_claimed[channel] = false;
+}
+
+dma_channel_hw_t *dma_channel_hw_addr(uint channel) {
+    return &g_hw[channel];
+}
+
+/** ----------------------------------------------------------------------------
+ * Config
+*/
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    dma_channel_config config;
+    config.size = DMA_SIZE_32;
+    config.read_increment = true;
+    config.write_increment = false;
+    config.ring_write = false;
+    config.ring_size_bits = 0;
+    config.dreq = DREQ_FORCE;
+    config.chain_to = channel;
+    config.enable = true;
+    return config;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *config, enum dma_channel_transfer_size size) {
+    config->size = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *config, bool increment) {
+    config->read_increment = increment;
+}
+
+void channel_config_set_write_increment(dma_channel_config *config, bool increment) {
+    config->write_increment = increment;
+}
+
+void channel_config_set_ring(dma_channel_config *config, bool write, uint size_bits) {
+    config->ring_write = write;
+    config->ring_size_bits = size_bits;
+}
+
+void channel_config_set_dreq(dma_channel_config *config, uint dreq) {
+    config->dreq = dreq;
+}
+
+void channel_config_set_chain_to(dma_channel_config *config, uint channel) {
+    config->chain_to = channel;
+}
+
+void channel_config_set_enable(dma_channel_config *config, bool enable) {
+    config->enable = enable;
+}
+
+/** ----------------------------------------------------------------------------
+ * Channels
+*/
+
+/**
+ * The transfer count register holds the remaining transfers, what's written to
+ * it is reloaded on every trigger
+*/
+static void set_transfer_count(uint channel, uint32_t transfer_count) {
+    g_reload_counts[channel] = transfer_count;
+    if (!g_busy[channel]) g_hw[channel].transfer_count = transfer_count;
+}
+
+static void trigger(uint channel) {
+    g_hw[channel].transfer_count = g_reload_counts[channel];
+    g_busy[channel] = g_configs[channel].enable && g_hw[channel].transfer_count;
+    fake_dma_service();
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger_now) {
+    g_configs[channel] = *config;
+    g_hw[channel].write_addr = (uintptr_t)write_addr;
+    g_hw[channel].read_addr = (uintptr_t)read_addr;
+    set_transfer_count(channel, transfer_count);
+    if (trigger_now) trigger(channel);
+}
+
+void dma_channel_set_config(uint channel, const dma_channel_config *config, bool trigger_now) {
+    g_configs[channel] = *config;
+    if (trigger_now) trigger(channel);
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger_now) {
+    g_hw[channel].read_addr = (uintptr_t)read_addr;
+    if (trigger_now) trigger(channel);
+}
+
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger_now) {
+    g_hw[channel].write_addr = (uintptr_t)write_addr;
+    if (trigger_now) trigger(channel);
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t transfer_count, bool trigger_now) {
+    set_transfer_count(channel, transfer_count);
+    if (trigger_now) trigger(channel);
+}
+
+void dma_channel_start(uint channel) {
+    trigger(channel);
+}
+
+void dma_start_channel_mask(uint32_t mask) {
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        if (mask & (1u << channel)) trigger(channel);
+    }
+}
+
+void dma_channel_abort(uint channel) {
+    g_busy[channel] = false;
+}
+
+bool dma_channel_is_busy(uint channel) {
+    return g_busy[channel];
+}
+
+/** ----------------------------------------------------------------------------
+ * Timers
+*/
+
+int dma_claim_unused_timer(bool required) {
+    for (uint timer = 0; timer < NUM_DMA_TIMERS; timer++) {
+        if (!g_timers[timer].claimed) {
+            g_timers[timer].claimed = true;
+            return timer;
+        }
+    }
+    hard_assert(!required);
+    return -1;
+}
+
+/**
+ * The timer requests a transfer numerator times every denominator cycles,
+ * only whole periods (numerator 1) are supported
+*/
+void dma_timer_set_fraction(uint timer, uint16_t numerator, uint16_t denominator) {
+    hard_assert(numerator == 1 && denominator > 0);
+    g_timers[timer].period = denominator;
+    g_timers[timer].next = fake_now + denominator;
+}
+
+uint64_t fake_dma_next_timer_cycle() {
+    uint64_t next = UINT64_MAX;
+    for (fake_dma_timer &timer : g_timers) {
+        if (timer.next < next) next = timer.next;
+    }
+    return next;
+}
+
+static bool is_paced_by(uint dreq) {
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        if (g_busy[channel] && g_configs[channel].dreq == dreq) return true;
+    }
+    return false;
+}
+
+/**
+ * Requests of a timer are only counted while a channel is waiting for them
+*/
+void fake_dma_run_timers(uint64_t now) {
+    for (uint timer = 0; timer < NUM_DMA_TIMERS; timer++) {
+        fake_dma_timer &state = g_timers[timer];
+        while (state.next <= now) {
+            if (is_paced_by(dma_get_timer_dreq(timer))) state.requests++;
+            state.next += state.period;
+        }
+    }
+}
+
+/** ----------------------------------------------------------------------------
+ * Transfers
+*/
+
+static bool dreq_ready(uint dreq) {
+    if (dreq < DREQ_PIO0_RX0) return fake_pio_tx_ready(0, dreq - DREQ_PIO0_TX0);
+    if (dreq >= DREQ_PIO1_TX0 && dreq < DREQ_PIO1_RX0) return fake_pio_tx_ready(1, dreq - DREQ_PIO1_TX0);
+
+    switch (dreq) {
+    case DREQ_SPI0_TX:
+    case DREQ_SPI1_TX:
+    case DREQ_UART0_TX:
+    case DREQ_UART1_TX:
+    case DREQ_FORCE:
+        return true;
+    case DREQ_ADC:
+        return fake_adc_dreq();
+    }
+
+    if (dreq >= DREQ_DMA_TIMER0 && dreq < DREQ_DMA_TIMER0 + NUM_DMA_TIMERS) {
+        return g_timers[dreq - DREQ_DMA_TIMER0].requests > 0;
+    }
+    return false;
+}
+
+static void take_dreq(uint dreq) {
+    if (dreq >= DREQ_DMA_TIMER0 && dreq < DREQ_DMA_TIMER0 + NUM_DMA_TIMERS) {
+        g_timers[dreq - DREQ_DMA_TIMER0].requests--;
+    }
+}
+
+static bool is_register(uintptr_t address) {
+    return address >= (uintptr_t)&g_hw[0] && address < (uintptr_t)&g_hw[NUM_DMA_CHANNELS];
+}
+
+/**
+ * Another channel's register written by DMA, the *_trig ones start it
+*/
+static void write_register(uintptr_t address, uintptr_t value) {
+    uint channel = (address - (uintptr_t)&g_hw[0]) / sizeof(dma_channel_hw_t);
+    size_t offset = (address - (uintptr_t)&g_hw[0]) % sizeof(dma_channel_hw_t);
+    dma_channel_hw_t &hw = g_hw[channel];
+
+    switch (offset) {
+    case offsetof(dma_channel_hw_t, read_addr):
+    case offsetof(dma_channel_hw_t, al1_read_addr):
+    case offsetof(dma_channel_hw_t, al2_read_addr):
+        hw.read_addr = value;
+        break;
+    case offsetof(dma_channel_hw_t, al3_read_addr_trig):
+        hw.read_addr = value;
+        trigger(channel);
+        break;
+    case offsetof(dma_channel_hw_t, write_addr):
+    case offsetof(dma_channel_hw_t, al1_write_addr):
+    case offsetof(dma_channel_hw_t, al3_write_addr):
+        hw.write_addr = value;
+        break;
+    case offsetof(dma_channel_hw_t, al2_write_addr_trig):
+        hw.write_addr = value;
+        trigger(channel);
+        break;
+    case offsetof(dma_channel_hw_t, transfer_count):
+    case offsetof(dma_channel_hw_t, al2_transfer_count):
+    case offsetof(dma_channel_hw_t, al3_transfer_count):
+        set_transfer_count(channel, value);
+        break;
+    case offsetof(dma_channel_hw_t, al1_transfer_count_trig):
+        set_transfer_count(channel, value);
+        trigger(channel);
+        break;
+    default:
+        fake_hal_panic("unsupported DMA register write", __FILE__, __LINE__);
+    }
+}
+
+static uintptr_t next_address(uintptr_t address, uint size, bool increment, bool ring, uint8_t ring_bits) {
+    if (!increment) return address;
+    if (!ring || !ring_bits) return address + size;
+
+    uintptr_t mask = ((uintptr_t)1 << ring_bits) - 1;
+    return (address & ~mask) | ((address + size) & mask);
+}
+
+static void transfer(uint channel) {
+    dma_channel_config &config = g_configs[channel];
+    dma_channel_hw_t &hw = g_hw[channel];
+
+    // A word written to a DMA register is an address, ie. a pointer on the host
+    uint size = 1u << config.size;
+    if (config.size == DMA_SIZE_32 && is_register(hw.write_addr)) size = sizeof(uintptr_t);
+
+    uint64_t value = 0;
+    uint32_t peripheral_value;
+    if (fake_adc_read(hw.read_addr, peripheral_value)) {
+        value = peripheral_value;
+    } else {
+        memcpy(&value, (const void *)hw.read_addr, size);
+    }
+
+    uint pio, sm;
+    if (is_register(hw.write_addr)) {
+        write_register(hw.write_addr, (uintptr_t)value);
+    } else if (fake_pio_is_tx_fifo(hw.write_addr, pio, sm)) {
+        fake_pio_hw[pio].txf[sm] = (uint32_t)value;
+    } else if (!fake_spi_write(hw.write_addr, (uint32_t)value)) {
+        memcpy((void *)hw.write_addr, &value, size);
+    }
+
+    hw.read_addr = next_address(hw.read_addr, size, config.read_increment, !config.ring_write,
+                                config.ring_size_bits);
+    hw.write_addr = next_address(hw.write_addr, size, config.write_increment, config.ring_write,
+                                 config.ring_size_bits);
+
+    if (--hw.transfer_count == 0) {
+        g_busy[channel] = false;
+        if (config.chain_to != channel) trigger(config.chain_to);
+    }
+}
+
+/**
+ * Moves everything that the DREQs allow now. A channel triggered by another
+ * one is picked up by the same loop.
+*/
+void fake_dma_service() {
+    if (g_servicing) return;
+    g_servicing = true;
+
+    uint32_t transfers = 0;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+            while (g_busy[channel] && dreq_ready(g_configs[channel].dreq)) {
+                take_dreq(g_configs[channel].dreq);
+                transfer(channel);
+                progress = true;
+
+                if (++transfers > DMA_MAX_TRANSFERS_PER_SERVICE) {
+                    fake_hal_panic("DMA channel never stops", __FILE__, __LINE__);
+                }
+            }
+        }
+    }
+
+    g_servicing = false;
+}
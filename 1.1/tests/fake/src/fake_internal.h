@@ -0,0 +1,35 @@
+#ifndef _FAKE_INTERNAL_H
+#define _FAKE_INTERNAL_H
+
+/**
+ * Between the parts of the fake HAL, not for the tests
+ */
+
+#include "fake_hal.h"
+
+extern uint64_t fake_now;
+
+void fake_trace_add(fake_trace_type type, uint8_t channel, uint32_t value);
+void fake_raise_irq(uint irq);
+
+// Level of a pin as the pad sees it
+bool fake_gpio_level(uint gpio);
+
+void fake_pio_reset();
+bool fake_pio_is_running();
+void fake_pio_tick();
+bool fake_pio_tx_ready(uint pio, uint sm);
+bool fake_pio_drives(uint pio, uint gpio, bool &level);
+bool fake_pio_is_tx_fifo(uintptr_t address, uint &pio, uint &sm);
+
+void fake_dma_reset();
+void fake_dma_service();
+uint64_t fake_dma_next_timer_cycle();
+void fake_dma_run_timers(uint64_t now);
+
+// Peripherals as DMA sees them
+bool fake_spi_write(uintptr_t address, uint32_t value);
+bool fake_adc_read(uintptr_t address, uint32_t &value);
+bool fake_adc_dreq();
+
+#endif
@@ -0,0 +1,904 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <deque>
+#include <algorithm>
+#include "fake_internal.h"
+#include "pico/stdio.h"
+#include "pico/time.h"
+#include "pico/multicore.h"
+#include "pico/util/queue.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "hardware/irq.h"
+#include "hardware/clocks.h"
+#include "hardware/uart.h"
+#include "hardware/spi.h"
+#include "hardware/pwm.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/structs/systick.h"
+#include "tusb.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+uint64_t fake_now = 0;
+
+static uint g_core = 0;
+static uint64_t g_wfe[2] = {UINT64_MAX, UINT64_MAX};
+static std::function<void()> g_wait_hook;
+static bool g_in_wait_hook = false;
+
+static bool g_trace_enabled = true;
+static std::vector<fake_trace_entry> g_trace;
+
+static bool g_pio_simulate = false;
+
+/** ----------------------------------------------------------------------------
+ * Interrupts
+*/
+
+static irq_handler_t g_irq_handlers[NUM_IRQS];
+static bool g_irq_enabled[NUM_IRQS];
+static uint32_t g_irq_pending = 0;
+static bool g_interrupts_disabled = false;
+static bool g_interrupted = false;
+
+void fake_raise_irq(uint irq) {
+    g_interrupted = true;
+    if (!g_irq_enabled[irq] || !g_irq_handlers[irq]) return;
+
+    if (g_interrupts_disabled) {
+        g_irq_pending |= (1u << irq);
+        return;
+    }
+    g_irq_handlers[irq]();
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    g_irq_handlers[num] = handler;
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    g_irq_enabled[num] = enabled;
+}
+
+uint32_t save_and_disable_interrupts() {
+    uint32_t status = g_interrupts_disabled;
+    g_interrupts_disabled = true;
+    return status;
+}
+
+void restore_interrupts(uint32_t status) {
+    g_interrupts_disabled = status;
+    while (!g_interrupts_disabled && g_irq_pending) {
+        uint irq = __builtin_ctz(g_irq_pending);
+        g_irq_pending &= ~(1u << irq);
+        if (g_irq_enabled[irq] && g_irq_handlers[irq]) g_irq_handlers[irq]();
+    }
+}
+
+void __mem_fence_acquire() {}
+void __mem_fence_release() {}
+void __dmb() {}
+void __wfe() {}
+void __sev() {}
+
+/** ----------------------------------------------------------------------------
+ * Repeating timers
+*/
+
+struct fake_timer {
+    repeating_timer_t *timer;
+    uint64_t next;
+};
+
+static std::vector<fake_timer> g_timers;
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data,
+                            repeating_timer_t *timer) {
+    timer->delay_us = delay_us;
+    timer->callback = callback;
+    timer->user_data = user_data;
+    uint64_t period = (delay_us < 0 ? -delay_us : delay_us) * FAKE_CYCLES_PER_US;
+    g_timers.push_back({timer, fake_now + period});
+    return true;
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer) {
+    for (size_t i = 0; i < g_timers.size(); i++) {
+        if (g_timers[i].timer == timer) {
+            g_timers.erase(g_timers.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * A negative delay is from start to start, a positive one from the end of the
+ * callback, which is the same in virtual time
+*/
+static void run_timers() {
+    for (size_t i = 0; i < g_timers.size(); i++) {
+        if (g_timers[i].next > fake_now) continue;
+
+        repeating_timer_t *timer = g_timers[i].timer;
+        int64_t delay_us = timer->delay_us;
+        g_interrupted = true;
+        if (!timer->callback(timer)) {
+            g_timers.erase(g_timers.begin() + i);
+            i--;
+            continue;
+        }
+        uint64_t period = (delay_us < 0 ? -delay_us : delay_us) * FAKE_CYCLES_PER_US;
+        g_timers[i].next = (delay_us < 0 ? g_timers[i].next : fake_now) + period;
+    }
+}
+
+static uint64_t next_timer_cycle() {
+    uint64_t next = UINT64_MAX;
+    for (fake_timer &timer : g_timers) {
+        next = std::min(next, timer.next);
+    }
+    return next;
+}
+
+/** ----------------------------------------------------------------------------
+ * UART, receive side only
+*/
+
+struct fake_uart {
+    uint baudrate = 115200;
+    bool fifo_enabled = true;
+    bool rx_irq = false;
+    std::deque<uint32_t> rx;
+    std::deque<std::pair<uint64_t, uint8_t>> wire;
+    uint64_t wire_end = 0;
+};
+
+static fake_uart g_uarts[NUM_UARTS];
+uart_hw_t fake_uart_hw[NUM_UARTS] = {{{0}}, {{1}}};
+
+fake_uart_data_register::operator uint32_t() {
+    fake_uart &uart = g_uarts[index];
+    if (uart.rx.empty()) return 0;
+    uint32_t data = uart.rx.front();
+    uart.rx.pop_front();
+    return data;
+}
+
+uint uart_init(uart_inst_t *uart, uint baudrate) {
+    fake_uart &state = g_uarts[uart_get_index(uart)];
+    state.baudrate = baudrate;
+    state.fifo_enabled = true;
+    state.rx.clear();
+    return baudrate;
+}
+
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled) {
+    g_uarts[uart_get_index(uart)].fifo_enabled = enabled;
+}
+
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data) {
+    g_uarts[uart_get_index(uart)].rx_irq = rx_has_data;
+}
+
+bool uart_is_readable(uart_inst_t *uart) {
+    return !g_uarts[uart_get_index(uart)].rx.empty();
+}
+
+char uart_getc(uart_inst_t *uart) {
+    return (uint32_t)uart_get_hw(uart)->dr & UART_UARTDR_DATA_BITS;
+}
+
+void fake_uart_send(uint index, const uint8_t *data, size_t length) {
+    fake_uart &uart = g_uarts[index];
+    uint64_t byte_cycles = (uint64_t)SYS_CLK_KHZ * 1000 * 10 / uart.baudrate;
+
+    uint64_t time = std::max(uart.wire_end, fake_now);
+    for (size_t i = 0; i < length; i++) {
+        time += byte_cycles;
+        uart.wire.push_back({time, data[i]});
+    }
+    uart.wire_end = time;
+}
+
+uint64_t fake_uart_idle_cycle(uint index) {
+    return std::max(g_uarts[index].wire_end, fake_now);
+}
+
+/**
+ * A byte arrives at the end of its stop bit. If the FIFO is full it's lost and
+ * the overrun is flagged on the last byte in the FIFO.
+*/
+static void run_uarts() {
+    for (uint index = 0; index < NUM_UARTS; index++) {
+        fake_uart &uart = g_uarts[index];
+        while (!uart.wire.empty() && uart.wire.front().first <= fake_now) {
+            uint8_t byte = uart.wire.front().second;
+            uart.wire.pop_front();
+
+            size_t depth = uart.fifo_enabled ? UART_FIFO_DEPTH : 1;
+            if (uart.rx.size() >= depth) {
+                uart.rx.back() |= UART_UARTDR_OE_BITS;
+            } else {
+                uart.rx.push_back(byte);
+            }
+
+            if (uart.rx_irq) {
+                fake_raise_irq(index ? UART1_IRQ : UART0_IRQ);
+            } else {
+                g_interrupted = true;
+            }
+        }
+    }
+}
+
+static uint64_t next_uart_cycle() {
+    uint64_t next = UINT64_MAX;
+    for (fake_uart &uart : g_uarts) {
+        if (!uart.wire.empty()) next = std::min(next, uart.wire.front().first);
+    }
+    return next;
+}
+
+/** ----------------------------------------------------------------------------
+ * ADC
+*/
+
+static adc_hw_t g_adc_hw;
+adc_hw_t *adc_hw = &g_adc_hw;
+
+struct fake_adc {
+    uint16_t inputs[NUM_ADC_CHANNELS] = {0};
+    uint selected = 0;
+    uint round_robin = 0;
+    bool fifo_enabled = false;
+    bool dreq_enabled = false;
+    uint16_t dreq_threshold = 1;
+    uint64_t period = 96;
+    bool running = false;
+    uint64_t next = UINT64_MAX;
+    std::deque<uint16_t> fifo;
+};
+
+static fake_adc g_adc;
+
+void adc_init() {
+    g_adc = fake_adc();
+}
+
+void adc_gpio_init(uint gpio) {
+    gpio_set_function(gpio, GPIO_FUNC_NULL);
+    gpio_disable_pulls(gpio);
+}
+
+void adc_select_input(uint input) {
+    g_adc.selected = input;
+}
+
+void adc_set_round_robin(uint input_mask) {
+    g_adc.round_robin = input_mask;
+}
+
+void adc_fifo_setup(bool enabled, bool dreq_enabled, uint16_t dreq_threshold, bool error_in_fifo,
+                    bool byte_shift) {
+    g_adc.fifo_enabled = enabled;
+    g_adc.dreq_enabled = dreq_enabled;
+    g_adc.dreq_threshold = dreq_threshold;
+}
+
+/**
+ * A conversion takes 96 ADC clocks (48MHz), or div + 1 clocks if it's longer
+*/
+void adc_set_clkdiv(float clkdiv) {
+    uint64_t clocks = std::max<uint64_t>(96, (uint64_t)clkdiv + 1);
+    g_adc.period = clocks * SYS_CLK_KHZ / 48000;
+}
+
+void adc_run(bool run) {
+    g_adc.running = run;
+    g_adc.next = run ? fake_now + g_adc.period : UINT64_MAX;
+}
+
+void adc_fifo_drain() {
+    g_adc.fifo.clear();
+}
+
+uint16_t adc_read() {
+    return g_adc.inputs[g_adc.selected] & 0xfff;
+}
+
+void fake_adc_set(uint input, uint16_t value) {
+    g_adc.inputs[input] = value & 0xfff;
+}
+
+bool fake_adc_read(uintptr_t address, uint32_t &value) {
+    if (address != (uintptr_t)&adc_hw->fifo) return false;
+
+    value = 0;
+    if (!g_adc.fifo.empty()) {
+        value = g_adc.fifo.front();
+        g_adc.fifo.pop_front();
+    }
+    return true;
+}
+
+bool fake_adc_dreq() {
+    return g_adc.dreq_enabled && g_adc.fifo.size() >= g_adc.dreq_threshold;
+}
+
+/**
+ * Samples the selected input and moves on to the next one of the round robin
+*/
+static void run_adc() {
+    while (g_adc.next <= fake_now) {
+        if (g_adc.fifo_enabled && g_adc.fifo.size() < 4) {
+            g_adc.fifo.push_back(adc_read());
+        }
+
+        if (g_adc.round_robin) {
+            uint input = g_adc.selected;
+            do {
+                input = (input + 1) % NUM_ADC_CHANNELS;
+            } while (!(g_adc.round_robin & (1 << input)));
+            g_adc.selected = input;
+        }
+        g_adc.next += g_adc.period;
+    }
+}
+
+/** ----------------------------------------------------------------------------
+ * SPI and PWM, only what's written
+*/
+
+spi_hw_t fake_spi_hw[NUM_SPIS];
+
+uint spi_init(spi_inst_t *spi, uint baudrate) {
+    return baudrate;
+}
+
+void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order) {}
+
+uint spi_get_dreq(spi_inst_t *spi, bool is_tx) {
+    return DREQ_SPI0_TX + spi_get_index(spi) * 2 + (is_tx ? 0 : 1);
+}
+
+bool spi_is_writable(spi_inst_t *spi) {
+    return true;
+}
+
+bool fake_spi_write(uintptr_t address, uint32_t value) {
+    for (uint i = 0; i < NUM_SPIS; i++) {
+        if (address == (uintptr_t)&fake_spi_hw[i].dr) {
+            fake_spi_hw[i].dr = value;
+            fake_trace_add(FAKE_TRACE_DAC, i, value & 0xffff);
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint16_t g_pwm_levels[NUM_PWM_SLICES * 2];
+
+void pwm_set_wrap(uint slice, uint16_t wrap) {}
+void pwm_set_enabled(uint slice, bool enabled) {}
+
+void pwm_set_chan_level(uint slice, uint channel, uint16_t level) {
+    g_pwm_levels[slice * 2 + channel] = level;
+    fake_trace_add(FAKE_TRACE_PWM, slice * 2 + channel, level);
+}
+
+/** ----------------------------------------------------------------------------
+ * GPIO
+*/
+
+struct fake_gpio {
+    gpio_function function = GPIO_FUNC_NULL;
+    bool out = false;
+    bool value = false;
+    bool pull_up = false;
+    int input = -1;
+    uint inover = GPIO_OVERRIDE_NORMAL;
+};
+
+static fake_gpio g_gpios[NUM_BANK0_GPIOS];
+static std::function<int(uint)> g_input_hook;
+
+void gpio_init(uint gpio) {
+    g_gpios[gpio].function = GPIO_FUNC_SIO;
+    g_gpios[gpio].out = false;
+    g_gpios[gpio].value = false;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function function) {
+    g_gpios[gpio].function = function;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    g_gpios[gpio].out = out;
+}
+
+/**
+ * Traces the change of what the peripherals see
+*/
+static void set_gpio(uint gpio, std::function<void(fake_gpio &pin)> change) {
+    bool level = fake_gpio_level(gpio);
+    change(g_gpios[gpio]);
+    if (fake_gpio_level(gpio) != level) {
+        fake_trace_add(FAKE_TRACE_GPIO, gpio, !level);
+    }
+}
+
+void gpio_put(uint gpio, bool value) {
+    set_gpio(gpio, [value](fake_gpio &pin) { pin.value = value; });
+}
+
+void gpio_pull_up(uint gpio) {
+    g_gpios[gpio].pull_up = true;
+}
+
+void gpio_disable_pulls(uint gpio) {
+    g_gpios[gpio].pull_up = false;
+}
+
+void gpio_set_inover(uint gpio, uint value) {
+    set_gpio(gpio, [value](fake_gpio &pin) { pin.inover = value; });
+}
+
+bool gpio_get(uint gpio) {
+    return fake_gpio_level(gpio);
+}
+
+static bool pad_level(uint gpio) {
+    fake_gpio &pin = g_gpios[gpio];
+
+    if (pin.function == GPIO_FUNC_SIO && pin.out) return pin.value;
+    bool level;
+    if ((pin.function == GPIO_FUNC_PIO0 || pin.function == GPIO_FUNC_PIO1) &&
+        fake_pio_drives(pin.function == GPIO_FUNC_PIO1, gpio, level)) {
+        return level;
+    }
+
+    if (g_input_hook) {
+        int input = g_input_hook(gpio);
+        if (input >= 0) return input;
+    }
+    if (pin.input >= 0) return pin.input;
+    return pin.pull_up;
+}
+
+/**
+ * What the peripherals see, after the input override
+*/
+bool fake_gpio_level(uint gpio) {
+    switch (g_gpios[gpio].inover) {
+    case GPIO_OVERRIDE_INVERT: return !pad_level(gpio);
+    case GPIO_OVERRIDE_LOW: return false;
+    case GPIO_OVERRIDE_HIGH: return true;
+    default: return pad_level(gpio);
+    }
+}
+
+void fake_gpio_set_input(uint gpio, bool value) {
+    g_gpios[gpio].input = value;
+}
+
+void fake_gpio_set_input_hook(std::function<int(uint gpio)> hook) {
+    g_input_hook = hook;
+}
+
+bool fake_gpio_get_output(uint gpio) {
+    return pad_level(gpio);
+}
+
+/** ----------------------------------------------------------------------------
+ * Queue
+*/
+
+void queue_init(queue_t *queue, uint element_size, uint element_count) {
+    queue->data = (uint8_t *)calloc(element_count, element_size);
+    queue->element_size = element_size;
+    queue->element_count = element_count;
+    queue->head = 0;
+    queue->level = 0;
+}
+
+void queue_free(queue_t *queue) {
+    free(queue->data);
+    queue->data = NULL;
+}
+
+uint queue_get_level(queue_t *queue) {
+    return queue->level;
+}
+
+bool queue_is_empty(queue_t *queue) {
+    return queue->level == 0;
+}
+
+bool queue_is_full(queue_t *queue) {
+    return queue->level == queue->element_count;
+}
+
+bool queue_try_add(queue_t *queue, const void *data) {
+    if (queue_is_full(queue)) return false;
+
+    uint index = (queue->head + queue->level) % queue->element_count;
+    memcpy(queue->data + index * queue->element_size, data, queue->element_size);
+    queue->level++;
+    return true;
+}
+
+bool queue_try_remove(queue_t *queue, void *data) {
+    if (queue_is_empty(queue)) return false;
+
+    memcpy(data, queue->data + queue->head * queue->element_size, queue->element_size);
+    queue->head = (queue->head + 1) % queue->element_count;
+    queue->level--;
+    return true;
+}
+
+/**
+ * On the device the other core empties the queue meanwhile, here it's the
+ * wait hook. If it can't, it would wait forever.
+*/
+void queue_add_blocking(queue_t *queue, const void *data) {
+    if (queue_is_full(queue) && g_wait_hook && !g_in_wait_hook) {
+        g_in_wait_hook = true;
+        g_wait_hook();
+        g_in_wait_hook = false;
+    }
+    if (!queue_try_add(queue, data)) {
+        fake_hal_panic("queue_add_blocking() on a full queue would wait forever", __FILE__, __LINE__);
+    }
+}
+
+void queue_remove_blocking(queue_t *queue, void *data) {
+    if (!queue_try_remove(queue, data)) {
+        fake_hal_panic("queue_remove_blocking() on an empty queue would wait forever", __FILE__, __LINE__);
+    }
+}
+
+void fake_hal_set_wait_hook(std::function<void()> hook) {
+    g_wait_hook = hook;
+}
+
+/** ----------------------------------------------------------------------------
+ * Time
+*/
+
+/**
+ * Moves the time to the target, stepping through everything that happens on
+ * the way. With stop_on_event it returns at the first interrupt.
+*/
+static bool advance(uint64_t target, bool step_pio, bool stop_on_event) {
+    g_interrupted = false;
+
+    while (true) {
+        uint64_t next = std::min({target, next_timer_cycle(), next_uart_cycle(), g_adc.next,
+                                  fake_dma_next_timer_cycle()});
+        if (next < fake_now) next = fake_now;
+
+        if (step_pio && fake_pio_is_running()) {
+            while (fake_now < next) {
+                fake_now++;
+                fake_pio_tick();
+            }
+        } else {
+            fake_now = next;
+        }
+
+        run_uarts();
+        run_adc();
+        fake_dma_run_timers(fake_now);
+        fake_dma_service();
+        run_timers();
+
+        if (stop_on_event && g_interrupted) return true;
+        if (fake_now >= target) return false;
+    }
+}
+
+uint64_t fake_cycles() {
+    return fake_now;
+}
+
+void fake_advance_cycles(uint64_t cycles) {
+    advance(fake_now + cycles, g_pio_simulate, false);
+}
+
+void fake_advance_us(uint64_t us) {
+    fake_advance_cycles(us * FAKE_CYCLES_PER_US);
+}
+
+void fake_advance_to_us(uint64_t time_us) {
+    uint64_t target = time_us * FAKE_CYCLES_PER_US;
+    if (target > fake_now) advance(target, g_pio_simulate, false);
+}
+
+bool fake_wait_for_event(uint64_t until_cycle) {
+    if (until_cycle <= fake_now) return false;
+    return advance(until_cycle, g_pio_simulate, true);
+}
+
+uint32_t time_us_32() {
+    return (uint32_t)(fake_now / FAKE_CYCLES_PER_US);
+}
+
+uint64_t time_us_64() {
+    return fake_now / FAKE_CYCLES_PER_US;
+}
+
+absolute_time_t get_absolute_time() {
+    return time_us_64();
+}
+
+uint64_t to_us_since_boot(absolute_time_t time) {
+    return time;
+}
+
+absolute_time_t make_timeout_time_us(uint64_t us) {
+    return delayed_by_us(get_absolute_time(), us);
+}
+
+absolute_time_t delayed_by_us(absolute_time_t time, uint64_t us) {
+    uint64_t delayed = time + us;
+    return delayed < time ? UINT64_MAX : delayed;
+}
+
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+
+void sleep_us(uint64_t us) {
+    fake_advance_us(us);
+}
+
+void sleep_ms(uint32_t ms) {
+    fake_advance_us((uint64_t)ms * 1000);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout) {
+    g_wfe[g_core] = timeout;
+    return false;
+}
+
+uint64_t fake_take_wfe(uint core) {
+    uint64_t timeout = g_wfe[core];
+    g_wfe[core] = UINT64_MAX;
+    return timeout;
+}
+
+/**
+ * The PIO always runs while the CPU busy waits, that's what the DCO sync
+ * pulse is timed with
+*/
+void busy_wait_at_least_cycles(uint32_t cycles) {
+    advance(fake_now + cycles, true, false);
+}
+
+/**
+ * Spinning on something (e.g. the other core) takes time, so the timeouts
+ * work
+*/
+void tight_loop_contents() {
+    fake_advance_us(1);
+}
+
+/** ----------------------------------------------------------------------------
+ * Cores, clocks, SysTick
+*/
+
+uint get_core_num() {
+    return g_core;
+}
+
+void fake_set_core_num(uint core) {
+    g_core = core;
+}
+
+void multicore_launch_core1(void (*entry)(void)) {}
+
+uint32_t clock_get_hz(enum clock_index clock) {
+    return clock == clk_sys ? SYS_CLK_KHZ * 1000 : 48000000;
+}
+
+static systick_hw_t g_systick_hw;
+systick_hw_t *systick_hw = &g_systick_hw;
+static uint64_t g_systick_base = 0;
+
+static int g_instructions_fd = -1;
+
+/**
+ * SysTick runs on the host's time, scaled to the system clock, or counts the
+ * instructions of the process
+*/
+static uint64_t host_cycles() {
+    if (g_instructions_fd >= 0) {
+        uint64_t instructions = 0;
+        if (read(g_instructions_fd, &instructions, sizeof(instructions)) != sizeof(instructions)) return 0;
+        return instructions;
+    }
+
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() * FAKE_CYCLES_PER_US / 1000;
+}
+
+bool fake_systick_count_instructions(bool count) {
+    if (g_instructions_fd >= 0) {
+        close(g_instructions_fd);
+        g_instructions_fd = -1;
+    }
+    if (!count) return true;
+
+#ifdef __linux__
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    g_instructions_fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    return g_instructions_fd >= 0;
+}
+
+// SysTick counts down
+fake_systick_counter::operator uint32_t() const {
+    return (uint32_t)(g_systick_base - host_cycles()) & 0xffffff;
+}
+
+fake_systick_counter &fake_systick_counter::operator=(uint32_t value) {
+    g_systick_base = host_cycles() + value;
+    return *this;
+}
+
+/** ----------------------------------------------------------------------------
+ * stdio and USB
+*/
+
+static bool g_usb_capture = false;
+static std::string g_usb;
+static std::string g_stdin;
+static size_t g_stdin_position = 0;
+
+void stdio_init_all() {}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    if (g_stdin_position >= g_stdin.size()) return PICO_ERROR_TIMEOUT;
+    return (uint8_t)g_stdin[g_stdin_position++];
+}
+
+bool stdio_usb_connected() {
+    return g_usb_capture;
+}
+
+bool tud_cdc_connected() {
+    return g_usb_capture;
+}
+
+uint32_t tud_cdc_write_available() {
+    return CFG_TUD_CDC_TX_BUFSIZE;
+}
+
+uint32_t tud_cdc_write(const void *buffer, uint32_t length) {
+    g_usb.append((const char *)buffer, length);
+    return length;
+}
+
+uint32_t tud_cdc_write_flush() {
+    return 0;
+}
+
+void fake_usb_capture(bool capture) {
+    g_usb_capture = capture;
+}
+
+std::string fake_usb_take() {
+    std::string text;
+    text.swap(g_usb);
+    return text;
+}
+
+void fake_stdin_set(const std::string &data) {
+    g_stdin = data;
+    g_stdin_position = 0;
+}
+
+/** ----------------------------------------------------------------------------
+ * Trace
+*/
+
+void fake_trace_add(fake_trace_type type, uint8_t channel, uint32_t value) {
+    if (g_trace_enabled) {
+        g_trace.push_back({fake_now, type, channel, value});
+    }
+}
+
+void fake_trace_enable(bool enabled) {
+    g_trace_enabled = enabled;
+}
+
+const std::vector<fake_trace_entry> &fake_trace() {
+    return g_trace;
+}
+
+void fake_trace_clear() {
+    g_trace.clear();
+}
+
+std::vector<fake_trace_entry> fake_trace_of(fake_trace_type type, int channel) {
+    std::vector<fake_trace_entry> entries;
+    for (const fake_trace_entry &entry : g_trace) {
+        if (entry.type == type && (channel < 0 || entry.channel == channel)) {
+            entries.push_back(entry);
+        }
+    }
+    return entries;
+}
+
+void fake_trace_write(FILE *file) {
+    static const char types[] = {'P', 'W', 'C', 'G'};
+    for (const fake_trace_entry &entry : g_trace) {
+        fprintf(file, "%llu %c %u %u\n", (unsigned long long)entry.cycle, types[entry.type], entry.channel,
+                entry.value);
+    }
+}
+
+void fake_pio_simulate(bool simulate) {
+    g_pio_simulate = simulate;
+}
+
+void fake_pio_step(uint64_t cycles) {
+    advance(fake_now + cycles, true, false);
+}
+
+/** ----------------------------------------------------------------------------
+ * Reset
+*/
+
+void fake_hal_panic(const char *message, const char *file, int line) {
+    fprintf(stderr, "%s:%d: %s\n", file, line, message);
+    abort();
+}
+
+void fake_hal_reset() {
+    fake_now = 0;
+    g_core = 0;
+    g_wfe[0] = g_wfe[1] = UINT64_MAX;
+    g_wait_hook = nullptr;
+
+    for (uint i = 0; i < NUM_IRQS; i++) {
+        g_irq_handlers[i] = NULL;
+        g_irq_enabled[i] = false;
+    }
+    g_irq_pending = 0;
+    g_interrupts_disabled = false;
+
+    g_timers.clear();
+    for (uint i = 0; i < NUM_UARTS; i++) {
+        g_uarts[i] = fake_uart();
+    }
+    g_adc = fake_adc();
+    for (uint i = 0; i < NUM_BANK0_GPIOS; i++) {
+        g_gpios[i] = fake_gpio();
+    }
+    g_input_hook = nullptr;
+
+    g_trace_enabled = true;
+    g_trace.clear();
+    g_pio_simulate = false;
+    g_usb_capture = false;
+    g_usb.clear();
+    fake_stdin_set("");
+
+    fake_pio_reset();
+    fake_dma_reset();
+}
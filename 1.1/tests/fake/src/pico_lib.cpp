@@ -0,0 +1,130 @@
+#include "pico/time.h"
+#include <utils.h>
+#include <adsr.h>
+#include <midi_parser.h>
+#include <ringbuffer.h>
+
+/** ----------------------------------------------------------------------------
+ * Utils
+*/
+
+long Utils::map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+uint32_t Utils::millis() {
+    return time_us_64() / 1000;
+}
+
+/** ----------------------------------------------------------------------------
+ * ADSR
+*/
+
+ADSR::ADSR(int size): m_max(size - 1) {}
+
+void ADSR::set_attack(uint64_t attack_us) {
+    m_attack = attack_us;
+}
+
+void ADSR::set_decay(uint64_t decay_us) {
+    m_decay = decay_us;
+}
+
+void ADSR::set_sustain(int sustain) {
+    m_sustain = sustain;
+}
+
+void ADSR::set_release(uint64_t release_us) {
+    m_release = release_us;
+}
+
+/**
+ * Both start from the current level, so a retrigger doesn't jump
+*/
+void ADSR::note_on() {
+    m_from = envelope();
+    m_on = true;
+    m_start_us = time_us_64();
+}
+
+void ADSR::note_off() {
+    m_from = envelope();
+    m_on = false;
+    m_start_us = time_us_64();
+}
+
+static int ramp(int from, int to, uint64_t elapsed, uint64_t duration) {
+    if (elapsed >= duration) return to;
+    return from + (int64_t)(to - from) * (int64_t)elapsed / (int64_t)duration;
+}
+
+uint16_t ADSR::envelope() {
+    uint64_t elapsed = time_us_64() - m_start_us;
+
+    if (!m_on) return ramp(m_from, 0, elapsed, m_release);
+    if (elapsed < m_attack) return ramp(m_from, m_max, elapsed, m_attack);
+    return ramp(m_max, m_sustain, elapsed - m_attack, m_decay);
+}
+
+/** ----------------------------------------------------------------------------
+ * MidiParser
+*/
+
+void MidiParser::parse_byte(uint8_t byte) {
+    if (byte & 0x80) {
+        // Real-time messages don't touch running status
+        if (byte >= 0xf8) return;
+
+        m_status = byte < 0xf0 ? byte : 0;
+        m_count = 0;
+        return;
+    }
+    if (!m_status) return;
+
+    m_data[m_count++] = byte;
+    uint8_t type = m_status & 0xf0;
+    uint8_t expected = (type == 0xc0 || type == 0xd0) ? 1 : 2;
+    if (m_count < expected) return;
+    m_count = 0;
+
+    uint8_t channel = m_status & 0x0f;
+    switch (type) {
+    case 0x80:
+        note_off(channel, m_data[0], m_data[1]);
+        break;
+    case 0x90:
+        if (m_data[1]) {
+            note_on(channel, m_data[0], m_data[1]);
+        } else {
+            note_off(channel, m_data[0], 0);
+        }
+        break;
+    case 0xb0:
+        cc(channel, m_data[0], m_data[1]);
+        break;
+    case 0xe0:
+        pitch_bend(channel, (m_data[1] << 7) | m_data[0]);
+        break;
+    }
+}
+
+/** ----------------------------------------------------------------------------
+ * RingBuffer
+*/
+
+void RingBuffer::init(uint8_t *buffer, int size) {
+    m_buffer = buffer;
+    m_size = size;
+    m_head = 0;
+    m_tail = 0;
+}
+
+void RingBuffer::write_byte(uint8_t byte) {
+    m_buffer[m_head] = byte;
+    m_head = (m_head + 1) % m_size;
+}
+
+void RingBuffer::read_byte(uint8_t &byte) {
+    byte = m_buffer[m_tail];
+    m_tail = (m_tail + 1) % m_size;
+}
@@ -0,0 +1,596 @@
+#include <string.h>
+#include <deque>
+#include "fake_internal.h"
+#include "hardware/pio.h"
+
+struct fake_sm {
+    bool claimed = false;
+    bool enabled = false;
+    pio_sm_config config;
+    uint8_t pc = 0;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t isr = 0;
+    uint32_t osr = 0;
+    uint8_t isr_count = 0;
+    uint8_t osr_count = 32;         // Bits shifted out, 32 is empty
+    uint8_t delay = 0;
+    std::deque<uint32_t> tx;
+    std::deque<uint32_t> rx;
+    std::vector<fake_pio_edge> edges;
+};
+
+struct fake_pio {
+    uint16_t instructions[PIO_INSTRUCTION_COUNT];
+    uint32_t used = 0;
+    fake_sm sms[NUM_PIO_STATE_MACHINES];
+    bool pin_values[NUM_BANK0_GPIOS];
+    bool pin_dirs[NUM_BANK0_GPIOS];
+};
+
+pio_hw_t fake_pio_hw[NUM_PIOS] = {
+    {{{0, 0}, {0, 1}, {0, 2}, {0, 3}}},
+    {{{1, 0}, {1, 1}, {1, 2}, {1, 3}}}
+};
+
+static fake_pio g_pios[NUM_PIOS];
+static bool g_pulled = false;
+
+static fake_pio &get_pio(PIO pio) {
+    return g_pios[pio_get_index(pio)];
+}
+
+static fake_sm &get_sm(PIO pio, uint sm) {
+    return g_pios[pio_get_index(pio)].sms[sm];
+}
+
+void fake_pio_reset() {
+    for (uint i = 0; i < NUM_PIOS; i++) {
+        g_pios[i] = fake_pio();
+        memset(g_pios[i].instructions, 0, sizeof(g_pios[i].instructions));
+        memset(g_pios[i].pin_values, 0, sizeof(g_pios[i].pin_values));
+        memset(g_pios[i].pin_dirs, 0, sizeof(g_pios[i].pin_dirs));
+        for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            g_pios[i].sms[sm].config = pio_get_default_sm_config();
+        }
+    }
+}
+
+/** ----------------------------------------------------------------------------
+ * Config
+*/
+
+pio_sm_config pio_get_default_sm_config() {
+    pio_sm_config config;
+    memset(&config, 0, sizeof(config));
+    config.wrap_target = 0;
+    config.wrap = PIO_INSTRUCTION_COUNT - 1;
+    config.in_shift_right = true;
+    config.out_shift_right = true;
+    config.pull_threshold = 32;
+    config.push_threshold = 32;
+    return config;
+}
+
+void sm_config_set_wrap(pio_sm_config *config, uint wrap_target, uint wrap) {
+    config->wrap_target = wrap_target;
+    config->wrap = wrap;
+}
+
+void sm_config_set_set_pins(pio_sm_config *config, uint set_base, uint set_count) {
+    config->set_base = set_base;
+    config->set_count = set_count;
+}
+
+void sm_config_set_out_pins(pio_sm_config *config, uint out_base, uint out_count) {
+    config->out_base = out_base;
+    config->out_count = out_count;
+}
+
+void sm_config_set_in_pins(pio_sm_config *config, uint in_base) {
+    config->in_base = in_base;
+}
+
+void sm_config_set_out_shift(pio_sm_config *config, bool shift_right, bool autopull, uint pull_threshold) {
+    hard_assert(!autopull);
+    config->out_shift_right = shift_right;
+    config->pull_threshold = pull_threshold ? pull_threshold : 32;
+}
+
+void sm_config_set_in_shift(pio_sm_config *config, bool shift_right, bool autopush, uint push_threshold) {
+    hard_assert(!autopush);
+    config->in_shift_right = shift_right;
+    config->push_threshold = push_threshold ? push_threshold : 32;
+}
+
+void sm_config_set_clkdiv_int_frac(pio_sm_config *config, uint16_t div_int, uint8_t div_frac) {
+    hard_assert(div_int <= 1 && div_frac == 0);
+}
+
+/** ----------------------------------------------------------------------------
+ * Instruction memory, like the SDK: programs without an origin go to the top
+*/
+
+static int find_offset(fake_pio &pio, const pio_program_t *program) {
+    uint32_t mask = (1u << program->length) - 1;
+    if (program->origin >= 0) {
+        return (pio.used & (mask << program->origin)) ? -1 : program->origin;
+    }
+    for (int offset = PIO_INSTRUCTION_COUNT - program->length; offset >= 0; offset--) {
+        if (!(pio.used & (mask << offset))) return offset;
+    }
+    return -1;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program) {
+    return find_offset(get_pio(pio), program) >= 0;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program) {
+    fake_pio &state = get_pio(pio);
+    int offset = find_offset(state, program);
+    hard_assert(offset >= 0);
+
+    for (uint i = 0; i < program->length; i++) {
+        uint16_t instr = program->instructions[i];
+        // JMP targets are relative to the program
+        state.instructions[offset + i] = (instr & 0xe000) ? instr : instr + offset;
+    }
+    state.used |= ((1u << program->length) - 1) << offset;
+    return offset;
+}
+
+void pio_remove_program(PIO pio, const pio_program_t *program, uint offset) {
+    get_pio(pio).used &= ~(((1u << program->length) - 1) << offset);
+}
+
+void pio_clear_instruction_memory(PIO pio) {
+    get_pio(pio).used = 0;
+}
+
+void pio_sm_claim(PIO pio, uint sm) {
+    hard_assert(!get_sm(pio, sm).claimed);
+    get_sm(pio, sm).claimed = true;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (!get_sm(pio, sm).claimed) {
+            get_sm(pio, sm).claimed = true;
+            return sm;
+        }
+    }
+    hard_assert(!required);
+    return -1;
+}
+
+void pio_sm_unclaim(PIO pio, uint sm) {
+    get_sm(pio, sm).claimed = false;
+}
+
+/** ----------------------------------------------------------------------------
+ * Pins
+*/
+
+void pio_gpio_init(PIO pio, uint pin) {
+    gpio_set_function(pin, pio_get_index(pio) ? GPIO_FUNC_PIO1 : GPIO_FUNC_PIO0);
+}
+
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out) {
+    for (uint pin = pin_base; pin < pin_base + pin_count; pin++) {
+        get_pio(pio).pin_dirs[pin % NUM_BANK0_GPIOS] = is_out;
+    }
+}
+
+bool fake_pio_drives(uint pio, uint gpio, bool &level) {
+    fake_pio &state = g_pios[pio];
+    level = state.pin_values[gpio];
+    return state.pin_dirs[gpio];
+}
+
+static void write_pins(fake_pio &pio, fake_sm &sm, uint base, uint count, uint32_t values) {
+    for (uint i = 0; i < count; i++) {
+        uint pin = (base + i) % NUM_BANK0_GPIOS;
+        bool value = values & (1u << i);
+        if (pin == sm.config.set_base && value != pio.pin_values[pin]) {
+            sm.edges.push_back({fake_now, value});
+        }
+        pio.pin_values[pin] = value;
+    }
+}
+
+static void write_pindirs(fake_pio &pio, uint base, uint count, uint32_t values) {
+    for (uint i = 0; i < count; i++) {
+        pio.pin_dirs[(base + i) % NUM_BANK0_GPIOS] = values & (1u << i);
+    }
+}
+
+static uint32_t read_pins(fake_sm &sm) {
+    uint32_t values = 0;
+    for (uint i = 0; i < 32; i++) {
+        uint pin = (sm.config.in_base + i) % 32;
+        if (pin < NUM_BANK0_GPIOS && fake_gpio_level(pin)) values |= (1u << i);
+    }
+    return values;
+}
+
+/** ----------------------------------------------------------------------------
+ * State machines
+*/
+
+void pio_sm_set_config(PIO pio, uint sm, const pio_sm_config *config) {
+    get_sm(pio, sm).config = *config;
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config) {
+    pio_sm_set_enabled(pio, sm, false);
+    pio_sm_set_config(pio, sm, config);
+    pio_sm_clear_fifos(pio, sm);
+    pio_sm_restart(pio, sm);
+    pio_sm_clkdiv_restart(pio, sm);
+    pio_sm_exec(pio, sm, pio_encode_jmp(initial_pc));
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+    get_sm(pio, sm).enabled = enabled;
+}
+
+void pio_set_sm_mask_enabled(PIO pio, uint32_t mask, bool enabled) {
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (mask & (1u << sm)) pio_sm_set_enabled(pio, sm, enabled);
+    }
+}
+
+void pio_enable_sm_mask_in_sync(PIO pio, uint32_t mask) {
+    pio_set_sm_mask_enabled(pio, mask, true);
+}
+
+/**
+ * Clears the shift counters, the ISR and the delay, X, Y and the OSR stay
+*/
+void pio_sm_restart(PIO pio, uint sm) {
+    fake_sm &state = get_sm(pio, sm);
+    state.isr = 0;
+    state.isr_count = 0;
+    state.osr_count = 32;
+    state.delay = 0;
+}
+
+void pio_restart_sm_mask(PIO pio, uint32_t mask) {
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (mask & (1u << sm)) pio_sm_restart(pio, sm);
+    }
+}
+
+// Clock divider 1 only, nothing to restart
+void pio_sm_clkdiv_restart(PIO pio, uint sm) {}
+void pio_clkdiv_restart_sm_mask(PIO pio, uint32_t mask) {}
+
+uint8_t pio_sm_get_pc(PIO pio, uint sm) {
+    return get_sm(pio, sm).pc;
+}
+
+void pio_sm_put(PIO pio, uint sm, uint32_t data) {
+    pio->txf[sm] = data;
+}
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) {
+    while (pio_sm_is_tx_fifo_full(pio, sm)) {
+        if (!get_sm(pio, sm).enabled) {
+            fake_hal_panic("pio_sm_put_blocking() to a stopped state machine would wait forever", __FILE__,
+                           __LINE__);
+        }
+        fake_pio_step(1);
+    }
+    pio_sm_put(pio, sm, data);
+}
+
+/**
+ * A write to a full FIFO is lost, like on the device. Only the words that get
+ * in are traced.
+*/
+fake_pio_tx_fifo &fake_pio_tx_fifo::operator=(uint32_t value) {
+    fake_sm &state = g_pios[pio].sms[sm];
+    if (state.tx.size() < PIO_FIFO_DEPTH) {
+        state.tx.push_back(value);
+        fake_trace_add(FAKE_TRACE_PIO, pio * NUM_PIO_STATE_MACHINES + sm, value);
+    }
+    return *this;
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm) {
+    get_sm(pio, sm).tx.clear();
+    get_sm(pio, sm).rx.clear();
+}
+
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm) {
+    return get_sm(pio, sm).tx.size() >= PIO_FIFO_DEPTH;
+}
+
+bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm) {
+    return get_sm(pio, sm).tx.empty();
+}
+
+uint pio_sm_get_tx_fifo_level(PIO pio, uint sm) {
+    return get_sm(pio, sm).tx.size();
+}
+
+bool fake_pio_tx_ready(uint pio, uint sm) {
+    return g_pios[pio].sms[sm].tx.size() < PIO_FIFO_DEPTH;
+}
+
+bool fake_pio_is_tx_fifo(uintptr_t address, uint &pio, uint &sm) {
+    for (pio = 0; pio < NUM_PIOS; pio++) {
+        for (sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            if (address == (uintptr_t)&fake_pio_hw[pio].txf[sm]) return true;
+        }
+    }
+    return false;
+}
+
+/** ----------------------------------------------------------------------------
+ * Interpreter
+*/
+
+static uint32_t bit_count(uint16_t instr) {
+    uint32_t count = instr & 0x1f;
+    return count ? count : 32;
+}
+
+static uint32_t mask_of(uint32_t bits) {
+    return bits >= 32 ? 0xffffffff : (1u << bits) - 1;
+}
+
+static uint32_t shift_out(fake_sm &sm, uint32_t bits) {
+    uint32_t data;
+    if (sm.config.out_shift_right) {
+        data = sm.osr & mask_of(bits);
+        sm.osr = bits >= 32 ? 0 : sm.osr >> bits;
+    } else {
+        data = bits >= 32 ? sm.osr : sm.osr >> (32 - bits);
+        sm.osr = bits >= 32 ? 0 : sm.osr << bits;
+    }
+    sm.osr_count = sm.osr_count + bits > 32 ? 32 : sm.osr_count + bits;
+    return data;
+}
+
+static void shift_in(fake_sm &sm, uint32_t data, uint32_t bits) {
+    data &= mask_of(bits);
+    if (sm.config.in_shift_right) {
+        sm.isr = (bits >= 32 ? 0 : sm.isr >> bits) | (bits >= 32 ? data : data << (32 - bits));
+    } else {
+        sm.isr = (bits >= 32 ? 0 : sm.isr << bits) | data;
+    }
+    sm.isr_count = sm.isr_count + bits > 32 ? 32 : sm.isr_count + bits;
+}
+
+static uint32_t reverse(uint32_t value) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < 32; i++) {
+        if (value & (1u << i)) reversed |= (1u << (31 - i));
+    }
+    return reversed;
+}
+
+static void unsupported(uint16_t instr) {
+    char message[64];
+    snprintf(message, sizeof(message), "unsupported PIO instruction 0x%04x", instr);
+    fake_hal_panic(message, __FILE__, __LINE__);
+}
+
+/**
+ * Executes an instruction. Returns false if it stalls, then it's executed
+ * again on the next cycle. jumped is set if it has set the PC.
+*/
+static bool execute(fake_pio &pio, fake_sm &sm, uint16_t instr, bool &jumped) {
+    jumped = false;
+    uint32_t op = (instr >> 5) & 0x7;
+
+    switch (instr >> 13) {
+    case 0: {   // JMP
+        bool jump = false;
+        switch (op) {
+        case 0: jump = true; break;
+        case 1: jump = !sm.x; break;
+        case 2: jump = sm.x != 0; sm.x--; break;
+        case 3: jump = !sm.y; break;
+        case 4: jump = sm.y != 0; sm.y--; break;
+        case 5: jump = sm.x != sm.y; break;
+        case 6: unsupported(instr); break;
+        case 7: jump = sm.osr_count < sm.config.pull_threshold; break;
+        }
+        if (jump) {
+            sm.pc = instr & 0x1f;
+            jumped = true;
+        }
+        return true;
+    }
+
+    case 1: {   // WAIT
+        bool polarity = instr & 0x80;
+        uint32_t index = instr & 0x1f;
+        bool level = false;
+        switch ((instr >> 5) & 0x3) {
+        case 0: level = fake_gpio_level(index); break;
+        case 1: level = fake_gpio_level((sm.config.in_base + index) % 32); break;
+        default: unsupported(instr); break;
+        }
+        return level == polarity;
+    }
+
+    case 2: {   // IN
+        uint32_t bits = bit_count(instr);
+        uint32_t data = 0;
+        switch (op) {
+        case 0: data = read_pins(sm); break;
+        case 1: data = sm.x; break;
+        case 2: data = sm.y; break;
+        case 3: data = 0; break;
+        case 6: data = sm.isr; break;
+        case 7: data = sm.osr; break;
+        default: unsupported(instr); break;
+        }
+        shift_in(sm, data, bits);
+        return true;
+    }
+
+    case 3: {   // OUT
+        uint32_t bits = bit_count(instr);
+        uint32_t data = shift_out(sm, bits);
+        switch (op) {
+        case 0: write_pins(pio, sm, sm.config.out_base, bits, data); break;
+        case 1: sm.x = data; break;
+        case 2: sm.y = data; break;
+        case 3: break;
+        case 4: write_pindirs(pio, sm.config.out_base, bits, data); break;
+        case 5: sm.pc = data & 0x1f; jumped = true; break;
+        case 6: sm.isr = data; sm.isr_count = bits; break;
+        default: unsupported(instr); break;
+        }
+        return true;
+    }
+
+    case 4: {   // PUSH / PULL
+        bool if_full_empty = instr & 0x40;
+        bool block = instr & 0x20;
+
+        if (instr & 0x80) {
+            if (if_full_empty && sm.osr_count < sm.config.pull_threshold) return true;
+            if (sm.tx.empty()) {
+                if (block) return false;
+                // Non-blocking pull of an empty FIFO copies X
+                sm.osr = sm.x;
+            } else {
+                sm.osr = sm.tx.front();
+                sm.tx.pop_front();
+                g_pulled = true;
+            }
+            sm.osr_count = 0;
+        } else {
+            if (if_full_empty && sm.isr_count < sm.config.push_threshold) return true;
+            if (sm.rx.size() >= PIO_FIFO_DEPTH) {
+                if (block) return false;
+            } else {
+                sm.rx.push_back(sm.isr);
+            }
+            sm.isr = 0;
+            sm.isr_count = 0;
+        }
+        return true;
+    }
+
+    case 5: {   // MOV
+        uint32_t data = 0;
+        switch (instr & 0x7) {
+        case 0: data = read_pins(sm); break;
+        case 1: data = sm.x; break;
+        case 2: data = sm.y; break;
+        case 3: data = 0; break;
+        case 6: data = sm.isr; break;
+        case 7: data = sm.osr; break;
+        default: unsupported(instr); break;
+        }
+        switch ((instr >> 3) & 0x3) {
+        case 1: data = ~data; break;
+        case 2: data = reverse(data); break;
+        }
+        switch (op) {
+        case 0: write_pins(pio, sm, sm.config.out_base, sm.config.out_count, data); break;
+        case 1: sm.x = data; break;
+        case 2: sm.y = data; break;
+        case 5: sm.pc = data & 0x1f; jumped = true; break;
+        case 6: sm.isr = data; sm.isr_count = 0; break;
+        case 7: sm.osr = data; sm.osr_count = 0; break;
+        default: unsupported(instr); break;
+        }
+        return true;
+    }
+
+    case 7: {   // SET
+        uint32_t data = instr & 0x1f;
+        switch (op) {
+        case 0: write_pins(pio, sm, sm.config.set_base, sm.config.set_count, data); break;
+        case 1: sm.x = data; break;
+        case 2: sm.y = data; break;
+        case 4: write_pindirs(pio, sm.config.set_base, sm.config.set_count, data); break;
+        default: unsupported(instr); break;
+        }
+        return true;
+    }
+
+    default:
+        unsupported(instr);
+        return true;
+    }
+}
+
+/**
+ * Executed right away, even if the state machine is stopped. The PIO's own
+ * delay of the instruction is ignored.
+*/
+void pio_sm_exec(PIO pio, uint sm, uint instr) {
+    bool jumped;
+    if (!execute(get_pio(pio), get_sm(pio, sm), instr, jumped)) {
+        fake_hal_panic("pio_sm_exec() of a stalling instruction", __FILE__, __LINE__);
+    }
+}
+
+bool fake_pio_is_running() {
+    for (uint i = 0; i < NUM_PIOS; i++) {
+        for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            if (g_pios[i].sms[sm].enabled) return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * One clock cycle of all the enabled state machines
+*/
+void fake_pio_tick() {
+    g_pulled = false;
+
+    for (uint i = 0; i < NUM_PIOS; i++) {
+        fake_pio &pio = g_pios[i];
+        for (uint index = 0; index < NUM_PIO_STATE_MACHINES; index++) {
+            fake_sm &sm = pio.sms[index];
+            if (!sm.enabled) continue;
+            if (sm.delay) {
+                sm.delay--;
+                continue;
+            }
+
+            uint16_t instr = pio.instructions[sm.pc];
+            bool jumped;
+            if (!execute(pio, sm, instr, jumped)) continue;
+
+            if (!jumped) {
+                sm.pc = (sm.pc == sm.config.wrap) ? sm.config.wrap_target : (sm.pc + 1) % PIO_INSTRUCTION_COUNT;
+            }
+            sm.delay = (instr >> 8) & 0x1f;
+        }
+    }
+
+    // Room in a TX FIFO, DMA may fill it
+    if (g_pulled) fake_dma_service();
+}
+
+const std::vector<fake_pio_edge> &fake_pio_edges(uint pio, uint sm) {
+    return g_pios[pio].sms[sm].edges;
+}
+
+void fake_pio_clear_edges() {
+    for (uint i = 0; i < NUM_PIOS; i++) {
+        for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            g_pios[i].sms[sm].edges.clear();
+        }
+    }
+}
+
+uint32_t fake_pio_get_x(uint pio, uint sm) {
+    return g_pios[pio].sms[sm].x;
+}
+
+uint32_t fake_pio_get_y(uint pio, uint sm) {
+    return g_pios[pio].sms[sm].y;
+}
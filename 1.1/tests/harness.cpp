@@ -0,0 +1,170 @@
+#include "harness.h"
+#include <algorithm>
+#include "recorder.h"
+#include "smf_player.h"
+
+// Defined in main.cpp on the device
+Settings settings;
+
+#define HARNESS_MAX_IDLE_PASSES 100000
+
+static bool g_notes[128];
+
+/**
+ * Same init and tasks as main(), with ENABLE_DUAL_CORE
+*/
+void Harness::boot(device_mode mode) {
+    if (!m_booted) {
+        m_booted = true;
+
+        fake_hal_reset();
+        fake_gpio_set_input_hook([this](uint gpio) { return m_mux_input(gpio); });
+        set_mode(mode);
+
+        // What core 1 would do while core 0 waits for the output queue
+        fake_hal_set_wait_hook([]() {
+            uint core = get_core_num();
+            fake_set_core_num(1);
+            Synth::get_instance().process_output();
+            fake_set_core_num(core);
+        });
+
+        UI &ui = UI::get_instance();
+        Synth &synth = Synth::get_instance();
+
+        ui.init();
+        sleep_ms(1000);
+        ui.init_scan();
+
+        synth.init(PARA);
+        synth.init_dcos();
+
+        m_core1.add_task("output", []() { Synth::get_instance().process_output(); }, OUTPUT_TICK_US,
+                         OUTPUT_TICK_US, 0, []() { return Synth::get_instance().has_output_events(); });
+
+        m_core0.add_task("midi", []() { Synth::get_instance().process_midi(); }, 0, 0, 0,
+                         []() { return Synth::get_instance().has_midi(); });
+        m_core0.add_task("ui", []() { Synth::get_instance().process_ui(); }, 0, 0, 2,
+                         []() { return Synth::get_instance().has_ui_events(); });
+        m_core0.add_task("glide", []() { Synth::get_instance().process_glide(); }, GLIDE_TICK_US,
+                         GLIDE_TICK_US / 2, 2);
+
+        if (ENABLE_SMF_PLAYER) {
+            m_core0.add_task("smf", []() { SmfPlayer::get_instance().process(); }, 500, 500, 1);
+        }
+
+        if (ENABLE_OUTPUT_RECORDER) {
+            m_core0.add_task("recorder", []() { OutputRecorder::get_instance().process(); }, 2000, 2000, 8);
+        }
+    }
+
+    // The pots are smoothed, give them a few scans
+    set_mode(mode);
+    run_for_us(20000);
+}
+
+/**
+ * Runs a pass of each core's scheduler in turn. The firmware takes no time,
+ * so when both cores wait the time moves to the first timeout or interrupt.
+*/
+void Harness::run_for_us(uint64_t us) {
+    uint64_t end = fake_cycles() + us * FAKE_CYCLES_PER_US;
+    uint32_t idle_passes = 0;
+
+    while (fake_cycles() < end) {
+        fake_set_core_num(0);
+        m_core0.run_once();
+        fake_set_core_num(1);
+        m_core1.run_once();
+        fake_set_core_num(0);
+
+        uint64_t wfe0 = fake_take_wfe(0);
+        uint64_t wfe1 = fake_take_wfe(1);
+        if (wfe0 == UINT64_MAX || wfe1 == UINT64_MAX) {
+            // A task that's always ready would hang the device too
+            if (++idle_passes > HARNESS_MAX_IDLE_PASSES) {
+                fake_hal_panic("a task is always ready", __FILE__, __LINE__);
+            }
+            continue;
+        }
+
+        idle_passes = 0;
+        uint64_t wake = std::min(wfe0, wfe1);
+        wake = (wake > UINT64_MAX / FAKE_CYCLES_PER_US) ? end : wake * FAKE_CYCLES_PER_US;
+        if (wake <= fake_cycles()) wake = fake_cycles() + 1;
+        fake_wait_for_event(std::min(wake, end));
+    }
+}
+
+void Harness::run_until_midi_sent(uint64_t extra_us) {
+    uint64_t idle = fake_uart_idle_cycle(1);
+    uint64_t us = (idle - fake_cycles()) / FAKE_CYCLES_PER_US + 1;
+    run_for_us(us + extra_us);
+}
+
+void Harness::send_midi(std::initializer_list<uint8_t> bytes) {
+    send_midi(bytes.begin(), bytes.size());
+}
+
+void Harness::send_midi(const uint8_t *data, size_t length) {
+    fake_uart_send(1, data, length);
+}
+
+void Harness::inject_midi(std::initializer_list<uint8_t> bytes) {
+    size_t injected = MidiInput::get_instance().inject(bytes.begin(), bytes.size());
+    hard_assert(injected == bytes.size());
+}
+
+void Harness::note_on(uint8_t note, uint8_t velocity) {
+    g_notes[note & 0x7f] = velocity > 0;
+    send_midi({(uint8_t)(0x90 | MIDI_CHANNEL), note, velocity});
+}
+
+void Harness::note_off(uint8_t note) {
+    g_notes[note & 0x7f] = false;
+    send_midi({(uint8_t)(0x80 | MIDI_CHANNEL), note, 0});
+}
+
+void Harness::set_switch(mux_switch sw, bool on) {
+    if (on) {
+        m_switches |= (1 << sw);
+    } else {
+        m_switches &= ~(1 << sw);
+    }
+}
+
+void Harness::set_pot(uint channel, uint16_t value) {
+    fake_adc_set(channel, value);
+}
+
+/**
+ * Middle of the mode's step of the pot
+*/
+void Harness::set_mode(device_mode mode) {
+    set_pot(ADC_SYNTH_MODE_CHANNEL, (2 * mode + 1) * 4096 / (2 * NO_OF_MODES));
+}
+
+void Harness::reset_outputs() {
+    for (int note = 0; note < 128; note++) {
+        if (g_notes[note]) note_off(note);
+    }
+    send_midi({(uint8_t)(0xe0 | MIDI_CHANNEL), 0x00, 0x40});
+    send_midi({(uint8_t)(0xb0 | MIDI_CHANNEL), 1, 0});
+    run_until_midi_sent(RELEASE_SHORT * 2);
+    fake_trace_clear();
+}
+
+/** ----------------------------------------------------------------------------
+ * PRIVATE
+*/
+
+/**
+ * The switches pull the mux input low, the address is set by the scan
+*/
+int Harness::m_mux_input(uint gpio) {
+    if (gpio != MUX_BINARY_INPUT) return -1;
+
+    uint address = fake_gpio_get_output(MUX_BINARY_PIN_A) | (fake_gpio_get_output(MUX_BINARY_PIN_B) << 1) |
+                   (fake_gpio_get_output(MUX_BINARY_PIN_C) << 2);
+    return !(m_switches & (1 << address));
+}
@@ -0,0 +1,80 @@
+#ifndef _HARNESS_H
+#define _HARNESS_H
+
+/**
+ * Firmware harness
+ *
+ * Boots the synth like main() does, on the fake HAL, with the same tasks on
+ * the two schedulers, and runs them in virtual time. The panel is simulated
+ * behind the mux and the ADC, MIDI goes through the UART at the wire speed,
+ * so everything the tests send takes the same path as on the device.
+ *
+ * The firmware's singletons live for the whole process, so it boots once and
+ * the tests of an executable share it. Tests that need a clean state
+ * (reset_outputs()) get the voices off and the trace cleared.
+ */
+
+#include <initializer_list>
+#include "fake_hal.h"
+#include "synth.h"
+#include "ui.h"
+#include "scheduler.h"
+#include "settings.h"
+
+#define HARNESS_BOOT_US     1000000     // main() waits 1s before the first scan
+#define HARNESS_DEBOUNCE_US ((NO_OF_SWITCHES * SWITCH_DEBOUNCE_READS + 2) * UI_SCAN_PERIOD_US)
+
+class Harness {
+public:
+    static Harness& get_instance() {
+        static Harness instance;
+        return instance;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(Harness);
+
+    // Boots on the first call, then sets the mode pot
+    void boot(device_mode mode = PARA);
+
+    // Runs both cores for the given time
+    void run_for_us(uint64_t us);
+
+    // Runs until the MIDI sent so far has arrived and a bit more, so its
+    // outputs are out
+    void run_until_midi_sent(uint64_t extra_us = 2000);
+
+    void send_midi(std::initializer_list<uint8_t> bytes);
+    void send_midi(const uint8_t *data, size_t length);
+
+    // Feeds the bytes to MidiInput at once, like the SmfPlayer, e.g. for a
+    // chord that has to arrive in one output tick
+    void inject_midi(std::initializer_list<uint8_t> bytes);
+
+    void note_on(uint8_t note, uint8_t velocity = 100);
+    void note_off(uint8_t note);
+
+    // Panel, takes effect after the scan debounced it (HARNESS_DEBOUNCE_US
+    // for a switch)
+    void set_switch(mux_switch sw, bool on);
+    void set_pot(uint channel, uint16_t value);
+    void set_mode(device_mode mode);
+
+    // All notes off, outputs settled, trace cleared
+    void reset_outputs();
+
+    Scheduler &core0() { return m_core0; }
+    Scheduler &core1() { return m_core1; }
+
+protected:
+    Harness() = default;
+
+private:
+    bool m_booted = false;
+    uint8_t m_switches = 0;
+    Scheduler m_core0;
+    Scheduler m_core1;
+
+    int m_mux_input(uint gpio);
+};
+
+#endif
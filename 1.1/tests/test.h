@@ -0,0 +1,67 @@
+#ifndef _TEST_H
+#define _TEST_H
+
+/**
+ * Minimal test framework of the host tests
+ *
+ *      TEST(name) {
+ *          CHECK(condition);
+ *          CHECK_EQUAL(expected, actual);
+ *          CHECK_NEAR(expected, actual, tolerance);
+ *      }
+ *
+ * Every test file is an executable (see test_main.cpp), the tests run in the
+ * order they're defined. A failed check is printed and the test goes on, the
+ * executable fails if any check failed.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+
+typedef void (*test_function)();
+
+struct test_registration {
+    test_registration(const char *name, test_function function);
+};
+
+void test_fail(const char *file, int line, const std::string &message);
+
+// Numbers are printed as numbers, even uint8_t, strings as they are
+template <typename T>
+auto test_printable(const T &value) -> decltype(+value) { return +value; }
+inline const std::string &test_printable(const std::string &value) { return value; }
+
+#define TEST(name) \
+    static void test_##name(); \
+    static test_registration test_registration_##name(#name, test_##name); \
+    static void test_##name()
+
+#define CHECK(condition) do { \
+        if (!(condition)) test_fail(__FILE__, __LINE__, "CHECK(" #condition ")"); \
+    } while (0)
+
+#define CHECK_EQUAL(expected, actual) do { \
+        auto test_expected = (expected); \
+        auto test_actual = (actual); \
+        if (!(test_expected == test_actual)) { \
+            std::ostringstream test_message; \
+            test_message << #actual << " is " << test_printable(test_actual) << ", expected " \
+                         << test_printable(test_expected); \
+            test_fail(__FILE__, __LINE__, test_message.str()); \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(expected, actual, tolerance) do { \
+        double test_expected = (expected); \
+        double test_actual = (actual); \
+        if (!(fabs(test_expected - test_actual) <= (tolerance))) { \
+            std::ostringstream test_message; \
+            test_message << #actual << " is " << test_actual << ", expected " << test_expected \
+                         << " +-" << (tolerance); \
+            test_fail(__FILE__, __LINE__, test_message.str()); \
+        } \
+    } while (0)
+
+#endif
@@ -0,0 +1,100 @@
+/**
+ * Cycle model of the frequency_frac program (DCO_FRACTIONAL), on the
+ * simulated PIO: every half period of a word against Y + 6, its dither bit
+ * and the refill of the word, and the average against
+ * dco_half_period_eighths() for fractional divisors.
+ */
+
+#include <vector>
+#include "test.h"
+#include "fake_hal.h"
+#include "pitch.h"
+#include "frequency.pio.h"
+
+#define WORDS               4           // Simulated words of each divisor
+
+// Average half periods in 1/8 cycles, every fraction of a few periods
+static const uint32_t whole_cycles[] = {40, 301, 4409};
+
+/**
+ * Runs the program with the divisor, returns the edges of its pin
+*/
+static const std::vector<fake_pio_edge> &simulate(uint32_t divisor) {
+    fake_hal_reset();
+    fake_pio_simulate(true);
+
+    uint offset = pio_add_program(pio0, &frequency_frac_program);
+    init_sm_pin_frac(pio0, 0, offset, settings.reset_pins[0], GP_DCO_SYNC);
+    pio_sm_set_enabled(pio0, 0, true);
+    pio_sm_put(pio0, 0, divisor);
+    fake_pio_step((uint64_t)dco_half_period_eighths(divisor) * (WORDS + 1));
+
+    return fake_pio_edges(0, 0);
+}
+
+TEST(divisors_have_eighth_cycle_resolution) {
+    for (uint32_t cycles : whole_cycles) {
+        for (uint32_t eighths = cycles * 8; eighths < cycles * 8 + 8; eighths++) {
+            CHECK_EQUAL(eighths, dco_half_period_eighths(dco_divisor(eighths * 32)));
+        }
+    }
+}
+
+TEST(half_periods_follow_the_pattern) {
+    for (uint32_t cycles : whole_cycles) {
+        for (uint32_t eighths = cycles * 8; eighths < cycles * 8 + 8; eighths++) {
+            uint32_t divisor = dco_divisor(eighths * 32);
+            const std::vector<fake_pio_edge> &edges = simulate(divisor);
+            CHECK(edges.size() > WORDS * DCO_DITHER_BITS);
+            if (edges.size() <= WORDS * DCO_DITHER_BITS) continue;
+
+            // Half period n of a word is edge n to n + 1, the last one of
+            // the word ends after the refill
+            for (size_t i = 0; i < WORDS * DCO_DITHER_BITS; i++) {
+                uint32_t bit = i % DCO_DITHER_BITS;
+                uint64_t expected = (divisor >> 8) + DCO_CYCLE_OVERHEAD + ((divisor >> bit) & 1);
+                if (bit == DCO_DITHER_BITS - 1) expected += DCO_REFILL_CYCLES;
+
+                CHECK_EQUAL(expected, edges[i + 1].cycle - edges[i].cycle);
+            }
+        }
+    }
+}
+
+TEST(mean_half_period_matches_the_divisor) {
+    for (uint32_t cycles : whole_cycles) {
+        for (uint32_t eighths = cycles * 8; eighths < cycles * 8 + 8; eighths++) {
+            const std::vector<fake_pio_edge> &edges = simulate(dco_divisor(eighths * 32));
+            if (edges.size() <= WORDS * DCO_DITHER_BITS) continue;
+
+            // Any 8 half periods have the whole pattern and one refill, so
+            // they take the average in 1/8 cycles
+            for (size_t i = 1; i + DCO_DITHER_BITS < edges.size(); i++) {
+                CHECK_EQUAL((uint64_t)eighths, edges[i + DCO_DITHER_BITS].cycle - edges[i].cycle);
+            }
+        }
+    }
+}
+
+TEST(new_word_starts_after_the_pattern) {
+    uint32_t first = dco_divisor((301 * 8 + 3) * 32);
+    uint32_t second = dco_divisor((97 * 8 + 5) * 32);
+
+    // Sent in the middle of a word, not between its pull and its first edge
+    const std::vector<fake_pio_edge> &edges = simulate(first);
+    fake_pio_step(dco_half_period_eighths(first) / 2);
+    size_t sent_after = edges.size();
+    pio_sm_put(pio0, 0, second);
+    fake_pio_step((uint64_t)dco_half_period_eighths(first) * 2);
+
+    // The word being played is finished, the next word starts on a multiple
+    // of 8 half periods
+    size_t start = (sent_after + DCO_DITHER_BITS - 1) / DCO_DITHER_BITS * DCO_DITHER_BITS;
+    CHECK(edges.size() > start + DCO_DITHER_BITS);
+    if (edges.size() <= start + DCO_DITHER_BITS) return;
+
+    CHECK_EQUAL((uint64_t)dco_half_period_eighths(first),
+                edges[start].cycle - edges[start - DCO_DITHER_BITS].cycle);
+    CHECK_EQUAL((uint64_t)dco_half_period_eighths(second),
+                edges[start + DCO_DITHER_BITS].cycle - edges[start].cycle);
+}
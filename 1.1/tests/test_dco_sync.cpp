@@ -0,0 +1,103 @@
+/**
+ * Synced starts of the DCOs, on the simulated PIO programs: the voices that
+ * are restarted together must start on the same cycle, on both PIOs.
+ */
+
+#include <vector>
+#include "test.h"
+#include "harness.h"
+#include "pitch.h"
+
+#define SIMULATED_US    3000
+
+static uint64_t sync_cycle(uint64_t after) {
+    for (const fake_trace_entry &entry : fake_trace_of(FAKE_TRACE_GPIO, GP_DCO_SYNC)) {
+        if (entry.cycle >= after && entry.value) return entry.cycle;
+    }
+    return 0;
+}
+
+static const std::vector<fake_pio_edge> &edges_of(int voice) {
+    return fake_pio_edges(settings.voice_to_pio[voice], settings.voice_to_sm[voice]);
+}
+
+static uint64_t first_rise(int voice, uint64_t after) {
+    for (const fake_pio_edge &edge : edges_of(voice)) {
+        if (edge.cycle >= after && edge.level) return edge.cycle;
+    }
+    return 0;
+}
+
+/**
+ * Plays the notes at once with the PIOs simulated, returns the cycle of the
+ * sync pulse
+*/
+static uint64_t play_simulated(std::initializer_list<uint8_t> notes) {
+    Harness &harness = Harness::get_instance();
+    uint64_t start = fake_cycles();
+
+    fake_pio_clear_edges();
+    fake_pio_simulate(true);
+    for (uint8_t note : notes) {
+        harness.inject_midi({(uint8_t)(0x90 | MIDI_CHANNEL), note, 100});
+    }
+    harness.run_for_us(SIMULATED_US);
+    fake_pio_simulate(false);
+
+    return sync_cycle(start);
+}
+
+TEST(sync_pin_is_not_the_led) {
+    CHECK(GP_DCO_SYNC != 25);
+}
+
+TEST(para_chord_starts_in_phase_on_both_pios) {
+    Harness &harness = Harness::get_instance();
+    harness.boot(PARA);
+    harness.reset_outputs();
+
+    uint64_t sync = play_simulated({48, 52, 55, 60, 64, 67});
+    CHECK(sync > 0);
+
+    uint64_t first = first_rise(0, sync);
+    CHECK(first > sync);
+    for (int voice = 1; voice < VOICES; voice++) {
+        CHECK_EQUAL(first, first_rise(voice, sync));
+    }
+
+    for (int note : {48, 52, 55, 60, 64, 67}) {
+        harness.inject_midi({(uint8_t)(0x80 | MIDI_CHANNEL), (uint8_t)note, 0});
+    }
+    harness.run_for_us(2000);
+}
+
+TEST(fat_mono_voices_stay_in_phase) {
+    Harness &harness = Harness::get_instance();
+    harness.boot(FAT_MONO);
+    harness.set_switch(DETUNE, false);
+    harness.reset_outputs();
+
+    uint64_t sync = play_simulated({93});
+    CHECK(sync > 0);
+
+    // Same note on all of them, so every edge is on the same cycle
+    std::vector<uint64_t> rises[FAT_MONO_VOICES];
+    for (int voice = 0; voice < FAT_MONO_VOICES; voice++) {
+        for (const fake_pio_edge &edge : edges_of(voice)) {
+            if (edge.cycle >= sync && edge.level) rises[voice].push_back(edge.cycle);
+        }
+    }
+
+    // A1760 has a few periods in the simulated time
+    CHECK(rises[0].size() >= 2);
+    for (int voice = 1; voice < FAT_MONO_VOICES; voice++) {
+        CHECK_EQUAL(rises[0].size(), rises[voice].size());
+        for (size_t i = 0; i < rises[0].size() && i < rises[voice].size(); i++) {
+            CHECK_EQUAL(rises[0][i], rises[voice][i]);
+        }
+    }
+
+    harness.inject_midi({(uint8_t)(0x80 | MIDI_CHANNEL), 93, 0});
+    harness.run_for_us(2000);
+    harness.boot(PARA);
+}
@@ -0,0 +1,155 @@
+/**
+ * Glide timing: the pitch moves linearly in cents over the glide time, in
+ * control ticks, whatever the update rate. The firmware test checks the
+ * divisors a legato octave sends to the DCO.
+ */
+
+#include <math.h>
+#include <algorithm>
+#include "test.h"
+#include "harness.h"
+#include "glide.h"
+#include "pitch.h"
+
+#define VOICE0_PIO_CHANNEL  0           // pio0, sm0
+#define START_US            123456
+#define MAX_ERROR_CENTS     1.0
+
+// Glide step, MIDI task and output tick before a step is on the DCO
+#define LATENCY_US          (GLIDE_TICK_US + OUTPUT_TICK_US + 1000)
+
+/**
+ * Pitch of the glide, in cents, after the given time
+*/
+static double expected_cents(int32_t from, int32_t to, uint64_t time_us, uint64_t glide_us) {
+    if (time_us >= glide_us) return to;
+    uint64_t ticks = glide_us / GLIDE_TICK_US;
+    uint64_t tick = time_us / GLIDE_TICK_US;
+    return from + (double)(to - from) * tick / ticks;
+}
+
+static double cents_of(uint32_t divisor) {
+    double freq = (double)SYS_CLOCK_HZ / 2 * 8 / dco_half_period_eighths(divisor);
+    return 6900 + 1200 * log2(freq / 440.0);
+}
+
+TEST(glide_is_linear_in_cents) {
+    Glide glide;
+    glide.set_time(PORTAMENTO_TIME_US, false);
+    glide.jump(4800);
+    glide.start(6000, START_US);
+
+    uint64_t glide_us = 12 * PORTAMENTO_TIME_US;
+    for (uint64_t time = 0; time <= glide_us + 10000; time += 100) {
+        int32_t pitch = glide.update(START_US + time);
+        CHECK_EQUAL((int32_t)expected_cents(4800, 6000, time, glide_us), pitch);
+        CHECK_EQUAL(time < glide_us, glide.is_gliding());
+    }
+}
+
+TEST(fixed_time_doesnt_depend_on_the_interval) {
+    Glide glide;
+    glide.set_time(100000, true);
+
+    for (int32_t interval : {1, 100, 2400, -700}) {
+        glide.jump(6000);
+        glide.start(6000 + interval, START_US);
+
+        CHECK(glide.update(START_US + 100000 - GLIDE_TICK_US) != 6000 + interval || interval == 1);
+        CHECK(glide.is_gliding());
+        CHECK_EQUAL(6000 + interval, glide.update(START_US + 100000));
+        CHECK(!glide.is_gliding());
+    }
+}
+
+TEST(update_rate_doesnt_change_the_timing) {
+    Glide fast, slow;
+    for (Glide *glide : {&fast, &slow}) {
+        glide->set_time(PORTAMENTO_TIME_US, false);
+        glide->jump(3000);
+        glide->start(2500, START_US);
+    }
+
+    // The slow one is updated every 7ms, a bit late
+    for (uint64_t time = 0; time <= 5 * PORTAMENTO_TIME_US; time += GLIDE_TICK_US) {
+        int32_t pitch = fast.update(START_US + time);
+        if (time % 7000 == 0) {
+            CHECK_EQUAL(pitch, slow.update(START_US + time + GLIDE_TICK_US / 2));
+        }
+    }
+    CHECK_EQUAL(2500, fast.get_pitch());
+    CHECK_EQUAL(2500, slow.update(START_US + 5 * PORTAMENTO_TIME_US));
+}
+
+TEST(glide_goes_over_the_timer_wrap) {
+    Glide glide;
+    glide.set_time(PORTAMENTO_TIME_US, false);
+    glide.jump(6000);
+
+    uint32_t start = UINT32_MAX - PORTAMENTO_TIME_US / 2;
+    glide.start(6100, start);
+    CHECK_EQUAL(6050, glide.update(start + PORTAMENTO_TIME_US / 2));
+    CHECK_EQUAL(6100, glide.update(start + PORTAMENTO_TIME_US));
+    CHECK(!glide.is_gliding());
+}
+
+TEST(new_glide_starts_from_the_current_pitch) {
+    Glide glide;
+    glide.set_time(PORTAMENTO_TIME_US, false);
+    glide.jump(6000);
+    glide.start(6200, START_US);
+    CHECK_EQUAL(6100, glide.update(START_US + PORTAMENTO_TIME_US));
+
+    // 1 semitone back down, in 1 semitone's time
+    glide.start(6000, START_US + PORTAMENTO_TIME_US);
+    CHECK_EQUAL(6100, glide.get_pitch());
+    CHECK_EQUAL(6050, glide.update(START_US + PORTAMENTO_TIME_US * 3 / 2));
+    CHECK_EQUAL(6000, glide.update(START_US + PORTAMENTO_TIME_US * 2));
+}
+
+TEST(legato_octave_glides_on_the_dco) {
+    Harness &harness = Harness::get_instance();
+    harness.boot(MONO);
+    harness.reset_outputs();
+
+    // The first note jumps, portamento is turned on after it
+    harness.note_on(48);
+    harness.run_until_midi_sent();
+    harness.set_switch(PORTAMENTO, true);
+    harness.run_for_us(HARNESS_DEBOUNCE_US);
+    fake_trace_clear();
+
+    harness.note_on(60);
+    uint64_t start = fake_uart_idle_cycle(1);
+    uint64_t glide_us = 12 * PORTAMENTO_TIME_US;
+    harness.run_until_midi_sent(glide_us + 20000);
+
+    std::vector<fake_trace_entry> divisors = fake_trace_of(FAKE_TRACE_PIO, VOICE0_PIO_CHANNEL);
+    CHECK(divisors.size() > glide_us / GLIDE_TICK_US / 2);
+
+    // Each step is between where the glide was a latency ago and where it is
+    // now, and it never goes back
+    double last = 4800;
+    uint64_t end_us = 0;
+    for (const fake_trace_entry &entry : divisors) {
+        uint64_t time_us = (entry.cycle - start) / FAKE_CYCLES_PER_US;
+        double cents = cents_of(entry.value);
+        double earliest = expected_cents(4800, 6000, time_us > LATENCY_US ? time_us - LATENCY_US : 0, glide_us);
+
+        CHECK(cents >= earliest - MAX_ERROR_CENTS);
+        CHECK(cents <= expected_cents(4800, 6000, time_us, glide_us) + MAX_ERROR_CENTS);
+        CHECK(cents >= last - MAX_ERROR_CENTS);
+        last = cents;
+
+        if (!end_us && entry.value == Pitch::divisor(6000)) end_us = time_us;
+    }
+
+    CHECK(end_us >= glide_us);
+    CHECK(end_us <= glide_us + LATENCY_US);
+
+    harness.note_off(60);
+    harness.note_off(48);
+    harness.set_switch(PORTAMENTO, false);
+    harness.reset_outputs();
+    harness.boot(PARA);
+}
@@ -0,0 +1,38 @@
+#include <vector>
+#include "test.h"
+
+struct registered_test {
+    const char *name;
+    test_function function;
+};
+
+static std::vector<registered_test> &tests() {
+    static std::vector<registered_test> registered;
+    return registered;
+}
+
+static int g_failures = 0;
+
+test_registration::test_registration(const char *name, test_function function) {
+    tests().push_back({name, function});
+}
+
+void test_fail(const char *file, int line, const std::string &message) {
+    printf("%s:%d: %s\n", file, line, message.c_str());
+    g_failures++;
+}
+
+int main() {
+    int failed = 0;
+    for (registered_test &test : tests()) {
+        int failures = g_failures;
+        test.function();
+
+        bool passed = g_failures == failures;
+        printf("%s %s\n", passed ? "PASS" : "FAIL", test.name);
+        if (!passed) failed++;
+    }
+
+    printf("%d of %d tests passed\n", (int)tests().size() - failed, (int)tests().size());
+    return failed ? 1 : 0;
+}
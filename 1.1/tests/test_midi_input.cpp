@@ -0,0 +1,134 @@
+/**
+ * MidiInput's ring buffer: bytes from the UART IRQ and from inject() come out
+ * in order when the free running indexes wrap around the ring, peek() stops
+ * at the end of the ring, and a full ring drops instead of overwriting.
+ */
+
+#include <vector>
+#include "test.h"
+#include "fake_hal.h"
+#include "midi_input.h"
+
+// Bytes of 1 start, 8 data and 1 stop bit at the MIDI baud rate
+#define BYTE_US             (10 * 1000000 / MIDI_BAUDRATE + 1)
+
+/**
+ * Fresh HAL, the ring is empty but its indexes are where the last test left
+ * them
+*/
+static MidiInput &start() {
+    fake_hal_reset();
+    MidiInput &input = MidiInput::get_instance();
+    input.init();
+
+    uint8_t byte;
+    while (input.read(byte)) {}
+    return input;
+}
+
+static std::vector<uint8_t> counting(size_t length, uint8_t first) {
+    std::vector<uint8_t> bytes(length);
+    for (size_t i = 0; i < length; i++) bytes[i] = (uint8_t)(first + i);
+    return bytes;
+}
+
+TEST(injected_bytes_wrap_around_in_order) {
+    MidiInput &input = start();
+
+    // Odd sized chunks, so the writes and reads straddle the end of the ring
+    uint8_t next = 0;
+    uint8_t expected = 0;
+    for (int chunk = 0; chunk < 4 * MIDI_RX_BUFFER_SIZE / 97; chunk++) {
+        std::vector<uint8_t> bytes = counting(97, next);
+        CHECK_EQUAL(bytes.size(), input.inject(bytes.data(), bytes.size()));
+        next += bytes.size();
+
+        uint8_t byte;
+        while (input.read(byte)) {
+            CHECK_EQUAL(expected, byte);
+            expected++;
+        }
+    }
+
+    CHECK_EQUAL(next, expected);
+    CHECK(input.is_empty());
+}
+
+TEST(uart_bytes_wrap_around_in_order) {
+    MidiInput &input = start();
+    uint32_t dropped = input.dropped();
+
+    // 3/4 of the ring at a time, read after each, at the wire speed
+    uint8_t next = 0;
+    uint8_t expected = 0;
+    for (int chunk = 0; chunk < 6; chunk++) {
+        std::vector<uint8_t> bytes = counting(MIDI_RX_BUFFER_SIZE * 3 / 4, next);
+        fake_uart_send(1, bytes.data(), bytes.size());
+        next += bytes.size();
+        fake_advance_us(bytes.size() * BYTE_US);
+
+        uint8_t byte;
+        while (input.read(byte)) {
+            CHECK_EQUAL(expected, byte);
+            expected++;
+        }
+    }
+
+    CHECK_EQUAL(next, expected);
+    CHECK_EQUAL(dropped, input.dropped());
+}
+
+TEST(peek_stops_at_the_end_of_the_ring) {
+    MidiInput &input = start();
+
+    // A full ring is peeked in two parts, the second from the start of the
+    // buffer
+    bool split = false;
+    for (size_t step : {1, 10, 100, 255}) {
+        std::vector<uint8_t> skipped = counting(step, 0);
+        input.inject(skipped.data(), skipped.size());
+        input.consume(step);
+
+        std::vector<uint8_t> bytes = counting(MIDI_RX_BUFFER_SIZE, step);
+        CHECK_EQUAL(bytes.size(), input.inject(bytes.data(), bytes.size()));
+
+        const uint8_t *data;
+        size_t first = input.peek(data);
+        const uint8_t *end = data + first;
+        CHECK(first > 0);
+        for (size_t i = 0; i < first; i++) CHECK_EQUAL(bytes[i], data[i]);
+        input.consume(first);
+
+        size_t second = first < MIDI_RX_BUFFER_SIZE ? input.peek(data) : 0;
+        CHECK_EQUAL((size_t)MIDI_RX_BUFFER_SIZE, first + second);
+        for (size_t i = 0; i < second; i++) CHECK_EQUAL(bytes[first + i], data[i]);
+        input.consume(second);
+
+        if (second) {
+            CHECK(data == end - MIDI_RX_BUFFER_SIZE);
+            split = true;
+        }
+        CHECK(input.is_empty());
+    }
+    CHECK(split);
+}
+
+TEST(full_ring_drops_new_bytes) {
+    MidiInput &input = start();
+    uint32_t dropped = input.dropped();
+
+    std::vector<uint8_t> bytes = counting(MIDI_RX_BUFFER_SIZE + 5, 0);
+    CHECK_EQUAL((size_t)MIDI_RX_BUFFER_SIZE, input.inject(bytes.data(), bytes.size()));
+
+    // The UART's bytes are counted as dropped, the ones in the ring stay
+    fake_uart_send(1, bytes.data(), 3);
+    fake_advance_us(3 * BYTE_US);
+    CHECK_EQUAL(dropped + 3, input.dropped());
+
+    uint8_t byte;
+    for (size_t i = 0; i < MIDI_RX_BUFFER_SIZE; i++) {
+        CHECK(input.read(byte));
+        CHECK_EQUAL(bytes[i], byte);
+    }
+    CHECK(!input.read(byte));
+}
@@ -0,0 +1,193 @@
+/**
+ * BatchMidiParser: running status, real-time bytes anywhere, system common
+ * and sysex cancelling running status, and messages split between buffers
+ * (the ring of MidiInput is parsed in two parts when it wraps).
+ */
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "test.h"
+#include "harness.h"
+#include "batch_midi_parser.h"
+#include "pitch.h"
+
+#define NOTE_ON             (0x90 | MIDI_CHANNEL)
+#define NOTE_OFF            (0x80 | MIDI_CHANNEL)
+#define CC                  (0xb0 | MIDI_CHANNEL)
+#define DAC_CHANNEL_B       (1 << 15)
+#define DAC_VALUE_MASK      0xfff
+
+/**
+ * Keeps the callbacks as text, e.g. "on 4 60 100"
+*/
+class RecordingParser: public BatchMidiParser {
+public:
+    std::string messages;
+
+    void note_on(uint8_t channel, uint8_t note, uint8_t velocity) override {
+        m_add("on", channel, note, velocity);
+    }
+    void note_off(uint8_t channel, uint8_t note, uint8_t velocity) override {
+        m_add("off", channel, note, velocity);
+    }
+    void cc(uint8_t channel, uint8_t data1, uint8_t data2) override {
+        m_add("cc", channel, data1, data2);
+    }
+    void pitch_bend(uint8_t channel, uint16_t bend) override {
+        m_add("bend", channel, bend, -1);
+    }
+
+private:
+    void m_add(const char *type, int channel, int data1, int data2) {
+        if (!messages.empty()) messages += ", ";
+        messages += std::string(type) + " " + std::to_string(channel) + " " + std::to_string(data1);
+        if (data2 >= 0) messages += " " + std::to_string(data2);
+    }
+};
+
+static std::string parse(std::vector<uint8_t> bytes) {
+    RecordingParser parser;
+    parser.parse_bytes(bytes.data(), bytes.size());
+    return parser.messages;
+}
+
+static std::string on(int note, int velocity) {
+    return "on " + std::to_string(MIDI_CHANNEL) + " " + std::to_string(note) + " " + std::to_string(velocity);
+}
+
+static std::string off(int note, int velocity) {
+    return "off " + std::to_string(MIDI_CHANNEL) + " " + std::to_string(note) + " " + std::to_string(velocity);
+}
+
+static std::string cc(int number, int value) {
+    return "cc " + std::to_string(MIDI_CHANNEL) + " " + std::to_string(number) + " " + std::to_string(value);
+}
+
+TEST(running_status_continues_a_message) {
+    CHECK_EQUAL(on(60, 100) + ", " + on(64, 90) + ", " + off(67, 0),
+                parse({NOTE_ON, 60, 100, 64, 90, 67, 0}));
+    CHECK_EQUAL(cc(1, 10) + ", " + cc(1, 20), parse({CC, 1, 10, 1, 20}));
+    CHECK_EQUAL("bend " + std::to_string(MIDI_CHANNEL) + " 8192, bend " + std::to_string(MIDI_CHANNEL) + " 16383",
+                parse({0xe0 | MIDI_CHANNEL, 0x00, 0x40, 0x7f, 0x7f}));
+}
+
+TEST(one_byte_messages_keep_the_running_status_aligned) {
+    // Program change and channel pressure have no callbacks
+    CHECK_EQUAL(on(60, 100), parse({0xc0 | MIDI_CHANNEL, 5, 6, 7, NOTE_ON, 60, 100}));
+    CHECK_EQUAL(on(60, 100), parse({0xd0 | MIDI_CHANNEL, 10, 20, NOTE_ON, 60, 100}));
+}
+
+TEST(real_time_bytes_go_between_data_bytes) {
+    CHECK_EQUAL(on(60, 100) + ", " + on(64, 100),
+                parse({NOTE_ON, 0xf8, 60, 0xf8, 100, 0xfe, 64, 0xfa, 100, 0xfc}));
+}
+
+TEST(real_time_bytes_keep_the_running_status) {
+    CHECK_EQUAL(cc(1, 10) + ", " + cc(1, 20), parse({CC, 1, 10, 0xf8, 1, 20}));
+    CHECK_EQUAL(on(60, 100) + ", " + off(60, 0), parse({NOTE_ON, 60, 100, 0xff, 60, 0}));
+}
+
+TEST(system_common_cancels_the_running_status) {
+    // Song position (2 data bytes), song select (1), tune request (none)
+    CHECK_EQUAL(on(60, 100), parse({NOTE_ON, 60, 100, 0xf2, 0x10, 0x20, 62, 100}));
+    CHECK_EQUAL(on(60, 100), parse({NOTE_ON, 60, 100, 0xf3, 3, 62, 100}));
+    CHECK_EQUAL(on(60, 100), parse({NOTE_ON, 60, 100, 0xf6, 62, 100}));
+    CHECK_EQUAL(on(60, 100) + ", " + on(62, 100), parse({NOTE_ON, 60, 100, 0xf6, 62, 100, NOTE_ON, 62, 100}));
+}
+
+TEST(sysex_is_skipped) {
+    CHECK_EQUAL(on(60, 100) + ", " + off(60, 0),
+                parse({NOTE_ON, 60, 100, 0xf0, 0x7e, 0x7f, 0x09, 0x01, 0xf7, 61, 100, NOTE_OFF, 60, 0}));
+
+    // A status byte ends it too, without 0xf7
+    CHECK_EQUAL(on(60, 100), parse({0xf0, 0x43, 0x12, NOTE_ON, 60, 100}));
+
+    // Real-time bytes can come in the middle of it
+    CHECK_EQUAL(on(60, 100), parse({0xf0, 0x43, 0xf8, 0x12, 0xf7, NOTE_ON, 60, 100}));
+}
+
+TEST(data_without_a_status_is_ignored) {
+    CHECK_EQUAL("", parse({60, 100, 0xf8, 64, 100}));
+    CHECK_EQUAL(on(64, 100), parse({100, NOTE_ON, 64, 100}));
+}
+
+TEST(messages_can_be_split_between_buffers) {
+    std::vector<uint8_t> stream = {NOTE_ON, 60, 0xf8, 100, 64, 100, CC, 1, 0xf8, 10, 0xf0, 1, 2, 0xf7,
+                                   NOTE_OFF, 60, 0, 0xe0 | MIDI_CHANNEL, 0, 0x40, NOTE_ON, 64, 0};
+    std::string expected = parse(stream);
+
+    for (size_t split = 0; split <= stream.size(); split++) {
+        RecordingParser parser;
+        parser.parse_bytes(stream.data(), split);
+        parser.parse_bytes(stream.data() + split, stream.size() - split);
+        CHECK_EQUAL(expected, parser.messages);
+    }
+}
+
+/**
+ * The callbacks get the channel as the low nibble of the status (0-15), the
+ * same from both parsers, and the synth compares it with MIDI_CHANNEL as is
+*/
+TEST(channel_is_the_status_nibble) {
+    static_assert(MIDI_CHANNEL >= 0 && MIDI_CHANNEL <= 15, "MIDI_CHANNEL is a status nibble");
+
+    class ByteParser: public MidiParser {
+    public:
+        int channel = -1;
+        void note_on(uint8_t channel, uint8_t note, uint8_t velocity) override { this->channel = channel; }
+    };
+
+    for (int nibble = 0; nibble < 16; nibble++) {
+        std::vector<uint8_t> bytes = {(uint8_t)(0x90 | nibble), 60, 100};
+
+        ByteParser byte_parser;
+        for (uint8_t byte : bytes) byte_parser.parse_byte(byte);
+        CHECK_EQUAL(nibble, byte_parser.channel);
+
+        CHECK_EQUAL("on " + std::to_string(nibble) + " 60 100", parse(bytes));
+    }
+}
+
+TEST(only_midi_channel_is_played) {
+    Harness &harness = Harness::get_instance();
+    harness.boot(PARA);
+    harness.reset_outputs();
+
+    // Channels next to it, in case of an off by one either way
+    harness.send_midi({0x90 | (MIDI_CHANNEL - 1), 72, 100, 0x90 | (MIDI_CHANNEL + 1), 72, 100});
+    harness.run_until_midi_sent();
+    CHECK(fake_trace_of(FAKE_TRACE_PIO).empty());
+
+    harness.send_midi({NOTE_ON, 72, 100});
+    harness.run_until_midi_sent();
+    CHECK(!fake_trace_of(FAKE_TRACE_PIO).empty());
+
+    harness.send_midi({NOTE_OFF, 72, 0, 0x80 | (MIDI_CHANNEL - 1), 72, 0, 0x80 | (MIDI_CHANNEL + 1), 72, 0});
+    harness.run_until_midi_sent(RELEASE_SHORT * 2);
+}
+
+TEST(running_status_and_clock_play_through_the_firmware) {
+    Harness &harness = Harness::get_instance();
+    harness.boot(PARA);
+    harness.reset_outputs();
+
+    harness.send_midi({NOTE_ON, 60, 0xf8, 100, 0xf8, 64, 100, 0xfe});
+    harness.run_until_midi_sent();
+
+    std::vector<uint32_t> divisors;
+    for (const fake_trace_entry &entry : fake_trace_of(FAKE_TRACE_PIO)) divisors.push_back(entry.value);
+    CHECK(std::find(divisors.begin(), divisors.end(), Pitch::divisor(Pitch::from_midi_note(60))) != divisors.end());
+    CHECK(std::find(divisors.begin(), divisors.end(), Pitch::divisor(Pitch::from_midi_note(64))) != divisors.end());
+
+    // Note on with 0 velocity is a note off, in running status, so the
+    // envelope is closed after the release
+    harness.send_midi({NOTE_ON, 60, 0, 0xf8, 64, 0});
+    harness.run_until_midi_sent(RELEASE_SHORT * 2);
+
+    uint32_t envelope = DAC_VALUE_MASK;
+    for (const fake_trace_entry &entry : fake_trace_of(FAKE_TRACE_DAC)) {
+        if (!(entry.value & DAC_CHANNEL_B)) envelope = entry.value & DAC_VALUE_MASK;
+    }
+    CHECK_EQUAL(0u, envelope);
+}
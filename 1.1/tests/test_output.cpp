@@ -0,0 +1,88 @@
+/**
+ * What a note sends to the hardware: divisor, amp level and envelope
+ */
+
+#include "test.h"
+#include "harness.h"
+#include "pitch.h"
+
+#define VOICE0_PIO_CHANNEL  0           // pio0, sm0
+#define DAC_CHANNEL_B       (1 << 15)
+#define DAC_VALUE_MASK      0xfff
+
+static uint channel_of_amp(int voice) {
+    uint pin = settings.amp_pins[voice];
+    return pwm_gpio_to_slice_num(pin) * 2 + pwm_gpio_to_channel(pin);
+}
+
+TEST(boot_streams_the_dac) {
+    Harness &harness = Harness::get_instance();
+    harness.boot(PARA);
+    fake_trace_clear();
+
+    harness.run_for_us(10000);
+
+    // Two channels per frame at ENVELOPE_RATE_HZ
+    std::vector<fake_trace_entry> dac = fake_trace_of(FAKE_TRACE_DAC);
+    CHECK_NEAR(2 * ENVELOPE_RATE_HZ / 100, dac.size(), 4);
+}
+
+TEST(note_on_sets_the_divisor_and_the_amp) {
+    Harness &harness = Harness::get_instance();
+    harness.boot(PARA);
+    harness.reset_outputs();
+
+    harness.note_on(69);
+    harness.run_until_midi_sent();
+
+    std::vector<fake_trace_entry> divisors = fake_trace_of(FAKE_TRACE_PIO, VOICE0_PIO_CHANNEL);
+    CHECK(!divisors.empty());
+    if (!divisors.empty()) {
+        CHECK_EQUAL(Pitch::divisor(Pitch::from_midi_note(69)), divisors.back().value);
+    }
+
+    std::vector<fake_trace_entry> amp = fake_trace_of(FAKE_TRACE_PWM, channel_of_amp(0));
+    CHECK(!amp.empty());
+    if (!amp.empty()) {
+        CHECK_EQUAL(Pitch::amp(Pitch::divisor(Pitch::from_midi_note(69))), amp.back().value);
+    }
+}
+
+TEST(note_on_opens_the_envelope) {
+    Harness &harness = Harness::get_instance();
+    harness.boot(PARA);
+    harness.reset_outputs();
+
+    harness.note_on(60);
+    harness.run_until_midi_sent(ATTACK_SHORT * 2);
+
+    uint32_t envelope = 0;
+    for (fake_trace_entry &entry : fake_trace_of(FAKE_TRACE_DAC)) {
+        if (!(entry.value & DAC_CHANNEL_B)) envelope = std::max(envelope, entry.value & DAC_VALUE_MASK);
+    }
+    CHECK(envelope > SUSTAIN_ON / 2);
+
+    harness.note_off(60);
+    harness.run_until_midi_sent(RELEASE_SHORT * 2);
+
+    std::vector<fake_trace_entry> dac = fake_trace_of(FAKE_TRACE_DAC);
+    CHECK(!dac.empty());
+    if (!dac.empty()) {
+        CHECK_EQUAL(0u, dac.back().value & DAC_VALUE_MASK);
+    }
+}
+
+TEST(modwheel_opens_the_filter) {
+    Harness &harness = Harness::get_instance();
+    harness.boot(PARA);
+    harness.reset_outputs();
+
+    harness.send_midi({(uint8_t)(0xb0 | MIDI_CHANNEL), 1, 127});
+    harness.run_until_midi_sent();
+
+    uint32_t filter_mod = 0;
+    for (fake_trace_entry &entry : fake_trace_of(FAKE_TRACE_DAC)) {
+        if (entry.value & DAC_CHANNEL_B) filter_mod = entry.value & DAC_VALUE_MASK;
+    }
+    CHECK_EQUAL((uint32_t)FILTER_MOD_DAC_SIZE - 1, filter_mod);
+}
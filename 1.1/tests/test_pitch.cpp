@@ -0,0 +1,86 @@
+/**
+ * Tuning of Pitch::divisor(): notes from the note table and modulated
+ * pitches from the exp2 table, against the exact frequency. The half period
+ * of a divisor is measured on the PIO program itself, so the overhead
+ * correction (DCO_CYCLE_OVERHEAD) is checked too.
+ */
+
+#include <vector>
+#include "test.h"
+#include "fake_hal.h"
+#include "pitch.h"
+#include "frequency.pio.h"
+
+#define MAX_ERROR_CENTS     1.0
+
+// Pitch bend range and LFO depth, and some odd offsets in between
+static const int32_t offsets[] = {
+    -PITCH_BEND_SEMITONES * CENTS_PER_NOTE, -LFO_PITCH_DEPTH, -37, -1, 1, 13, 50, 99,
+    LFO_PITCH_DEPTH, PITCH_BEND_SEMITONES * CENTS_PER_NOTE
+};
+
+static double exact_freq(int32_t cents) {
+    return 440.0 * pow(2.0, (cents - 6900) / 1200.0);
+}
+
+static double error_cents(uint32_t divisor, int32_t cents) {
+    double freq = (double)SYS_CLOCK_HZ / 2 * 8 / dco_half_period_eighths(divisor);
+    return 1200.0 * log2(freq / exact_freq(cents));
+}
+
+/**
+ * Average half period of the program in cycles, from the edges of its pin
+*/
+static double measured_half_period(uint32_t divisor) {
+    fake_hal_reset();
+    fake_pio_simulate(true);
+
+    uint offset = pio_add_program(pio0, &frequency_program);
+    init_sm_pin(pio0, 0, offset, settings.reset_pins[0], GP_DCO_SYNC);
+    pio_sm_set_enabled(pio0, 0, true);
+    pio_sm_put(pio0, 0, divisor);
+    fake_pio_step((uint64_t)(divisor + 16) * 2 * 20);
+
+    const std::vector<fake_pio_edge> &edges = fake_pio_edges(0, 0);
+    if (edges.size() < 4) return 0;
+
+    // The first edge is the start, not a whole half period
+    return (double)(edges.back().cycle - edges[1].cycle) / (edges.size() - 2);
+}
+
+TEST(notes_are_in_tune) {
+    for (int note = LOWEST_MIDI_NOTE; note < MIDI_NOTES; note++) {
+        int32_t cents = Pitch::from_midi_note(note);
+        CHECK_NEAR(0, error_cents(Pitch::divisor(cents), cents), MAX_ERROR_CENTS);
+    }
+}
+
+TEST(modulated_pitches_are_in_tune) {
+    for (int note = LOWEST_MIDI_NOTE; note < MIDI_NOTES; note++) {
+        for (int32_t offset : offsets) {
+            int32_t cents = Pitch::from_midi_note(note) + offset;
+            if (cents < Pitch::from_midi_note(LOWEST_MIDI_NOTE) - PITCH_BEND_SEMITONES * CENTS_PER_NOTE) continue;
+            if (cents >= MIDI_NOTES * CENTS_PER_NOTE) continue;
+
+            CHECK_NEAR(0, error_cents(Pitch::divisor(cents), cents), MAX_ERROR_CENTS);
+        }
+    }
+}
+
+TEST(exp2_table_matches_the_note_table) {
+    // A pitch 1 cent off a note goes through the exp2 table, it must be 1
+    // cent away from the note
+    for (int note = LOWEST_MIDI_NOTE; note < MIDI_NOTES - 1; note++) {
+        int32_t cents = Pitch::from_midi_note(note);
+        double note_error = error_cents(Pitch::divisor(cents), cents);
+        double exp2_error = error_cents(Pitch::divisor(cents + 1), cents + 1);
+        CHECK_NEAR(note_error, exp2_error, MAX_ERROR_CENTS);
+    }
+}
+
+TEST(half_period_overhead_matches_the_program) {
+    for (int note : {LOWEST_MIDI_NOTE, 45, 69, 93, 117}) {
+        uint32_t divisor = Pitch::divisor(Pitch::from_midi_note(note));
+        CHECK_NEAR(dco_half_period_eighths(divisor) / 8.0, measured_half_period(divisor), 0.01);
+    }
+}
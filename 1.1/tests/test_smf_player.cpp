@@ -0,0 +1,52 @@
+/**
+ * SmfPlayer on the device: format 0 plays, format 1 with more tracks is
+ * skipped (the replay tool merges those)
+ */
+
+#include <fstream>
+#include <sstream>
+#include "test.h"
+#include "harness.h"
+
+#define GOLDEN_DIR  TESTS_DIR "/golden/"
+
+static std::string read_file(const char *path) {
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream data;
+    data << file.rdbuf();
+    return data.str();
+}
+
+static size_t played_divisors() {
+    size_t count = 0;
+    for (const fake_trace_entry &entry : fake_trace_of(FAKE_TRACE_PIO)) {
+        if (entry.value) count++;
+    }
+    return count;
+}
+
+TEST(format0_plays) {
+    Harness &harness = Harness::get_instance();
+    harness.boot(PARA);
+    harness.reset_outputs();
+
+    std::string smf = read_file(GOLDEN_DIR "chords_format0.mid");
+    CHECK(!smf.empty());
+    fake_stdin_set(smf);
+    harness.run_for_us(4000000);
+
+    CHECK(played_divisors() > 0);
+}
+
+TEST(format1_with_more_tracks_is_skipped) {
+    Harness &harness = Harness::get_instance();
+    harness.boot(PARA);
+    harness.reset_outputs();
+
+    std::string smf = read_file(GOLDEN_DIR "chords_format1.mid");
+    CHECK(!smf.empty());
+    fake_stdin_set(smf);
+    harness.run_for_us(4000000);
+
+    CHECK_EQUAL(0u, played_divisors());
+}
@@ -0,0 +1,60 @@
+/**
+ * Panel changes reach the synth's settings, also when the UI event queue
+ * overflows: then the synth applies the whole panel instead of the lost
+ * events.
+ */
+
+#include "test.h"
+#include "harness.h"
+
+// The mode pot is smoothed, it takes a few more scans than a switch
+#define MODE_CHANGE_US      (HARNESS_DEBOUNCE_US + 20000)
+
+TEST(switch_changes_are_applied) {
+    Harness &harness = Harness::get_instance();
+    harness.boot(PARA);
+
+    harness.set_switch(DETUNE, true);
+    harness.run_for_us(HARNESS_DEBOUNCE_US);
+    CHECK(settings.detune);
+
+    harness.set_switch(DETUNE, false);
+    harness.run_for_us(HARNESS_DEBOUNCE_US);
+    CHECK(!settings.detune);
+}
+
+TEST(full_queue_resyncs_the_panel) {
+    Harness &harness = Harness::get_instance();
+    harness.boot(PARA);
+    CHECK(!settings.portamento);
+
+    // Only the scan runs (in the timer IRQ), not the synth's UI task, so the
+    // queue fills up with portamento on, off, ... off
+    bool portamento = false;
+    for (int i = 0; i < UI_EVENT_QUEUE_SIZE; i++) {
+        portamento = !portamento;
+        harness.set_switch(PORTAMENTO, portamento);
+        fake_advance_us(HARNESS_DEBOUNCE_US);
+    }
+    CHECK(!portamento);
+
+    // These don't fit
+    harness.set_switch(PORTAMENTO, true);
+    harness.set_switch(DETUNE, true);
+    harness.set_mode(FAT_MONO);
+    fake_advance_us(MODE_CHANGE_US);
+    CHECK(UI::get_instance().has_events());
+
+    harness.run_for_us(5000);
+    CHECK(settings.portamento);
+    CHECK(settings.detune);
+    CHECK_EQUAL(FAT_MONO, settings.mode);
+    CHECK(!UI::get_instance().has_events());
+
+    harness.set_switch(PORTAMENTO, false);
+    harness.set_switch(DETUNE, false);
+    harness.set_mode(PARA);
+    harness.run_for_us(MODE_CHANGE_US);
+    CHECK(!settings.portamento);
+    CHECK_EQUAL(PARA, settings.mode);
+}
@@ -0,0 +1,43 @@
+/**
+ * Benchmark on the host
+ *
+ * Runs the firmware's benchmark (see benchmark.h) on the fake HAL, after the
+ * same boot as the tests. The workloads and the output are the device's,
+ * but the SysTick of the fake counts the host's time at the system clock,
+ * so the ns/event are the host's. With --instructions it counts the
+ * instructions of each event instead (Linux perf events), which don't
+ * depend on the load of the machine, to compare two builds.
+ *
+ *      benchmark [--instructions]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "harness.h"
+#include "benchmark.h"
+
+int main(int argc, char **argv) {
+    bool instructions = false;
+    if (argc == 2 && !strcmp(argv[1], "--instructions")) {
+        instructions = true;
+    } else if (argc != 1) {
+        fprintf(stderr, "Usage: benchmark [--instructions]\n");
+        return 2;
+    }
+
+    Harness::get_instance().boot(PARA);
+
+    if (instructions) {
+        if (!fake_systick_count_instructions(true)) {
+            fprintf(stderr, "Can't count instructions, see /proc/sys/kernel/perf_event_paranoid\n");
+            return 1;
+        }
+        printf("Host instructions, the cycles are instructions and the ns are not meaningful\n");
+    } else {
+        printf("Host time, %d cycles/us\n", FAKE_CYCLES_PER_US);
+    }
+
+    Benchmark::run();
+    fake_systick_count_instructions(false);
+    return 0;
+}
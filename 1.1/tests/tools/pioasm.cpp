@@ -0,0 +1,368 @@
+/**
+ * Minimal PIO assembler for the host build
+ *
+ * Builds the same C header from frequency.pio as the SDK's pioasm (c-sdk
+ * format), so the host build runs exactly the programs that go to the
+ * device. Only what's needed for the DCO programs is supported: labels,
+ * .wrap_target/.wrap, .origin, delays, the c-sdk blocks and all the
+ * instructions except irq. Side set and .define are errors.
+ *
+ *      pioasm <input.pio> <output.h>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+struct source_instruction {
+    std::string text;
+    int line;
+};
+
+struct program {
+    std::string name;
+    int origin = -1;
+    int wrap_target = 0;
+    int wrap = -1;
+    std::vector<source_instruction> instructions;
+    std::vector<uint16_t> encoded;
+    std::map<std::string, int> labels;
+    std::vector<std::pair<std::string, int>> public_labels;
+    std::string c_sdk;
+};
+
+static std::string g_file;
+
+static void fail(int line, const std::string &message) {
+    fprintf(stderr, "%s:%d: %s\n", g_file.c_str(), line, message.c_str());
+    exit(1);
+}
+
+static std::string trim(const std::string &text) {
+    size_t start = text.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(start, end - start + 1);
+}
+
+static std::string strip_comment(const std::string &text) {
+    size_t end = std::min(text.find(';'), text.find("//"));
+    return end == std::string::npos ? text : text.substr(0, end);
+}
+
+static std::string lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+    return text;
+}
+
+static bool parse_number(const std::string &text, int &value) {
+    if (text.empty()) return false;
+    char *end;
+    long number;
+    if (text.size() > 2 && text[0] == '0' && (text[1] == 'b' || text[1] == 'B')) {
+        number = strtol(text.c_str() + 2, &end, 2);
+    } else {
+        number = strtol(text.c_str(), &end, 0);
+    }
+    if (*end) return false;
+    value = (int)number;
+    return true;
+}
+
+static int number(const std::string &text, int line, int max) {
+    int value;
+    if (!parse_number(text, value) || value < 0 || value > max) {
+        fail(line, "invalid value '" + text + "'");
+    }
+    return value;
+}
+
+static std::vector<std::string> tokens(const std::string &text) {
+    std::string spaced = text;
+    std::replace(spaced.begin(), spaced.end(), ',', ' ');
+    std::istringstream stream(spaced);
+    std::vector<std::string> result;
+    std::string token;
+    while (stream >> token) result.push_back(token);
+    return result;
+}
+
+static int index_of(const std::string &name, const std::vector<std::string> &names, int line) {
+    for (size_t i = 0; i < names.size(); i++) {
+        if (!names[i].empty() && names[i] == name) return i;
+    }
+    fail(line, "invalid operand '" + name + "'");
+    return 0;
+}
+
+static int bit_count(const std::string &text, int line) {
+    int count = number(text, line, 32);
+    if (!count) fail(line, "bit count must be 1-32");
+    return count & 0x1f;
+}
+
+/**
+ * Encodes an instruction, labels are relative to the program
+*/
+static uint16_t encode(const program &prog, const source_instruction &source) {
+    int line = source.line;
+    std::string text = source.text;
+    int delay = 0;
+
+    size_t bracket = text.find('[');
+    if (bracket != std::string::npos) {
+        size_t close = text.find(']', bracket);
+        if (close == std::string::npos) fail(line, "missing ]");
+        delay = number(trim(text.substr(bracket + 1, close - bracket - 1)), line, 31);
+        if (trim(text.substr(close + 1)) != "") fail(line, "unexpected text after the delay");
+        text = text.substr(0, bracket);
+    }
+    if (text.find(" side ") != std::string::npos) fail(line, "side set is not supported");
+
+    std::vector<std::string> args = tokens(lower(text));
+    std::string op = args[0];
+    args.erase(args.begin());
+    uint16_t instr = 0;
+
+    if (op == "nop") {
+        instr = 0xa042;
+    } else if (op == "jmp") {
+        static const std::vector<std::string> conditions = {"", "!x", "x--", "!y", "y--", "x!=y", "pin", "!osre"};
+        int condition = 0;
+        if (args.size() == 2) {
+            condition = index_of(args[0], conditions, line);
+        } else if (args.size() != 1) {
+            fail(line, "jmp needs a target");
+        }
+
+        std::string target = args.back();
+        int address;
+        auto label = prog.labels.find(target);
+        if (label != prog.labels.end()) {
+            address = label->second;
+        } else {
+            address = number(target, line, 31);
+        }
+        instr = 0x0000 | (condition << 5) | address;
+    } else if (op == "wait") {
+        static const std::vector<std::string> sources = {"gpio", "pin"};
+        if (args.size() != 3) fail(line, "wait needs polarity, source and index");
+        int polarity = number(args[0], line, 1);
+        int source = index_of(args[1], sources, line);
+        instr = 0x2000 | (polarity << 7) | (source << 5) | number(args[2], line, 31);
+    } else if (op == "in") {
+        static const std::vector<std::string> sources = {"pins", "x", "y", "null", "", "", "isr", "osr"};
+        if (args.size() != 2) fail(line, "in needs a source and a bit count");
+        instr = 0x4000 | (index_of(args[0], sources, line) << 5) | bit_count(args[1], line);
+    } else if (op == "out") {
+        static const std::vector<std::string> destinations = {"pins", "x", "y", "null", "pindirs", "pc", "isr", "exec"};
+        if (args.size() != 2) fail(line, "out needs a destination and a bit count");
+        instr = 0x6000 | (index_of(args[0], destinations, line) << 5) | bit_count(args[1], line);
+    } else if (op == "push" || op == "pull") {
+        bool pull = op == "pull";
+        bool if_flag = false;
+        bool block = true;
+        for (std::string &arg : args) {
+            if (arg == (pull ? "ifempty" : "iffull")) {
+                if_flag = true;
+            } else if (arg == "block") {
+                block = true;
+            } else if (arg == "noblock") {
+                block = false;
+            } else {
+                fail(line, "invalid operand '" + arg + "'");
+            }
+        }
+        instr = 0x8000 | (pull << 7) | (if_flag << 6) | (block << 5);
+    } else if (op == "mov") {
+        static const std::vector<std::string> destinations = {"pins", "x", "y", "", "exec", "pc", "isr", "osr"};
+        static const std::vector<std::string> sources = {"pins", "x", "y", "null", "", "status", "isr", "osr"};
+        if (args.size() != 2) fail(line, "mov needs a destination and a source");
+
+        std::string source = args[1];
+        int operation = 0;
+        if (source[0] == '!' || source[0] == '~') {
+            operation = 1;
+            source = source.substr(1);
+        } else if (source.compare(0, 2, "::") == 0) {
+            operation = 2;
+            source = source.substr(2);
+        }
+        instr = 0xa000 | (index_of(args[0], destinations, line) << 5) | (operation << 3) |
+                index_of(source, sources, line);
+    } else if (op == "set") {
+        static const std::vector<std::string> destinations = {"pins", "x", "y", "", "pindirs"};
+        if (args.size() != 2) fail(line, "set needs a destination and a value");
+        instr = 0xe000 | (index_of(args[0], destinations, line) << 5) | number(args[1], line, 31);
+    } else {
+        fail(line, "unsupported instruction '" + op + "'");
+    }
+
+    return instr | (delay << 8);
+}
+
+static std::vector<program> parse(std::ifstream &input) {
+    std::vector<program> programs;
+    std::string raw;
+    int line = 0;
+    bool in_c_sdk = false;
+
+    while (std::getline(input, raw)) {
+        line++;
+
+        if (in_c_sdk) {
+            if (trim(raw) == "%}") {
+                in_c_sdk = false;
+            } else {
+                programs.back().c_sdk += raw + "\n";
+            }
+            continue;
+        }
+
+        std::string text = trim(strip_comment(raw));
+        if (text.empty()) continue;
+
+        if (text[0] == '%') {
+            if (programs.empty()) fail(line, "code block outside of a program");
+            if (tokens(text.substr(1))[0] != "c-sdk") {
+                // Other languages' blocks are skipped
+                while (std::getline(input, raw) && trim(raw) != "%}") line++;
+                line++;
+                continue;
+            }
+            in_c_sdk = true;
+            continue;
+        }
+
+        if (text[0] == '.') {
+            std::vector<std::string> args = tokens(text);
+            if (args[0] == ".program") {
+                if (args.size() != 2) fail(line, ".program needs a name");
+                programs.push_back(program());
+                programs.back().name = args[1];
+                continue;
+            }
+            if (programs.empty()) fail(line, args[0] + " outside of a program");
+            program &prog = programs.back();
+
+            if (args[0] == ".wrap_target") {
+                prog.wrap_target = prog.instructions.size();
+            } else if (args[0] == ".wrap") {
+                prog.wrap = (int)prog.instructions.size() - 1;
+            } else if (args[0] == ".origin" && args.size() == 2) {
+                prog.origin = number(args[1], line, 31);
+            } else {
+                fail(line, "unsupported directive " + args[0]);
+            }
+            continue;
+        }
+
+        if (programs.empty()) fail(line, "instruction outside of a program");
+        program &prog = programs.back();
+
+        size_t colon = text.find(':');
+        if (colon != std::string::npos && text.compare(colon, 2, "::") != 0) {
+            std::vector<std::string> label = tokens(text.substr(0, colon));
+            bool is_public = label.size() == 2 && label[0] == "public";
+            if (label.size() != 1 && !is_public) fail(line, "invalid label");
+
+            std::string name = label.back();
+            if (prog.labels.count(name)) fail(line, "duplicate label " + name);
+            prog.labels[name] = prog.instructions.size();
+            if (is_public) prog.public_labels.push_back({name, (int)prog.instructions.size()});
+
+            text = trim(text.substr(colon + 1));
+            if (text.empty()) continue;
+        }
+
+        prog.instructions.push_back({text, line});
+    }
+
+    if (in_c_sdk) fail(line, "unterminated code block");
+
+    for (program &prog : programs) {
+        if (prog.instructions.empty() || prog.instructions.size() > 32) {
+            fail(line, "program " + prog.name + " must have 1-32 instructions");
+        }
+        if (prog.wrap < 0) prog.wrap = prog.instructions.size() - 1;
+        for (source_instruction &instruction : prog.instructions) {
+            prog.encoded.push_back(encode(prog, instruction));
+        }
+    }
+
+    return programs;
+}
+
+static void write(FILE *output, const std::vector<program> &programs) {
+    fprintf(output, "// -------------------------------------------------- //\n");
+    fprintf(output, "// This file is autogenerated by pioasm; do not edit! //\n");
+    fprintf(output, "// -------------------------------------------------- //\n\n");
+    fprintf(output, "#pragma once\n\n");
+    fprintf(output, "#if !PICO_NO_HARDWARE\n#include \"hardware/pio.h\"\n#endif\n\n");
+
+    for (const program &prog : programs) {
+        std::string rule(prog.name.size() + 2, '-');
+        fprintf(output, "// %s //\n// %s //\n// %s //\n\n", rule.c_str(), prog.name.c_str(), rule.c_str());
+        fprintf(output, "#define %s_wrap_target %d\n", prog.name.c_str(), prog.wrap_target);
+        fprintf(output, "#define %s_wrap %d\n\n", prog.name.c_str(), prog.wrap);
+
+        for (auto &label : prog.public_labels) {
+            fprintf(output, "#define %s_offset_%s %du\n", prog.name.c_str(), label.first.c_str(), label.second);
+        }
+        if (!prog.public_labels.empty()) fprintf(output, "\n");
+
+        fprintf(output, "static const uint16_t %s_program_instructions[] = {\n", prog.name.c_str());
+        for (size_t i = 0; i < prog.encoded.size(); i++) {
+            if ((int)i == prog.wrap_target) fprintf(output, "            //     .wrap_target\n");
+            fprintf(output, "    0x%04x, // %2zu: %s\n", prog.encoded[i], i, prog.instructions[i].text.c_str());
+            if ((int)i == prog.wrap) fprintf(output, "            //     .wrap\n");
+        }
+        fprintf(output, "};\n\n");
+
+        fprintf(output, "#if !PICO_NO_HARDWARE\n");
+        fprintf(output, "static const struct pio_program %s_program = {\n", prog.name.c_str());
+        fprintf(output, "    .instructions = %s_program_instructions,\n", prog.name.c_str());
+        fprintf(output, "    .length = %zu,\n", prog.encoded.size());
+        fprintf(output, "    .origin = %d,\n", prog.origin);
+        fprintf(output, "};\n\n");
+
+        fprintf(output, "static inline pio_sm_config %s_program_get_default_config(uint offset) {\n",
+                prog.name.c_str());
+        fprintf(output, "    pio_sm_config c = pio_get_default_sm_config();\n");
+        fprintf(output, "    sm_config_set_wrap(&c, offset + %s_wrap_target, offset + %s_wrap);\n",
+                prog.name.c_str(), prog.name.c_str());
+        fprintf(output, "    return c;\n}\n");
+        if (!prog.c_sdk.empty()) fprintf(output, "\n%s", prog.c_sdk.c_str());
+        fprintf(output, "#endif\n\n");
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: pioasm <input.pio> <output.h>\n");
+        return 1;
+    }
+
+    g_file = argv[1];
+    std::ifstream input(argv[1]);
+    if (!input) {
+        fprintf(stderr, "Can't open %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<program> programs = parse(input);
+
+    FILE *output = fopen(argv[2], "w");
+    if (!output) {
+        fprintf(stderr, "Can't write %s\n", argv[2]);
+        return 1;
+    }
+    write(output, programs);
+    fclose(output);
+    return 0;
+}
@@ -0,0 +1,300 @@
+/**
+ * MIDI file replay on the host
+ *
+ * Plays a Standard MIDI File through the firmware on the fake HAL and writes
+ * the OutputRecorder's trace, the same text the device sends over USB with
+ * ENABLE_OUTPUT_RECORDER. With a golden trace it compares the two and fails
+ * on the first difference, so a change in the control path shows up as a
+ * diff of the outputs.
+ *
+ * The tracks are streamed from the file, one reader per track, and merged by
+ * their time, so format 1 files play their tracks together (the device's
+ * SmfPlayer only takes format 0). The merged file is played by the firmware's
+ * SmfPlayer, fed through stdin like over USB. --format0 writes the merged
+ * file instead, to play it on the device.
+ *
+ *      smf_replay [--mode mono|fat|para] <input.mid> <output.trace> [golden.trace]
+ *      smf_replay --format0 <input.mid> <output.mid>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include "harness.h"
+#include "recorder.h"
+#include "smf_player.h"
+#include "smf_track.h"
+
+#define REPLAY_TAIL_US      2000000     // After the last event, for the release
+#define REPLAY_FLUSH_US     100000      // For the recorder to send the rest
+
+struct smf_file {
+    uint16_t format;
+    uint16_t division;
+    std::vector<std::pair<std::streamoff, uint32_t>> tracks;   // Offset and length
+};
+
+/**
+ * Reads the events of a track from its own stream
+*/
+class TrackReader {
+public:
+    TrackReader(const char *path, std::streamoff offset, uint32_t length): m_file(path, std::ios::binary) {
+        m_file.seekg(offset);
+        m_parser.start(length);
+    }
+
+    // Reads the next event, returns false at the end of the track
+    bool next() {
+        while (!m_parser.is_finished()) {
+            int byte = m_file.get();
+            if (byte == EOF) break;
+            if (m_parser.parse(byte, event)) {
+                tick += event.delta;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t tick = 0;
+    smf_event event;
+
+private:
+    std::ifstream m_file;
+    SmfTrackParser m_parser;
+};
+
+static uint32_t read_be(std::istream &file, int length) {
+    uint32_t value = 0;
+    for (int i = 0; i < length; i++) {
+        value = (value << 8) | (uint8_t)file.get();
+    }
+    return value;
+}
+
+/**
+ * Finds the tracks, only the chunk headers are read
+*/
+static bool read_file(const char *path, smf_file &smf) {
+    std::ifstream file(path, std::ios::binary);
+    char id[4];
+    if (!file.read(id, 4) || memcmp(id, "MThd", 4)) return false;
+
+    uint32_t length = read_be(file, 4);
+    smf.format = read_be(file, 2);
+    uint16_t tracks = read_be(file, 2);
+    smf.division = read_be(file, 2);
+    file.seekg(8 + length);
+
+    while (smf.tracks.size() < tracks && file.read(id, 4)) {
+        length = read_be(file, 4);
+        if (!memcmp(id, "MTrk", 4)) smf.tracks.push_back({file.tellg(), length});
+        file.seekg(length, std::ios::cur);
+    }
+    return !file.bad();
+}
+
+static void write_vlq(std::string &out, uint32_t value) {
+    uint8_t bytes[5];
+    int count = 0;
+    do {
+        bytes[count++] = value & 0x7f;
+        value >>= 7;
+    } while (value);
+
+    while (count--) {
+        out += (char)(bytes[count] | (count ? 0x80 : 0));
+    }
+}
+
+static void write_be(std::string &out, uint32_t value, int length) {
+    for (int i = length - 1; i >= 0; i--) {
+        out += (char)((value >> (i * 8)) & 0xff);
+    }
+}
+
+/**
+ * Merges the tracks into a format 0 file. Format 1 tracks are merged by their
+ * time (on the same tick the earlier track goes first), the others follow
+ * each other. Returns the length of the file in us.
+*/
+static uint64_t merge(const char *path, const smf_file &smf, std::string &out) {
+    std::vector<std::unique_ptr<TrackReader>> readers;
+    for (auto &track : smf.tracks) {
+        readers.emplace_back(new TrackReader(path, track.first, track.second));
+    }
+
+    std::vector<bool> pending(readers.size());
+    for (size_t i = 0; i < readers.size(); i++) pending[i] = readers[i]->next();
+
+    // Same time base as the SmfPlayer
+    bool smpte = smf.division & 0x8000;
+    uint32_t division = smpte ? (uint32_t)(-(int8_t)(smf.division >> 8)) * (smf.division & 0xff) : smf.division;
+    if (!division) division = 96;
+    uint32_t tempo = smpte ? 1000000 : SMF_DEFAULT_TEMPO;
+    uint64_t time_us = 0;
+    uint64_t remainder = 0;
+
+    std::string track;
+    uint64_t last_tick = 0;
+    uint64_t offset = 0;                // Start of the current track, if they follow each other
+    size_t current = 0;
+
+    while (true) {
+        int next = -1;
+        if (smf.format == 1) {
+            for (size_t i = 0; i < readers.size(); i++) {
+                if (pending[i] && (next < 0 || readers[i]->tick < readers[next]->tick)) next = i;
+            }
+        } else {
+            while (current < readers.size() && !pending[current]) {
+                offset = last_tick;
+                current++;
+            }
+            if (current < readers.size()) next = current;
+        }
+        if (next < 0) break;
+
+        TrackReader &reader = *readers[next];
+        uint64_t tick = reader.tick + offset;
+        write_vlq(track, tick - last_tick);
+
+        uint64_t ticks = (tick - last_tick) * tempo + remainder;
+        time_us += ticks / division;
+        remainder = ticks % division;
+        last_tick = tick;
+
+        if (reader.event.type == SMF_EVENT_TEMPO) {
+            track += "\xff\x51\x03";
+            write_be(track, reader.event.tempo, 3);
+            if (!smpte) tempo = reader.event.tempo;
+        } else {
+            track.append((const char *)reader.event.data, reader.event.length);
+        }
+
+        pending[next] = reader.next();
+    }
+
+    track += std::string("\x00\xff\x2f\x00", 4);
+
+    out = "MThd";
+    write_be(out, 6, 4);
+    write_be(out, 0, 2);
+    write_be(out, 1, 2);
+    write_be(out, smf.division, 2);
+    out += "MTrk";
+    write_be(out, track.size(), 4);
+    out += track;
+
+    return time_us;
+}
+
+/**
+ * Prints the first line that's different, returns true if they're the same
+*/
+static bool compare(const std::string &trace, const char *golden_path) {
+    std::ifstream golden_file(golden_path);
+    if (!golden_file) {
+        fprintf(stderr, "Can't read %s, copy the output there if it's right\n", golden_path);
+        return false;
+    }
+
+    std::istringstream actual(trace);
+    std::string expected_line, actual_line;
+    int line = 0;
+    while (true) {
+        line++;
+        bool has_expected = (bool)std::getline(golden_file, expected_line);
+        bool has_actual = (bool)std::getline(actual, actual_line);
+        if (!has_expected && !has_actual) return true;
+
+        if (has_expected != has_actual || expected_line != actual_line) {
+            fprintf(stderr, "%s:%d: expected '%s', got '%s'\n", golden_path, line,
+                    has_expected ? expected_line.c_str() : "<end>", has_actual ? actual_line.c_str() : "<end>");
+            return false;
+        }
+    }
+}
+
+static int usage() {
+    fprintf(stderr, "Usage: smf_replay [--mode mono|fat|para] <input.mid> <output.trace> [golden.trace]\n"
+                    "       smf_replay --format0 <input.mid> <output.mid>\n");
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    device_mode mode = PARA;
+    bool format0 = false;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (!strcmp(argv[arg], "--format0")) {
+            format0 = true;
+        } else if (!strcmp(argv[arg], "--mode") && arg + 1 < argc) {
+            std::string name = argv[++arg];
+            if (name == "mono") {
+                mode = MONO;
+            } else if (name == "fat") {
+                mode = FAT_MONO;
+            } else if (name == "para") {
+                mode = PARA;
+            } else {
+                return usage();
+            }
+        } else {
+            return usage();
+        }
+    }
+    if (argc - arg < 2 || argc - arg > (format0 ? 2 : 3)) return usage();
+
+    const char *input = argv[arg];
+    const char *output = argv[arg + 1];
+    const char *golden = (argc - arg == 3) ? argv[arg + 2] : NULL;
+
+    smf_file smf;
+    if (!read_file(input, smf)) {
+        fprintf(stderr, "%s is not a MIDI file\n", input);
+        return 1;
+    }
+
+    std::string merged;
+    uint64_t length_us = merge(input, smf, merged);
+
+    if (format0) {
+        std::ofstream file(output, std::ios::binary);
+        file << merged;
+        return file ? 0 : 1;
+    }
+
+    Harness &harness = Harness::get_instance();
+    harness.boot(mode);
+
+    // The records of the boot go nowhere, like on the device without a host
+    harness.run_for_us(REPLAY_FLUSH_US);
+    fake_usb_capture(true);
+    fake_stdin_set(merged);
+    harness.run_for_us(length_us + REPLAY_TAIL_US);
+    harness.run_for_us(REPLAY_FLUSH_US);
+    std::string trace = fake_usb_take();
+
+    std::ofstream file(output);
+    file << trace;
+    if (!file) {
+        fprintf(stderr, "Can't write %s\n", output);
+        return 1;
+    }
+
+    uint32_t dropped = OutputRecorder::get_instance().dropped();
+    if (dropped) {
+        fprintf(stderr, "The recorder dropped %lu records\n", (unsigned long)dropped);
+        return 1;
+    }
+
+    return (golden && !compare(trace, golden)) ? 1 : 0;
+}